@@ -0,0 +1,104 @@
+/**
+ * Camera table for multi-camera rigs
+ *
+ * One entry per GoPro the scan has seen (up to CAMERA_MAX), holding
+ * everything the sync flow keeps per camera: its BLE client and GATT
+ * handles, WiFi credentials, which link its time is set over, and where it
+ * is in the sync sequence. main.cpp steps every entry's state machine from
+ * loop(), so one camera's waits (AP start-up, WiFi join, the send slot of
+ * a set, the spacing of verification reads) overlap another camera's work.
+ * No step waits longer than the last few milliseconds before a timed send.
+ *
+ * The ESP32 controller holds CAMERA_MAX_LINKS LE links at a time (the
+ * precompiled Arduino controller's CONFIG_BTDM_CTRL_BLE_MAX_CONN). Past
+ * that, synced cameras (and cameras waiting for verification) are parked:
+ * their link is dropped and they are reconnected for the verification or
+ * when their next periodic sync is due.
+ *
+ * Serial diagnostics (see handleSerialCommands() in main.cpp):
+ *   'c' - camera table as CSV
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <NimBLEDevice.h>
+
+#include "clock_verify.h"
+#include "credential_cache.h"
+#include "gatt_cache.h"
+#include "gopro_advert.h"
+
+#define CAMERA_MAX 12              // Cameras tracked (one AP ready bit each)
+#define CAMERA_MAX_LINKS 3         // Simultaneous LE links the controller accepts
+
+enum CameraState : uint8_t {
+    CAMERA_ABSENT = 0,         // Not advertising as far as we know; the next scan looks for it
+    CAMERA_FOUND,              // Seen or due for a sync; connect over BLE and set the time
+    CAMERA_WAIT_AP,            // AP enable sent; waiting for AP state 0x03
+    CAMERA_WAIT_WIFI,          // AP ready; waiting for the station interface
+    CAMERA_WIFI_JOIN,          // Joining the camera's AP
+    CAMERA_DRIFT,              // Periodic sync: reading the drift since the last one
+    CAMERA_ALIGN,              // Waiting for the send slot of the set (probing the link)
+    CAMERA_VERIFY,             // Time set; reading it back
+    CAMERA_SYNCED,             // Waiting for the next sync (drift schedule, or a retry)
+    CAMERA_STATE_COUNT
+};
+
+struct GoProCamera {
+    NimBLEAddress address;
+    CameraState state;
+    GoProAdvert advert;            // Last advertisement the scan parsed (schema 0 = none)
+    NimBLEClient* client;          // Created on the first connect, then reused
+    GoProHandles handles;
+    CredentialString ssid;
+    CredentialString password;
+    bool credentialsRead;          // Credentials came over BLE this attempt (not from the cache)
+    bool bleLink;                  // Time is set over the BLE command channel
+    bool bleTimeRejected;          // Camera refused Set Date/Time over BLE; WiFi/HTTP until reboot
+    bool apStateNotifications;
+    bool commandReady;             // Command responses subscribed on the current link
+    bool fastJoin;                 // Current WiFi join is pinned to the cached BSSID/channel
+    bool parked;                   // Link dropped on purpose, to free it for another camera
+    uint32_t unseenScanMs;         // Scan time since a parked camera was last seen advertising
+    bool resync;                   // Periodic sync: measure drift before setting the time
+    uint8_t sets;                  // Time sets in the current sync (verification re-sets)
+    uint8_t verifyFailures;        // Read-backs in the current sync that failed and were started over
+    uint8_t probes;                // RTT probes taken while waiting for the send slot
+    uint8_t sendFailures;          // Failed sends of the pending set, each re-planned on a later second
+    uint32_t targetSecond;         // RTC second the pending set carries (Unix time)
+    uint32_t targetEdgeUs;         // micros() of its edge
+    ClockVerifySession measure;    // Clock read-back in progress (drift, verification)
+    uint32_t stateSinceUs;         // micros() when the current state was entered
+    uint32_t wakeMs;               // millis() before which the camera is not stepped
+    uint32_t attemptStartUs;       // micros() of the scan that started this sync (time-to-sync)
+    bool attemptActive;
+    unsigned long lastSyncMs;
+    uint32_t syncIntervalMs;
+};
+
+uint8_t cameraCount();
+GoProCamera& cameraAt(uint8_t index);
+uint8_t cameraIndex(const GoProCamera& camera);
+
+// Entry for a camera address (null if unknown); cameraAdd() creates it if
+// there is room (null when the table is full)
+GoProCamera* cameraFind(const NimBLEAddress& address);
+GoProCamera* cameraAdd(const NimBLEAddress& address);
+
+// Camera on a BLE connection handle (for notification callbacks)
+GoProCamera* cameraForConnection(uint16_t connId);
+
+// LE links currently held by the table
+uint8_t cameraLinks();
+
+// Enter a state (re-entering the current one restarts its clock); the
+// camera is stepped again on the next pass unless cameraWakeAfter() defers it
+void cameraSetState(GoProCamera& camera, CameraState state);
+uint32_t cameraStateMs(const GoProCamera& camera);
+void cameraWakeAfter(GoProCamera& camera, uint32_t delayMs);
+bool cameraAwake(const GoProCamera& camera);
+const char* cameraStateName(CameraState state);
+
+// Serial dump
+void cameraTableDump();
@@ -0,0 +1,83 @@
+/**
+ * Read-back verification of the camera clock
+ *
+ * A camera reports its clock in whole seconds, so a single read only pins
+ * its offset from the DS3231 to within a second. Each read is timed so that
+ * the camera samples its clock where its seconds would roll over if the
+ * offset were the middle of the current bracket. The reported second then
+ * shows which side of that point the offset is on. The camera samples
+ * somewhere between the request being sent and the answer arriving; with a
+ * measured link, that is narrowed to 3 sigma around the one-way estimate,
+ * which brackets the offset to a few milliseconds. If the reads contradict
+ * each other under the narrow windows, only the full round trip is
+ * assumed.
+ *
+ * Every verification is appended to a log in NVS with the camera it was
+ * for, so sync quality can be checked after a shoot. Each record has an NVS
+ * slot of its own, so an append writes one record, not the whole log.
+ *
+ * Serial diagnostics (see handleSerialCommands() in main.cpp):
+ *   'v' - verification log as CSV
+ */
+
+#pragma once
+
+#include <NimBLEDevice.h>
+#include <RTClib.h>
+
+#include "link_latency.h"
+
+#define CLOCK_VERIFY_MAX_READS 8          // Camera clock reads per verification
+#define CLOCK_VERIFY_RESOLUTION_US 10000  // Stop once the bracket is this narrow
+#define SYNC_LOG_ENTRIES 32               // Verifications kept in NVS (all cameras)
+
+// One read of the camera clock: the second it reported and the micros()
+// window within which the camera sampled it
+struct CameraClockReading {
+    uint32_t second;           // Unix time
+    uint32_t sentUs;
+    uint32_t receivedUs;
+};
+
+// Camera clock minus DS3231 time; the true offset lies within
+// offsetUs +/- uncertaintyUs
+struct ClockOffset {
+    int32_t offsetUs;
+    uint32_t uncertaintyUs;
+    uint8_t reads;
+};
+
+// A verification in progress. Reads are taken one at a time, each sent at
+// the micros() time clockVerifyNextReadUs() gives, so the caller can serve
+// other cameras between them.
+struct ClockVerifySession {
+    CameraClockReading readings[CLOCK_VERIFY_MAX_READS];
+    LinkEstimate link;
+    uint32_t refSecond;        // RTC second the bracket is relative to (Unix time)
+    uint32_t edgeUs;           // micros() at its start
+    int64_t lo;                // Offset bracket so far
+    int64_t hi;
+    uint8_t reads;
+    bool aligned;              // edgeUs is an SQW edge
+    bool narrow;               // Windows still narrowed by the link estimate
+};
+
+// Start bracketing the camera's offset from the RTC. link is the camera's
+// one-way delay estimate for the transport the reads go over.
+void clockVerifyBegin(RTC_DS3231& rtc, const LinkEstimate& link, ClockVerifySession& session);
+
+// micros() at which the next read has to be sent (now, for the first)
+uint32_t clockVerifyNextReadUs(const ClockVerifySession& session);
+
+// Add a read sent at that time; false if it contradicts the earlier ones
+// (the camera clock jumped between reads)
+bool clockVerifyAddReading(ClockVerifySession& session, const CameraClockReading& reading);
+
+// The bracket is narrow enough, or no further read can narrow it
+bool clockVerifyDone(const ClockVerifySession& session);
+void clockVerifyResult(const ClockVerifySession& session, ClockOffset& offset);
+
+// Verification log
+void syncLogAppend(const NimBLEAddress& address, LinkTransport transport, uint8_t sets,
+                   uint32_t rtcTime, const ClockOffset& offset);
+void syncLogDump();
@@ -0,0 +1,40 @@
+/**
+ * Per-camera WiFi credential cache
+ *
+ * A GoPro keeps the same AP SSID and password across power cycles, so
+ * after the first BLE read they are stored in NVS keyed by BLE address and
+ * reconnects skip both GATT reads. The cache entry is only refreshed when
+ * the WiFi join is rejected with an authentication error.
+ *
+ * The BSSID and channel of the camera's AP are cached alongside, so the
+ * join can be pinned to them instead of scanning every channel.
+ *
+ * The entries live in their own NVS namespace. They are encrypted at rest
+ * when the firmware is built with NVS encryption (CONFIG_NVS_ENCRYPTION,
+ * which needs flash encryption and an nvs_keys partition); without it they
+ * are stored in plain text and setup() prints a warning.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <NimBLEDevice.h>
+
+#include "fixed_string.h"
+
+#define CREDENTIAL_MAX_LENGTH 64
+
+// SSID or password, held in place (no heap)
+typedef FixedString<CREDENTIAL_MAX_LENGTH> CredentialString;
+
+bool credentialCacheLoad(const NimBLEAddress& address, CredentialString& ssid, CredentialString& password);
+bool credentialCacheStore(const NimBLEAddress& address, const CredentialString& ssid,
+                          const CredentialString& password);
+void credentialCacheErase(const NimBLEAddress& address);
+
+// AP BSSID + channel from the last successful join
+bool credentialCacheLoadAP(const NimBLEAddress& address, uint8_t bssid[6], uint8_t& channel);
+bool credentialCacheStoreAP(const NimBLEAddress& address, const uint8_t bssid[6], uint8_t channel);
+
+// True when NVS encryption protects the cached credentials
+bool credentialCacheEncrypted();
@@ -0,0 +1,54 @@
+/**
+ * Per-camera clock drift model for sync scheduling
+ *
+ * The verification after each set anchors the camera's offset from the
+ * DS3231. Before the next scheduled set, the camera's clock is read again.
+ * The change in offset over the elapsed time is one drift rate measurement
+ * (microseconds per second = ppm), weighted by both brackets' uncertainty.
+ * A scalar Kalman filter combines these into a rate estimate, with a random
+ * walk for temperature and ageing.
+ *
+ * The next sync is scheduled for when the worst-case predicted offset
+ * (anchor offset plus rate plus two standard deviations, over time)
+ * reaches the tolerance. Cameras with a good crystal are visited rarely;
+ * bad ones are visited often enough to stay within bounds. The model is
+ * stored in NVS per camera, so it survives reboots.
+ *
+ * Serial diagnostics (see handleSerialCommands() in main.cpp):
+ *   'd' - drift models of the cameras in the camera table as CSV
+ */
+
+#pragma once
+
+#include <NimBLEDevice.h>
+
+#include "clock_verify.h"
+
+#define DRIFT_PRIOR_SIGMA_PPM 50.0f       // Rate uncertainty before any measurement
+#define DRIFT_WANDER_PPM_PER_DAY 2.0f     // Random walk of the rate (temperature, ageing)
+
+struct DriftEstimate {
+    float ratePpm;             // Camera clock gain vs. the DS3231 (positive = fast)
+    float sigmaPpm;            // Standard deviation of ratePpm
+    uint16_t measurements;
+    bool anchored;             // Offset after the last set is known
+    uint32_t anchorTime;       // RTC Unix time of that verification
+    int32_t anchorOffsetUs;
+    uint32_t anchorUncertaintyUs;
+};
+
+bool driftModelGet(const NimBLEAddress& address, DriftEstimate& estimate);
+
+// Offset verified right after a set: the start of a new free-running span
+void driftRecordSet(const NimBLEAddress& address, uint32_t rtcTime, const ClockOffset& offset);
+
+// Offset measured just before a set; folds the span's rate into the model
+void driftRecordMeasurement(const NimBLEAddress& address, uint32_t rtcTime, const ClockOffset& offset);
+
+// Milliseconds after rtcTime until the camera may be toleranceUs off,
+// clamped to [minMs, maxMs]
+uint32_t driftNextSyncDelay(const NimBLEAddress& address, uint32_t rtcTime, uint32_t toleranceUs,
+                            uint32_t minMs, uint32_t maxMs);
+
+// Serial dump of the given cameras' models
+void driftModelDump(const NimBLEAddress* addresses, uint8_t count);
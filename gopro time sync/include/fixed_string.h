@@ -0,0 +1,84 @@
+/**
+ * Fixed-capacity strings for the sync path
+ *
+ * Arduino String and std::string put anything but the shortest text on the
+ * heap, and a unit that reconnects to its cameras for days fragments it.
+ * FixedString<N> holds up to N characters (plus the terminator) in place,
+ * so it lives on the stack or inside the camera table. Text that does not
+ * fit is cut and reported (assign() and format() return false).
+ *
+ * Comparisons take a pointer and a length, like std::string_view, so
+ * BLE values and advertisement fields can be compared without copying
+ * them into a terminated string first.
+ */
+
+#pragma once
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+template <size_t N>
+class FixedString {
+public:
+    FixedString() { text[0] = '\0'; }
+    FixedString(const char* value) { assign(value); }
+
+    static constexpr size_t capacity() { return N; }
+
+    const char* c_str() const { return text; }
+    size_t length() const { return used; }
+    bool empty() const { return used == 0; }
+
+    void clear() {
+        used = 0;
+        text[0] = '\0';
+    }
+
+    // False if value was cut to fit
+    bool assign(const char* value, size_t length) {
+        used = length < N ? length : N;
+        memcpy(text, value, used);
+        text[used] = '\0';
+        return used == length;
+    }
+
+    bool assign(const char* value) {
+        return assign(value, value != nullptr ? strlen(value) : 0);
+    }
+
+    // printf into the string; false if the result was cut
+    __attribute__((format(printf, 2, 3))) bool format(const char* format, ...) {
+        va_list args;
+        va_start(args, format);
+        int written = vsnprintf(text, N + 1, format, args);
+        va_end(args);
+        if (written < 0) {
+            clear();
+            return false;
+        }
+        used = (size_t)written < N ? (size_t)written : N;
+        return (size_t)written <= N;
+    }
+
+    bool equals(const char* value, size_t length) const {
+        return used == length && memcmp(text, value, length) == 0;
+    }
+
+    bool startsWith(const char* prefix, size_t length) const {
+        return used >= length && memcmp(text, prefix, length) == 0;
+    }
+
+    bool operator==(const char* value) const { return equals(value, strlen(value)); }
+    bool operator!=(const char* value) const { return !(*this == value); }
+
+    template <size_t M>
+    bool operator==(const FixedString<M>& other) const { return equals(other.c_str(), other.length()); }
+    template <size_t M>
+    bool operator!=(const FixedString<M>& other) const { return !(*this == other); }
+
+private:
+    char text[N + 1];
+    size_t used = 0;
+};
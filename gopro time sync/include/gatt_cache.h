@@ -0,0 +1,52 @@
+/**
+ * Per-camera GATT handle cache
+ *
+ * The GoPro WiFi AP characteristics sit at the same attribute handles on
+ * every connection to the same camera, so after the first full discovery
+ * their value handles are stored in NVS keyed by BLE address. On reconnect
+ * a single ranged characteristic discovery confirms the handles still
+ * point at the expected UUIDs, and all reads/writes then go straight to
+ * the handles without rebuilding NimBLE's service/characteristic tree.
+ */
+
+#pragma once
+
+#include <NimBLEDevice.h>
+
+// Value handles of the GoPro characteristics we use (0 = unknown). The
+// WiFi AP ones are required; the command channel is optional.
+struct GoProHandles {
+    uint16_t ssid;
+    uint16_t password;
+    uint16_t apEnable;
+    uint16_t apState;
+    uint16_t command;
+    uint16_t commandResponse;
+};
+
+// NVS storage, keyed by BLE address
+bool gattCacheLoad(const NimBLEAddress& address, GoProHandles& handles);
+bool gattCacheStore(const NimBLEAddress& address, const GoProHandles& handles);
+void gattCacheErase(const NimBLEAddress& address);
+
+// True if every known cached handle still holds the expected characteristic
+bool gattValidateHandles(NimBLEClient* pClient, const GoProHandles& handles);
+
+// Handle-level GATT access (retries once after securing the link on an
+// insufficient authentication/encryption error, like NimBLE's own readValue).
+// Reads into the caller's buffer; a value longer than capacity fails.
+bool gattReadHandle(NimBLEClient* pClient, uint16_t handle,
+                    uint8_t* value, size_t capacity, size_t& length);
+bool gattWriteHandle(NimBLEClient* pClient, uint16_t handle,
+                     const uint8_t* data, size_t length, bool response);
+
+// Notification from a subscribed value handle (runs on the NimBLE host task)
+typedef void (*GattNotifyCallback)(uint16_t connId, uint16_t handle,
+                                   const uint8_t* data, size_t length);
+
+// Find the CCCD that follows a value handle and enable notifications on it
+bool gattSubscribe(NimBLEClient* pClient, uint16_t handle, GattNotifyCallback callback);
+
+// Time one ATT write round trip on a subscribed handle by rewriting the
+// same value to its CCCD (no change on the camera side)
+bool gattProbe(NimBLEClient* pClient, uint16_t handle, uint32_t& rttUs);
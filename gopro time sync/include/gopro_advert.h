@@ -0,0 +1,49 @@
+/**
+ * Open GoPro advertisement data
+ *
+ * Besides the control service UUID (FEA6), a GoPro advertises manufacturer
+ * data under company ID 0x02F2: a schema version, camera status bits, the
+ * camera model ID, capability bits, a 6-byte hash that identifies the
+ * camera (derived from its serial number) and the media offload status.
+ *
+ * The data is read in place from the raw advertisement payload (the AD
+ * structures NimBLE keeps per advertiser), without a copy or a heap
+ * allocation, so the scan callback can afford it for every advertiser.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Camera status bits
+#define GOPRO_ADVERT_PROCESSOR_ON (1 << 0)   // Clear while the camera is asleep
+#define GOPRO_ADVERT_WIFI_AP_ON   (1 << 1)
+#define GOPRO_ADVERT_PAIRING      (1 << 2)   // Accepting a new pairing
+#define GOPRO_ADVERT_CENTRAL      (1 << 3)   // Connected to a peripheral (remote, ...)
+#define GOPRO_ADVERT_NEW_MEDIA    (1 << 4)   // Media not offloaded yet
+
+#define GOPRO_ADVERT_ID_HASH_LENGTH 6
+
+struct GoProAdvert {
+    uint8_t schema;            // Schema version, 0 = nothing parsed
+    uint8_t status;            // GOPRO_ADVERT_* bits
+    uint8_t cameraId;          // Model ID
+    uint8_t capabilities;
+    uint8_t idHash[GOPRO_ADVERT_ID_HASH_LENGTH];
+    uint8_t mediaOffload;
+};
+
+// GoPro manufacturer data in a raw advertisement payload: a pointer into
+// the payload just past the company ID, null if there is none. length
+// receives the number of bytes that follow.
+const uint8_t* goProAdvertFind(const uint8_t* payload, size_t payloadLength, size_t& length);
+
+// Local name (complete or shortened) in a raw advertisement payload: a
+// pointer into the payload, not terminated, null if there is none. Unlike
+// NimBLEAdvertisedDevice::getName() this does not copy it to the heap.
+const char* goProAdvertName(const uint8_t* payload, size_t payloadLength, size_t& length);
+
+// Parse the GoPro manufacturer data of a raw advertisement payload. False
+// (advert zeroed) if there is none or it is too short for the fields above.
+bool goProAdvertParse(const uint8_t* payload, size_t payloadLength, GoProAdvert& advert);
@@ -0,0 +1,40 @@
+/**
+ * GoPro BLE protocol constants shared by the sync modules
+ *
+ * UUIDs are NimBLEUUID objects parsed once at startup, so the connect path
+ * compares 128-bit values instead of formatting and comparing strings.
+ */
+
+#pragma once
+
+#include <NimBLEDevice.h>
+
+#include "fixed_string.h"
+
+// GoPro WiFi Access Point service and its characteristics
+extern const NimBLEUUID GOPRO_WIFI_AP_SERVICE_UUID;
+extern const NimBLEUUID GOPRO_WIFI_SSID_UUID;
+extern const NimBLEUUID GOPRO_WIFI_PASSWORD_UUID;
+extern const NimBLEUUID GOPRO_WIFI_AP_ENABLE_UUID;
+extern const NimBLEUUID GOPRO_WIFI_AP_STATE_UUID;
+
+// GoPro control service: command channel (GP-0072) and its responses (GP-0073)
+extern const NimBLEUUID GOPRO_CONTROL_SERVICE_UUID;
+extern const NimBLEUUID GOPRO_COMMAND_UUID;
+extern const NimBLEUUID GOPRO_COMMAND_RESPONSE_UUID;
+
+// Bluetooth SIG company identifier of GoPro, leading its manufacturer data
+#define GOPRO_COMPANY_ID 0x02F2
+
+// True for a GoPro advertisement: GoPro manufacturer data, the control
+// service UUID (FEA6), or failing both a "GoPro" name. Cheap enough for the
+// scan callback, which sees every advertiser in range.
+bool goProIsAdvertisement(NimBLEAdvertisedDevice* device);
+
+// "xx:xx:xx:xx:xx:xx", without the heap string NimBLEAddress::toString() returns
+typedef FixedString<17> BleAddressText;
+BleAddressText goProAddressText(const NimBLEAddress& address);
+
+// NVS key for per-camera records: the 12 hex digits of the BLE address
+// (NVS keys are limited to 15 characters, leaving room for a suffix)
+void goProAddressKey(const NimBLEAddress& address, char key[16], char suffix = '\0');
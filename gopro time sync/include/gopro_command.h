@@ -0,0 +1,56 @@
+/**
+ * Open GoPro commands over BLE
+ *
+ * A command is written to GP-0072 as one packet: a general (5-bit length)
+ * header byte, the command ID and its parameters as a length-prefixed
+ * value. The camera answers with a notification on GP-0073 that echoes the
+ * command ID followed by a status byte (0 = success) and, for queries,
+ * the length-prefixed result.
+ */
+
+#pragma once
+
+#include <NimBLEDevice.h>
+
+#include "gatt_cache.h"
+
+#define GOPRO_CMD_SET_DATE_TIME 0x0D
+#define GOPRO_CMD_SET_DATE_TIME_LENGTH 10
+#define GOPRO_CMD_GET_DATE_TIME 0x0E
+#define GOPRO_CMD_RESPONSE_TIMEOUT_MS 2000
+
+enum GoProCommandResult {
+    GOPRO_CMD_OK,
+    GOPRO_CMD_REJECTED,        // Camera answered with a non-zero status
+    GOPRO_CMD_NO_RESPONSE,     // No answer within GOPRO_CMD_RESPONSE_TIMEOUT_MS
+    GOPRO_CMD_UNAVAILABLE,     // No command characteristics, or subscribe/write failed
+};
+
+struct GoProDateTime {
+    uint16_t year;
+    uint8_t month;
+    uint8_t day;
+    uint8_t hour;
+    uint8_t minute;
+    uint8_t second;
+};
+
+const char* goProCommandResultName(GoProCommandResult result);
+
+// Subscribe to command responses; once per connection, before sending
+bool goProCommandBegin(NimBLEClient* pClient, const GoProHandles& handles);
+
+// Set Date/Time (0x0D): year big-endian, then month, day, hour, minute, second
+void goProBuildSetDateTime(uint8_t packet[GOPRO_CMD_SET_DATE_TIME_LENGTH],
+                           uint16_t year, uint8_t month, uint8_t day,
+                           uint8_t hour, uint8_t minute, uint8_t second);
+
+// Send a prebuilt single-packet command and wait for the response to its
+// command ID. writeRttUs (optional) receives the ATT write round trip.
+GoProCommandResult goProSendCommand(NimBLEClient* pClient, const GoProHandles& handles,
+                                    const uint8_t* packet, size_t length,
+                                    uint32_t* writeRttUs = nullptr);
+
+// Get Date/Time (0x0E): the camera's clock, same layout as Set Date/Time
+GoProCommandResult goProGetDateTime(NimBLEClient* pClient, const GoProHandles& handles,
+                                    GoProDateTime& value);
@@ -0,0 +1,88 @@
+/**
+ * Keep-alive HTTP session to the camera
+ *
+ * A GoPro serves its HTTP API at 10.5.5.9 on its own AP. HTTPClient opened
+ * a TCP connection per request, so a handshake stood between the send slot
+ * and the set-time request, and it parsed every response into a String.
+ * The session instead keeps one connection open for the requests of a
+ * sync: the set, the clock read-backs and any other command. A request is
+ * formatted into a fixed buffer before it is due and written to the socket
+ * in one go. Of the response only the status line, Content-Length,
+ * Connection and (when asked for) one field of the body are looked at; the
+ * rest is read and dropped, so a request allocates nothing.
+ *
+ * The set-time request is not formatted at all: a compile-time template of
+ * the whole request is copied once, and each set only patches the date and
+ * time digits in place from small lookup tables.
+ *
+ * The station is on one camera's AP at a time, so there is one session. It
+ * is closed when the station leaves the AP. A request is never resent: a
+ * timed set sent late would carry a stale second, so the caller checks the
+ * session ahead of the send slot (goProHttpConnected(), goProHttpOpen())
+ * and handles a failed send itself.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define GOPRO_HTTP_HOST "10.5.5.9"
+#define GOPRO_HTTP_PORT 80
+#define GOPRO_HTTP_TIMEOUT_MS 2000     // Whole response, status line to the end of the body
+#define GOPRO_HTTP_REQUEST_MAX 160     // Request line and headers
+#define GOPRO_HTTP_LINE_MAX 96         // Status and header lines (longer ones are cut)
+
+#define GOPRO_HTTP_ERROR_CONNECT (-1)  // No connection to the camera
+#define GOPRO_HTTP_ERROR_SEND (-2)     // Request not written in full
+#define GOPRO_HTTP_ERROR_RESPONSE (-3) // Timed out, closed early, or kept alive with no body length
+
+// A GET request, ready to be written
+struct GoProHttpRequest {
+    char text[GOPRO_HTTP_REQUEST_MAX];
+    uint16_t length;
+};
+
+// Set date/time endpoints
+enum GoProHttpDateTimeForm : uint8_t {
+    GOPRO_HTTP_DATE_TIME_LEGACY = 0,  // /gp/gpControl/command/setup/date_time?p=%YY%MM%DD%HH%MM%SS (hex)
+    GOPRO_HTTP_DATE_TIME_OPEN_GOPRO,  // /gopro/camera/set_date_time?date=YYYY_MM_DD&time=HH_MM_SS
+};
+
+// When the request went out and the status line came back (micros())
+struct GoProHttpTiming {
+    uint32_t sentUs;
+    uint32_t receivedUs;
+};
+
+// Format a GET of path; false if it does not fit
+bool goProHttpPrepare(GoProHttpRequest& request, const char* path);
+
+// Copy the set date/time request template of form into request
+void goProHttpPrepareDateTime(GoProHttpRequest& request, GoProHttpDateTimeForm form);
+
+// Patch a date and time (years 2000-2099) into a request prepared by
+// goProHttpPrepareDateTime() for the same form
+void goProHttpPatchDateTime(GoProHttpRequest& request, GoProHttpDateTimeForm form, uint16_t year,
+                            uint8_t month, uint8_t day, uint8_t hour, uint8_t minute, uint8_t second);
+
+// Connect unless the session is already open; false if the camera cannot
+// be reached
+bool goProHttpOpen();
+void goProHttpClose();
+
+// The session is open and the camera has not closed it
+bool goProHttpConnected();
+
+// Send a prepared request on the session (connecting first if needed) and
+// read the response, once; a failed exchange closes the session. Returns the HTTP status, or a GOPRO_HTTP_ERROR_*. If
+// field is given, the body text that follows it, up to the next '"', is
+// copied into value (cut to valueCapacity - 1 characters; empty if the
+// field is missing).
+int goProHttpSend(const GoProHttpRequest& request, GoProHttpTiming* timing = nullptr,
+                  const char* field = nullptr, char* value = nullptr, size_t valueCapacity = 0);
+
+// Round trip to the camera, timed on a TCP handshake of its own (a request
+// would add the camera's processing time). Opens the session too, so the
+// set that follows does not wait for a handshake.
+bool goProHttpProbe(uint32_t& rttUs);
@@ -0,0 +1,47 @@
+/**
+ * Per-camera one-way latency estimates for the set-time request
+ *
+ * Each transport (BLE command write, HTTP GET) gets an exponentially
+ * weighted mean and variance of the one-way delay, fed by RTT probes taken
+ * while waiting for the send slot and by the set-time request itself. The
+ * mean decides how far ahead of the RTC second edge the request is sent;
+ * the spread shows how tight the alignment can be for that camera.
+ *
+ * Serial diagnostics (see handleSerialCommands() in main.cpp):
+ *   'l' - per-camera estimates as CSV
+ */
+
+#pragma once
+
+#include <NimBLEDevice.h>
+#include <stdint.h>
+
+#define LINK_MAX_CAMERAS 12        // Cameras tracked (CAMERA_MAX); the oldest slot is reused
+#define LINK_EWMA_SHIFT 3          // Weight of a new sample = 1/8
+
+enum LinkTransport : uint8_t {
+    LINK_BLE = 0,
+    LINK_HTTP,
+    LINK_TRANSPORT_COUNT
+};
+
+struct LinkEstimate {
+    uint32_t samples;          // Since boot
+    uint32_t oneWayUs;         // Weighted mean
+    uint32_t stddevUs;         // Square root of the weighted variance
+    uint64_t varianceUs2;
+};
+
+// Fold one one-way delay sample into the camera's estimate
+void linkLatencyAddSample(const NimBLEAddress& address, LinkTransport transport, uint32_t oneWayUs);
+
+// Current estimate; false if the camera has no samples for the transport
+bool linkLatencyGet(const NimBLEAddress& address, LinkTransport transport, LinkEstimate& estimate);
+
+// Mean one-way delay, or defaultUs before the first sample
+uint32_t linkLatencyOneWay(const NimBLEAddress& address, LinkTransport transport, uint32_t defaultUs);
+
+const char* linkTransportName(LinkTransport transport);
+
+// Serial dump
+void linkLatencyDump();
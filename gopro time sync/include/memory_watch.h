@@ -0,0 +1,67 @@
+/**
+ * Heap and stack telemetry
+ *
+ * Units left on for days need their memory watched: a slow leak in the
+ * reconnect path (ours, NimBLE's or the WiFi stack's) only shows as a
+ * reboot much later. Free heap, the largest free block (fragmentation),
+ * the lowest free heap since boot and the stack high-water marks of the
+ * engine, log and NimBLE host tasks are sampled as each sync cycle ends
+ * and every MEMORY_SAMPLE_INTERVAL_MS in between, into a fixed-size
+ * window tagged with the sync cycle count.
+ *
+ * A least-squares slope of the free heap over the last MEMORY_TREND_CYCLES
+ * cycle-end samples raises an alarm (a log warning) when it falls faster
+ * than MEMORY_LEAK_BYTES_PER_CYCLE; a task whose stack high-water mark
+ * drops below MEMORY_STACK_LOW_BYTES is warned about once.
+ *
+ * Serial diagnostics (see handleSerialCommands() in main.cpp):
+ *   'm' - recent memory samples and the trend as CSV
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#define MEMORY_WINDOW 32                  // Samples kept for the dump
+#define MEMORY_SAMPLE_INTERVAL_MS 60000   // Periodic sample between sync cycles
+#define MEMORY_TREND_CYCLES 8             // Cycle-end samples the trend is fitted to
+#define MEMORY_LEAK_BYTES_PER_CYCLE 64    // Alarm when free heap falls faster than this
+#define MEMORY_STACK_LOW_BYTES 512        // Warn when a task's stack headroom drops below this
+
+enum MemoryTask : uint8_t {
+    MEMORY_TASK_LOOP = 0,      // Arduino loop(): the engine
+    MEMORY_TASK_LOG,           // Serial log drain task
+    MEMORY_TASK_NIMBLE,        // NimBLE host task (GATT/GAP callbacks)
+    MEMORY_TASK_COUNT
+};
+
+struct MemorySample {
+    uint32_t cycle;            // Sync cycles finished when the sample was taken
+    uint32_t uptimeMs;
+    uint32_t freeHeap;
+    uint32_t largestBlock;     // Largest block that can be allocated
+    uint32_t minFreeHeap;      // Lowest free heap since boot
+    uint32_t stackFree[MEMORY_TASK_COUNT];  // Least free stack since the task started, 0 = not found
+    bool cycleEnd;             // Taken as a sync cycle ended (else periodic)
+};
+
+struct MemoryStatus {
+    uint32_t cycles;           // Sync cycles finished since boot
+    uint32_t alarms;           // Downward free heap trends reported
+    int32_t slopeBytes;        // Free heap change per cycle over the trend window (0 until it is full)
+    uint32_t minFreeHeap;
+    uint32_t minStackFree[MEMORY_TASK_COUNT];
+};
+
+// A sync cycle (successful or not) ended: sample, update the trend
+void memoryWatchCycle();
+
+// Periodic sample; call from loop()
+void memoryWatchPoll();
+
+void memoryWatchStatus(MemoryStatus& status);
+
+const char* memoryTaskName(MemoryTask task);
+
+// Serial dump
+void memoryWatchDump();
@@ -0,0 +1,45 @@
+/**
+ * Paired cameras
+ *
+ * The GoPros this unit has connected to (bonded with) are kept in NVS:
+ * their BLE address and the ID hash from their advertisement (derived from
+ * the serial number). Every paired address is also put on the controller's
+ * whitelist, so scans for the rig (see startScan() in main.cpp) can use the
+ * whitelist filter policy: the radio drops every other advertiser, other
+ * crews' GoPros included, before the host sees it. A GoPro that is not
+ * paired is only taken when it advertises pairing mode (Connect Device on
+ * the camera), or, while nothing is paired yet, when it sends no Open
+ * GoPro advertisement data to tell.
+ *
+ * The controller whitelist cannot change while a scan uses it: add and
+ * forget cameras only while no scan is running.
+ *
+ * Serial diagnostics (see handleSerialCommands() in main.cpp):
+ *   'p' - paired cameras as CSV
+ *   'f' - forget every paired camera
+ */
+
+#pragma once
+
+#include <NimBLEDevice.h>
+
+#include "gopro_advert.h"
+
+#define PAIRED_CAMERA_MAX 12       // Controller whitelist entries (same as CAMERA_MAX)
+
+// Load the list from NVS and put it on the controller whitelist
+void pairedCamerasBegin();
+
+uint8_t pairedCameraCount();
+
+// Safe to call from the scan callback (NimBLE host task)
+bool pairedCameraKnown(const NimBLEAddress& address);
+
+// Store a camera and whitelist it; false if the list is full
+bool pairedCameraAdd(const NimBLEAddress& address, const GoProAdvert& advert);
+
+// Drop every camera from NVS and the whitelist
+void pairedCamerasForget();
+
+// Serial dump
+void pairedCamerasDump();
@@ -0,0 +1,29 @@
+/**
+ * DS3231 second edges
+ *
+ * The DS3231 SQW pin is switched to its 1 Hz square wave, whose falling
+ * edge marks the start of each RTC second. A GPIO interrupt timestamps the
+ * edges with micros(), so the sync path knows where the RTC second
+ * boundaries fall on the local clock and can transmit a request timed to
+ * land on one, instead of anywhere inside the second that rtc.now()
+ * happened to return.
+ */
+
+#pragma once
+
+#include <RTClib.h>
+
+#define RTC_SQW_PIN 4                // DS3231 SQW (open drain, needs the pull-up)
+#define RTC_EDGE_MAX_AGE_US 1500000  // Older last edge = SQW not wired or stalled
+
+// Enable the 1 Hz output and the edge interrupt
+void rtcEdgeBegin(RTC_DS3231& rtc);
+
+// Read the RTC together with the micros() timestamp of the edge that
+// started the second it returned. False if there is no recent edge, in
+// which case callers fall back to unaligned sends.
+bool rtcReadAtEdge(RTC_DS3231& rtc, DateTime& second, uint32_t& edgeUs);
+
+// Sleep until micros() reaches targetUs: delay() for the bulk, then a short
+// busy wait for the last millisecond
+void rtcSleepUntil(uint32_t targetUs);
@@ -0,0 +1,267 @@
+/**
+ * Asynchronous serial log
+ *
+ * Serial.printf() blocks until the last byte of its line is in the UART's
+ * 128-byte TX FIFO, about 87 us a byte at 115200 baud, so a burst of log
+ * lines held up BLE discovery, the WiFi join and the set-time slot for
+ * tens to hundreds of milliseconds. The LOG_* macros instead store a record
+ * in a lock-free ring: the message ID, the format string's address and the
+ * arguments in binary (integers and doubles as they are, strings copied,
+ * since they are usually temporaries). A low-priority drain task formats
+ * the records and writes them to Serial, so only it waits for the UART.
+ *
+ * Every message names its subsystem, which the drain task prints as the
+ * line's prefix:
+ *
+ *   LOG_INFO(WIFI, "Connected! IP: %s", ip);   ->   [WiFi] Connected! IP: ...
+ *
+ * Each subsystem has its own level (LOG_BLE_LEVEL, LOG_WIFI_LEVEL, ...,
+ * defaulting to LOG_LEVEL); messages above it compile to nothing, arguments
+ * included.
+ *
+ * The message ID is a hash of the format string worked out by the compiler,
+ * which is why the format must be a string literal. With LOG_INTERNED set
+ * (-D LOG_INTERNED=1) the format strings are not linked in at all: the
+ * drain task sends each record as a small binary frame (ID, subsystem,
+ * level, arguments) and scripts/log_decode.py, which hashes the LOG_* calls
+ * in the sources the same way, turns the frames back into lines on the PC.
+ * That leaves the message text out of flash and the formatting off the
+ * ESP32 altogether.
+ *
+ * Any task may log (the ring is multi-producer); only the drain task reads
+ * it. A record that finds the ring full is dropped and counted, and the
+ * count is printed with the next record that fits.
+ *
+ * The CSV dumps behind the serial diagnostic keys still write to Serial
+ * directly, as text in either mode: they are asked for, and not on any
+ * sync path.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+#include <type_traits>
+
+#define LOG_LEVEL_NONE  0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN  2
+#define LOG_LEVEL_INFO  3
+#define LOG_LEVEL_DEBUG 4          // Per-service/characteristic discovery output
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+#define LOG_RING_RECORDS 64        // Queued records (power of two)
+#define LOG_MAX_ARGS 12            // Arguments per record
+#define LOG_ARG_BYTES 96           // Argument storage per record (long strings are cut)
+#define LOG_LINE_LENGTH 192        // Formatted line, longer ones are cut
+#define LOG_DRAIN_PERIOD_MS 10     // Drain task sleep when the ring is empty
+#define LOG_DRAIN_PRIORITY 1       // Just above idle: runs when the engine and NimBLE sleep
+
+#ifndef LOG_INTERNED
+#define LOG_INTERNED 0             // 1: send binary frames for scripts/log_decode.py
+#endif
+
+#define LOG_FRAME_MAGIC 0xA5       // First byte of an interned record's frame
+
+// Subsystems: name and line prefix. scripts/log_decode.py reads this list,
+// keep one entry per line.
+#define LOG_TAGS(TAG) \
+    TAG(APP, "") \
+    TAG(BLE, "[BLE]") \
+    TAG(WIFI, "[WiFi]") \
+    TAG(HTTP, "[HTTP]") \
+    TAG(RTC, "[RTC]") \
+    TAG(RECONNECT, "[RECONNECT]") \
+    TAG(SYNC, "[SYNC]") \
+    TAG(VERIFY, "[VERIFY]") \
+    TAG(CAM, "[CAM]") \
+    TAG(NVS, "[NVS]") \
+    TAG(BUZZER, "[BUZZER]") \
+    TAG(MEM, "[MEM]")
+
+// Per-subsystem levels
+#ifndef LOG_APP_LEVEL
+#define LOG_APP_LEVEL LOG_LEVEL    // Banners and the no-GoPro help text
+#endif
+#ifndef LOG_BLE_LEVEL
+#define LOG_BLE_LEVEL LOG_LEVEL
+#endif
+#ifndef LOG_WIFI_LEVEL
+#define LOG_WIFI_LEVEL LOG_LEVEL
+#endif
+#ifndef LOG_HTTP_LEVEL
+#define LOG_HTTP_LEVEL LOG_LEVEL
+#endif
+#ifndef LOG_RTC_LEVEL
+#define LOG_RTC_LEVEL LOG_LEVEL
+#endif
+#ifndef LOG_RECONNECT_LEVEL
+#define LOG_RECONNECT_LEVEL LOG_LEVEL
+#endif
+#ifndef LOG_SYNC_LEVEL
+#define LOG_SYNC_LEVEL LOG_LEVEL
+#endif
+#ifndef LOG_VERIFY_LEVEL
+#define LOG_VERIFY_LEVEL LOG_LEVEL
+#endif
+#ifndef LOG_CAM_LEVEL
+#define LOG_CAM_LEVEL LOG_LEVEL
+#endif
+#ifndef LOG_NVS_LEVEL
+#define LOG_NVS_LEVEL LOG_LEVEL
+#endif
+#ifndef LOG_BUZZER_LEVEL
+#define LOG_BUZZER_LEVEL LOG_LEVEL
+#endif
+#ifndef LOG_MEM_LEVEL
+#define LOG_MEM_LEVEL LOG_LEVEL
+#endif
+
+#define LOG_ERROR(tag, ...) LOG_AT(tag, LOG_LEVEL_ERROR, __VA_ARGS__)
+#define LOG_WARN(tag, ...)  LOG_AT(tag, LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_INFO(tag, ...)  LOG_AT(tag, LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_DEBUG(tag, ...) LOG_AT(tag, LOG_LEVEL_DEBUG, __VA_ARGS__)
+
+#define LOG_AT(tag, level, format, ...) do { \
+    if (logEnabled(LOG_TAG_##tag, level)) { \
+        logWrite(LOG_TAG_##tag, level, std::integral_constant<uint32_t, logHash(format)>::value, \
+                 LOG_INTERNED ? nullptr : format, ##__VA_ARGS__); \
+    } \
+} while (0)
+
+#define LOG_TAG_ENUM(name, prefix) LOG_TAG_##name,
+enum LogTag : uint8_t {
+    LOG_TAGS(LOG_TAG_ENUM)
+    LOG_TAG_COUNT
+};
+#undef LOG_TAG_ENUM
+
+#define LOG_TAG_LEVEL(name, prefix) LOG_##name##_LEVEL,
+constexpr uint8_t LOG_TAG_LEVELS[LOG_TAG_COUNT] = {LOG_TAGS(LOG_TAG_LEVEL)};
+#undef LOG_TAG_LEVEL
+
+constexpr bool logEnabled(LogTag tag, uint8_t level) {
+    return level <= LOG_TAG_LEVELS[tag];
+}
+
+// 32-bit FNV-1a of the format string: the message ID
+constexpr uint32_t logHash(const char* text, uint32_t hash = 2166136261u) {
+    return *text == '\0' ? hash : logHash(text + 1, (hash ^ (uint8_t)*text) * 16777619u);
+}
+
+enum LogArgType : uint8_t {
+    LOG_ARG_INT32,
+    LOG_ARG_UINT32,
+    LOG_ARG_INT64,
+    LOG_ARG_UINT64,
+    LOG_ARG_DOUBLE,
+    LOG_ARG_STRING,            // Length byte, then the characters (no terminator)
+};
+
+// One ring slot. sequence tells producers and the drain task whose turn
+// the slot is (see src/serial_log.cpp).
+struct LogRecord {
+    std::atomic<uint32_t> sequence;
+    uint32_t id;               // logHash() of the format
+    const char* format;        // printf format, without the trailing newline; null if interned
+    uint8_t tag;
+    uint8_t level;
+    uint8_t argCount;
+    uint8_t length;            // Bytes of args used
+    uint8_t types[LOG_MAX_ARGS];
+    uint8_t args[LOG_ARG_BYTES];
+};
+
+// Start the drain task (Serial must be up)
+void logBegin();
+
+// Print every queued record, as a line or (LOG_INTERNED) a frame. Only
+// the drain task calls this.
+void logDrain();
+
+// Records dropped because the ring was full, since boot
+uint32_t logDropped();
+
+// Claim the next free slot (null, and counted as dropped, if the ring is
+// full) and hand it to the drain task once filled
+LogRecord* logReserve();
+void logCommit(LogRecord* record);
+
+// Argument encoding for logWrite()
+inline void logPutBytes(LogRecord* record, LogArgType type, const void* data, size_t length) {
+    if (record->argCount >= LOG_MAX_ARGS || record->length + length > LOG_ARG_BYTES) {
+        return;
+    }
+    record->types[record->argCount++] = type;
+    memcpy(record->args + record->length, data, length);
+    record->length += length;
+}
+
+template <typename T>
+inline typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type
+logPut(LogRecord* record, T value) {
+    if (sizeof(T) <= 4) {
+        if (std::is_signed<T>::value) {
+            int32_t v = (int32_t)value;
+            logPutBytes(record, LOG_ARG_INT32, &v, sizeof(v));
+        } else {
+            uint32_t v = (uint32_t)value;
+            logPutBytes(record, LOG_ARG_UINT32, &v, sizeof(v));
+        }
+    } else if (std::is_signed<T>::value) {
+        int64_t v = (int64_t)value;
+        logPutBytes(record, LOG_ARG_INT64, &v, sizeof(v));
+    } else {
+        uint64_t v = (uint64_t)value;
+        logPutBytes(record, LOG_ARG_UINT64, &v, sizeof(v));
+    }
+}
+
+inline void logPut(LogRecord* record, double value) {
+    logPutBytes(record, LOG_ARG_DOUBLE, &value, sizeof(value));
+}
+
+inline void logPut(LogRecord* record, const char* value) {
+    if (record->argCount >= LOG_MAX_ARGS || record->length + 1 > LOG_ARG_BYTES) {
+        return;
+    }
+    size_t room = LOG_ARG_BYTES - record->length - 1;
+    // Scanned by hand: strnlen with a bound past a short array's end trips
+    // -Wstringop-overread, though it stops at the terminator
+    size_t length = 0;
+    while (value != nullptr && length < room && value[length] != '\0') {
+        length++;
+    }
+    record->types[record->argCount++] = LOG_ARG_STRING;
+    record->args[record->length++] = (uint8_t)length;
+    memcpy(record->args + record->length, value, length);
+    record->length += length;
+}
+
+inline void logPutAll(LogRecord* record) { (void)record; }
+
+template <typename T, typename... Rest>
+inline void logPutAll(LogRecord* record, T value, Rest... rest) {
+    logPut(record, value);
+    logPutAll(record, rest...);
+}
+
+// Queue a printf-style line (use the LOG_* macros). Never blocks.
+template <typename... Args>
+void logWrite(LogTag tag, uint8_t level, uint32_t id, const char* format, Args... args) {
+    LogRecord* record = logReserve();
+    if (record == nullptr) {
+        return;
+    }
+    record->id = id;
+    record->format = format;
+    record->tag = tag;
+    record->level = level;
+    record->argCount = 0;
+    record->length = 0;
+    logPutAll(record, args...);
+    logCommit(record);
+}
@@ -0,0 +1,38 @@
+/**
+ * Static station address on the GoPro AP
+ *
+ * The GoPro AP is always 10.5.5.0/24 with the camera at 10.5.5.9, so the
+ * sync unit can skip DHCP and be reachable the moment it associates. The
+ * address comes from a pool above the camera's DHCP range, and the MAC
+ * picks the start of the search, so several sync units joining the same
+ * camera normally choose different addresses. The remaining collisions
+ * are caught before the address is taken: the station associates without
+ * an address (staticIPHold()), sends an RFC 5227 ARP probe (sender IP
+ * 0.0.0.0) for the candidate, and only applies it if no other host claims
+ * it. An announcement from the candidate itself would overwrite the
+ * camera's ARP entry for a unit already holding it.
+ */
+
+#pragma once
+
+#include <WiFi.h>
+
+#define STATIC_IP_POOL_START 200     // 10.5.5.200 ...
+#define STATIC_IP_POOL_SIZE 50       // ... 10.5.5.249
+#define STATIC_IP_ATTEMPTS 3         // Candidates tried before falling back to DHCP
+#define ARP_PROBE_WAIT_MS 150        // Time allowed for another host to answer a probe
+
+// Candidate address for this unit (attempt 0 = preferred)
+IPAddress staticIPCandidate(uint8_t attempt);
+
+// Switch the station interface to a static address / back to DHCP
+bool staticIPApply(const IPAddress& ip);
+bool staticIPRelease();
+
+// Keep the station without an address (no DHCP client) once it associates;
+// call after WiFi.begin(), which restarts DHCP
+bool staticIPHold();
+
+// ARP probe from the address-less station: inUse is set if another host
+// claims ip. False if the probe could not be sent.
+bool staticIPProbe(const IPAddress& ip, bool& inUse);
@@ -0,0 +1,69 @@
+/**
+ * Sync pipeline latency tracing
+ *
+ * Records microsecond start/end timestamps for every phase of a sync and
+ * keeps a rolling window of successful durations per phase, from which
+ * min/p50/p95/max are computed on demand; failed spans are only counted. All storage is fixed-size and static.
+ *
+ * Serial diagnostics (see handleSerialCommands() in main.cpp):
+ *   't' - per-phase latency table as CSV
+ *   'e' - recent phase start/end events as CSV
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#define TRACE_WINDOW 32        // Successful samples kept per phase for percentiles
+#define TRACE_EVENT_LOG 64     // Start/end events kept for the event dump
+
+enum TracePhase : uint8_t {
+    TRACE_SCAN = 0,
+    TRACE_CONNECT,
+    TRACE_READ_SSID,
+    TRACE_READ_PASSWORD,
+    TRACE_ENABLE_AP,
+    TRACE_WAIT_AP,
+    TRACE_WIFI_JOIN,
+    TRACE_ALIGN,               // Wait for the RTC second edge until the timed send
+    TRACE_SET_TIME,
+    TRACE_VERIFY,              // Read-back of the camera clock after the set
+    TRACE_TIME_TO_SYNC,        // Whole cycle: scan start until the camera clock is set
+    TRACE_PHASE_COUNT
+};
+
+struct TraceStats {
+    uint32_t count;            // Completed spans since boot
+    uint32_t failures;         // Spans that ended unsuccessfully
+    uint32_t minUs;            // Over the rolling window of successful spans (0 if none)
+    uint32_t p50Us;
+    uint32_t p95Us;
+    uint32_t maxUs;
+};
+
+// Raw API
+void traceBegin(TracePhase phase);
+void traceEnd(TracePhase phase, bool ok);
+// Span with an explicit start, for phases that overlap across cameras
+void traceRecord(TracePhase phase, uint32_t startUs, bool ok);
+const char* tracePhaseName(TracePhase phase);
+bool traceGetStats(TracePhase phase, TraceStats& stats);
+
+// Serial dumps
+void traceDumpStats();
+void traceDumpEvents();
+
+// Scoped span: records a failure unless ok() is called before it goes out of scope
+class TraceSpan {
+public:
+    explicit TraceSpan(TracePhase phase) : phase(phase) { traceBegin(phase); }
+    ~TraceSpan() { traceEnd(phase, succeeded); }
+    void ok() { succeeded = true; }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    TracePhase phase;
+    bool succeeded = false;
+};
@@ -0,0 +1,158 @@
+/**
+ * Host fake of the Arduino core API used by the firmware (native build only)
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <string>
+
+#include "SimGoPro.h"
+
+#define HIGH 0x1
+#define LOW  0x0
+#define INPUT  0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+
+#define RISING  0x01
+#define FALLING 0x02
+
+#define IRAM_ATTR
+
+// FreeRTOS subset. The simulation is single-threaded: blocking waits run
+// pending sim events (radio callbacks) until satisfied or timed out, so a
+// task notification is just a counter.
+typedef void* TaskHandle_t;
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+#define pdTRUE  1
+#define pdFALSE 0
+#define portMAX_DELAY 0xffffffffUL
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+TaskHandle_t xTaskGetCurrentTaskHandle();
+void xTaskNotifyGive(TaskHandle_t task);
+uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticksToWait);
+
+// Tasks other than loop() do not run; the native runner stands in for
+// them (see sim_main.cpp)
+typedef void (*TaskFunction_t)(void*);
+#define tskNO_AFFINITY 0x7fffffff
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task, const char* name, uint32_t stackDepth,
+                                   void* parameters, uint32_t priority, TaskHandle_t* created,
+                                   BaseType_t coreId);
+void vTaskDelay(TickType_t ticks);
+
+// loopTask, nimble_host and the created tasks. Stack use is not modelled:
+// every task reports half its stack as its high-water mark.
+TaskHandle_t xTaskGetHandle(const char* name);
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+
+typedef uint32_t EventBits_t;
+typedef struct SimEventGroup* EventGroupHandle_t;
+
+EventGroupHandle_t xEventGroupCreate();
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits);
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits);
+EventBits_t xEventGroupGetBits(EventGroupHandle_t group);
+BaseType_t xEventGroupSetBitsFromISR(EventGroupHandle_t group, EventBits_t bits,
+                                     BaseType_t* higherPriorityTaskWoken);
+#define portYIELD_FROM_ISR(woken) ((void)(woken))
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bitsToWaitFor,
+                                BaseType_t clearOnExit, BaseType_t waitForAllBits,
+                                TickType_t ticksToWait);
+
+// Spinlock critical sections (nothing runs concurrently here)
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED 0
+#define portENTER_CRITICAL(mux) ((void)(mux))
+#define portEXIT_CRITICAL(mux) ((void)(mux))
+
+// Timing (virtual clock)
+unsigned long millis();
+uint32_t micros();                 // 32-bit like the ESP32, wraps every ~71 min
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+
+// GPIO
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+#define digitalPinToInterrupt(pin) (pin)
+void attachInterrupt(uint8_t pin, void (*isr)(), int mode);
+void detachInterrupt(uint8_t pin);
+
+namespace sim {
+// Drive an edge on a GPIO: runs the ISR attached for that edge, if any
+void raiseInterrupt(uint8_t pin, int edge);
+
+// Serial writes made on behalf of another task (the runner standing in for
+// it) use the UART but do not hold up the firmware
+extern bool serialFromOtherTask;
+
+// Time the firmware spent blocked in Serial writes
+extern uint64_t serialBlockedUs;
+}
+
+// Subset of Arduino String
+class String {
+public:
+    String() {}
+    String(const char* s) : value(s ? s : "") {}
+    String(const std::string& s) : value(s) {}
+
+    const char* c_str() const { return value.c_str(); }
+    unsigned int length() const { return (unsigned int)value.size(); }
+
+    bool startsWith(const String& prefix) const {
+        return value.compare(0, prefix.value.size(), prefix.value) == 0;
+    }
+    bool equalsIgnoreCase(const String& other) const {
+        return value.size() == other.value.size() &&
+               strcasecmp(value.c_str(), other.value.c_str()) == 0;
+    }
+    bool operator==(const String& other) const { return value == other.value; }
+    bool operator!=(const String& other) const { return value != other.value; }
+    String& operator+=(const String& other) { value += other.value; return *this; }
+
+private:
+    std::string value;
+};
+
+// Serial port: writes to stdout when sim::verbose is set. Like UART0 at
+// 115200 baud with no TX ring buffer (the Arduino core's default), a write
+// returns once its last byte is in the 128-byte hardware FIFO.
+class HardwareSerial {
+public:
+    void begin(unsigned long baud) { (void)baud; }
+    size_t print(const char* s);
+    size_t println(const char* s = "");
+    size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+    size_t write(const uint8_t* data, size_t length);
+    int available() { return 0; }
+    int read() { return -1; }
+};
+
+extern HardwareSerial Serial;
+
+// Thrown by ESP.restart(); the native runner catches it and re-runs setup()
+struct SimRestart {};
+
+// Heap figures come from the firmware's allocations (see sim/SimHeap.cpp);
+// fragmentation is not modelled, so the largest block is all of it
+class EspClass {
+public:
+    [[noreturn]] void restart();
+    uint32_t getHeapSize();
+    uint32_t getFreeHeap();
+    uint32_t getMinFreeHeap();
+    uint32_t getMaxAllocHeap();
+};
+
+extern EspClass ESP;
@@ -0,0 +1,369 @@
+/**
+ * Host fake of the NimBLE-Arduino 1.4 API used by the firmware (native build only)
+ *
+ * Every call that would go over the air advances the virtual clock by the
+ * matching sim::latency range and talks to the camera at the peer address.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "SimGoPro.h"
+
+// --- NimBLE host C API subset (pulled in by the real NimBLEDevice.h) -------
+
+#define BLE_HS_ENOTCONN                  7
+#define BLE_HS_EDONE                     14
+#define BLE_HS_ERR_ATT_BASE              0x100
+#define BLE_ATT_ERR_INVALID_HANDLE       0x01
+#define BLE_ATT_ERR_INSUFFICIENT_AUTHEN  0x05
+#define BLE_ATT_ERR_INSUFFICIENT_ENC     0x0f
+
+#define BLE_GATT_CHR_PROP_READ           0x02
+#define BLE_GATT_CHR_PROP_WRITE_NO_RSP   0x04
+#define BLE_GATT_CHR_PROP_WRITE          0x08
+#define BLE_GATT_CHR_PROP_NOTIFY         0x10
+
+#define BLE_ATT_UUID_PRIMARY_SERVICE     0x2800
+#define BLE_ATT_UUID_CHARACTERISTIC      0x2803
+#define BLE_GATT_DSC_CLT_CFG_UUID16      0x2902
+
+#define BLE_GAP_EVENT_NOTIFY_RX          12
+
+#define BLE_ADDR_PUBLIC                  0x00
+#define BLE_ADDR_RANDOM                  0x01
+
+#define BLE_HCI_SCAN_FILT_NO_WL          0
+#define BLE_HCI_SCAN_FILT_USE_WL         1
+
+#define BLE_UUID_TYPE_16   16
+#define BLE_UUID_TYPE_128  128
+
+typedef struct { uint8_t type; } ble_uuid_t;
+typedef struct { ble_uuid_t u; uint16_t value; } ble_uuid16_t;
+typedef struct { ble_uuid_t u; uint8_t value[16]; } ble_uuid128_t;
+typedef union {
+    ble_uuid_t u;
+    ble_uuid16_t u16;
+    ble_uuid128_t u128;
+} ble_uuid_any_t;
+
+int ble_uuid_cmp(const ble_uuid_t* uuid1, const ble_uuid_t* uuid2);
+
+struct os_mbuf {
+    const uint8_t* data;
+    uint16_t len;
+};
+
+#define OS_MBUF_PKTLEN(om) ((om)->len)
+int ble_hs_mbuf_to_flat(const struct os_mbuf* om, void* flat, uint16_t max_len, uint16_t* out_copy_len);
+
+struct ble_gatt_error {
+    uint16_t status;
+    uint16_t att_handle;
+};
+
+struct ble_gatt_attr {
+    uint16_t handle;
+    uint16_t offset;
+    struct os_mbuf* om;
+};
+
+struct ble_gatt_chr {
+    uint16_t def_handle;
+    uint16_t val_handle;
+    uint8_t properties;
+    ble_uuid_any_t uuid;
+};
+
+struct ble_gatt_dsc {
+    uint16_t handle;
+    ble_uuid_any_t uuid;
+};
+
+typedef int ble_gatt_attr_fn(uint16_t conn_handle, const struct ble_gatt_error* error,
+                             struct ble_gatt_attr* attr, void* arg);
+typedef int ble_gatt_chr_fn(uint16_t conn_handle, const struct ble_gatt_error* error,
+                            const struct ble_gatt_chr* chr, void* arg);
+typedef int ble_gatt_dsc_fn(uint16_t conn_handle, const struct ble_gatt_error* error,
+                            uint16_t chr_val_handle, const struct ble_gatt_dsc* dsc, void* arg);
+
+int ble_gattc_read_long(uint16_t conn_handle, uint16_t handle, uint16_t offset,
+                        ble_gatt_attr_fn* cb, void* cb_arg);
+int ble_gattc_write_flat(uint16_t conn_handle, uint16_t attr_handle, const void* data,
+                         uint16_t data_len, ble_gatt_attr_fn* cb, void* cb_arg);
+int ble_gattc_write_no_rsp_flat(uint16_t conn_handle, uint16_t attr_handle,
+                                const void* data, uint16_t data_len);
+int ble_gattc_disc_all_chrs(uint16_t conn_handle, uint16_t start_handle, uint16_t end_handle,
+                            ble_gatt_chr_fn* cb, void* cb_arg);
+int ble_gattc_disc_all_dscs(uint16_t conn_handle, uint16_t start_handle, uint16_t end_handle,
+                            ble_gatt_dsc_fn* cb, void* cb_arg);
+
+struct ble_gap_event {
+    uint8_t type;
+    union {
+        struct {
+            struct os_mbuf* om;
+            uint16_t attr_handle;
+            uint16_t conn_handle;
+            uint8_t indication;
+        } notify_rx;
+    };
+};
+
+typedef int ble_gap_event_fn(struct ble_gap_event* event, void* arg);
+
+struct ble_gap_event_listener {
+    ble_gap_event_fn* fn;
+    void* arg;
+    struct ble_gap_event_listener* next;
+};
+
+int ble_gap_event_listener_register(struct ble_gap_event_listener* listener,
+                                    ble_gap_event_fn* fn, void* arg);
+
+struct ble_gap_conn_desc {
+    uint16_t conn_handle;
+};
+
+// 0 if the connection is open (out_desc may be null)
+int ble_gap_conn_find(uint16_t handle, struct ble_gap_conn_desc* out_desc);
+
+// --- NimBLE-Arduino C++ API -------------------------------------------------
+
+typedef enum {
+    ESP_PWR_LVL_N12 = 0,
+    ESP_PWR_LVL_N9,
+    ESP_PWR_LVL_N6,
+    ESP_PWR_LVL_N3,
+    ESP_PWR_LVL_N0,
+    ESP_PWR_LVL_P3,
+    ESP_PWR_LVL_P6,
+    ESP_PWR_LVL_P9,
+} esp_power_level_t;
+
+// Plain values, like the real ones: copying them never allocates
+typedef struct {
+    uint8_t type;
+    uint8_t val[6];                    // Least significant byte first
+} ble_addr_t;
+
+class NimBLEAddress {
+public:
+    NimBLEAddress() {}
+    NimBLEAddress(ble_addr_t address) : type(address.type) { memcpy(value, address.val, 6); }
+    NimBLEAddress(const std::string& address, uint8_t type = BLE_ADDR_PUBLIC);
+
+    // Least significant byte first, as NimBLE stores it
+    const uint8_t* getNative() const { return value; }
+    std::string toString() const;
+    uint8_t getType() const { return type; }
+    bool operator==(const NimBLEAddress& other) const { return memcmp(value, other.value, 6) == 0; }
+    bool operator!=(const NimBLEAddress& other) const { return !(*this == other); }
+
+private:
+    uint8_t value[6] = {};
+    uint8_t type = BLE_ADDR_PUBLIC;
+};
+
+class NimBLEUUID {
+public:
+    NimBLEUUID() {}
+    NimBLEUUID(const char* uuid);
+    NimBLEUUID(const std::string& uuid) : NimBLEUUID(uuid.c_str()) {}
+    NimBLEUUID(uint16_t uuid16);
+
+    std::string toString() const;
+    const ble_uuid_any_t* getNative() const { return &native; }
+    bool equals(const NimBLEUUID& other) const { return ble_uuid_cmp(&native.u, &other.native.u) == 0; }
+    bool operator==(const NimBLEUUID& other) const { return equals(other); }
+    bool operator!=(const NimBLEUUID& other) const { return !equals(other); }
+
+private:
+    ble_uuid_any_t native = {};
+};
+
+class NimBLEAdvertisedDevice {
+public:
+    NimBLEAdvertisedDevice() {}
+    NimBLEAdvertisedDevice(const std::string& name, const NimBLEAddress& address)
+        : name(name), address(address) {}
+
+    std::string getName() const { return name; }
+    bool haveName() const { return !name.empty(); }
+    NimBLEAddress getAddress() const { return address; }
+    bool isAdvertisingService(const NimBLEUUID& uuid) const {
+        for (const NimBLEUUID& service : services) {
+            if (service == uuid) return true;
+        }
+        return false;
+    }
+    bool haveManufacturerData() const { return !manufacturerData.empty(); }
+    std::string getManufacturerData() const { return manufacturerData; }
+    uint8_t* getPayload() { return payload.data(); }
+    size_t getPayloadLength() const { return payload.size(); }
+
+    std::vector<NimBLEUUID> services;
+    std::string manufacturerData;
+    std::vector<uint8_t> payload;      // Raw AD structures (advertisement + scan response)
+
+private:
+    std::string name;
+    NimBLEAddress address;
+};
+
+class NimBLEAdvertisedDeviceCallbacks {
+public:
+    virtual ~NimBLEAdvertisedDeviceCallbacks() {}
+    virtual void onResult(NimBLEAdvertisedDevice* advertisedDevice) = 0;
+};
+
+class NimBLEScanResults {
+public:
+    int getCount() const { return (int)devices.size(); }
+    NimBLEAdvertisedDevice getDevice(uint32_t i) const { return devices[i]; }
+
+    std::vector<NimBLEAdvertisedDevice> devices;
+};
+
+// Advertisements arrive while the scan runs: each advertiser is reported
+// to the callbacks once (no duplicates) and kept in the results up to
+// setMaxResults() (0 keeps nothing). The scanner listens window out of
+// every interval, so a low duty cycle catches advertisements later; a
+// passive scan sends no scan requests and gets no scan response data.
+// A duration of 0 scans until stop().
+class NimBLEScan {
+public:
+    void setActiveScan(bool active) { activeScan = active; }
+    void setInterval(uint16_t intervalMSecs) { interval = intervalMSecs; }
+    void setWindow(uint16_t windowMSecs) { window = windowMSecs; }
+    void setAdvertisedDeviceCallbacks(NimBLEAdvertisedDeviceCallbacks* callbacks, bool wantDuplicates = false) {
+        deviceCallbacks = callbacks;
+        duplicates = wantDuplicates;
+    }
+    void setMaxResults(uint8_t maxResults) { resultLimit = maxResults; }
+    void setDuplicateFilter(bool enabled) { duplicateFilter = enabled; }
+    void setFilterPolicy(uint8_t filterPolicy) { policy = filterPolicy; }
+    // Scan in the background; scanCompleteCB runs on the host task at the end
+    bool start(uint32_t duration, void (*scanCompleteCB)(NimBLEScanResults), bool is_continue = false);
+    bool stop();
+    bool isScanning() const { return scanning; }
+    NimBLEScanResults getResults() const { return results; }
+    void clearResults() { results.devices.clear(); }
+
+private:
+    void watchCamera(size_t index, uint32_t id);
+    void report(const NimBLEAdvertisedDevice& device);
+
+    bool activeScan = false;
+    bool duplicateFilter = false;
+    uint8_t policy = BLE_HCI_SCAN_FILT_NO_WL;
+    bool scanning = false;
+    uint64_t startUs = 0;
+    uint32_t generation = 0;   // Tells a stopped scan's events from the current one
+    void (*completeCB)(NimBLEScanResults) = nullptr;
+    NimBLEAdvertisedDeviceCallbacks* deviceCallbacks = nullptr;
+    bool duplicates = false;
+    uint8_t resultLimit = 0xff;
+    std::vector<std::string> reported;   // Addresses reported by the current scan
+    uint16_t interval = 100;
+    uint16_t window = 100;
+    NimBLEScanResults results;
+};
+
+class NimBLEClient;
+
+class NimBLERemoteCharacteristic {
+public:
+    NimBLERemoteCharacteristic(NimBLEClient* client, const sim::Attribute& attr)
+        : client(client), uuid(attr.uuid), handle(attr.handle),
+          readable(attr.readable), writable(attr.writable) {}
+
+    NimBLEUUID getUUID() const { return uuid; }
+    uint16_t getHandle() const { return handle; }
+    bool canRead() const { return readable; }
+    bool canWrite() const { return writable; }
+    std::string readValue();
+    bool writeValue(const uint8_t* data, size_t length, bool response = false);
+
+private:
+    NimBLEClient* client;
+    NimBLEUUID uuid;
+    uint16_t handle;
+    bool readable;
+    bool writable;
+};
+
+class NimBLERemoteService {
+public:
+    NimBLERemoteService(NimBLEClient* client, const sim::Service& service)
+        : client(client), uuid(service.uuid), definition(service) {}
+    ~NimBLERemoteService();
+
+    NimBLEUUID getUUID() const { return uuid; }
+    std::vector<NimBLERemoteCharacteristic*>* getCharacteristics(bool refresh = false);
+
+private:
+    NimBLEClient* client;
+    NimBLEUUID uuid;
+    sim::Service definition;
+    std::vector<NimBLERemoteCharacteristic*> characteristics;
+};
+
+class NimBLEClientCallbacks {
+public:
+    virtual ~NimBLEClientCallbacks() {}
+    virtual void onConnect(NimBLEClient* pClient) { (void)pClient; }
+    virtual void onDisconnect(NimBLEClient* pClient) { (void)pClient; }
+};
+
+class NimBLEClient {
+public:
+    ~NimBLEClient();
+
+    bool connect(const NimBLEAddress& address, bool deleteAttributes = true);
+    int disconnect(uint8_t reason = 0x13);
+    bool isConnected();
+    void setClientCallbacks(NimBLEClientCallbacks* callbacks, bool deleteCallbacks = true);
+    void setConnectTimeout(uint32_t timeoutSeconds) { connectTimeout = timeoutSeconds; }
+    std::vector<NimBLERemoteService*>* getServices(bool refresh = false);
+    NimBLERemoteService* getService(const NimBLEUUID& uuid);
+    NimBLEAddress getPeerAddress() const { return peer; }
+    uint16_t getConnId() const { return connected ? connId : 0xffff; }
+    bool secureConnection() { return isConnected(); }
+
+    // Simulation: camera on the other end of the link (null if down)
+    sim::Camera* peerCamera();
+
+private:
+    void deleteServices();
+
+    uint16_t connId = 0;
+    NimBLEClientCallbacks* callbacks = nullptr;
+    bool ownsCallbacks = false;
+    uint32_t connectTimeout = 30;
+    uint32_t linkGeneration = 0;
+    bool connected = false;
+    NimBLEAddress peer;
+    sim::Camera* peerCam = nullptr;
+    std::vector<NimBLERemoteService*> services;
+};
+
+class NimBLEDevice {
+public:
+    static void init(const std::string& deviceName);
+    static void setPower(esp_power_level_t powerLevel);
+    static NimBLEScan* getScan();
+    static NimBLEClient* createClient();
+
+    // Controller whitelist (a scan with BLE_HCI_SCAN_FILT_USE_WL only
+    // reports these advertisers)
+    static bool whiteListAdd(const NimBLEAddress& address);
+    static bool whiteListRemove(const NimBLEAddress& address);
+    static bool onWhiteList(const NimBLEAddress& address);
+    static size_t getWhiteListCount();
+};
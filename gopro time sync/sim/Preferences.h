@@ -0,0 +1,33 @@
+/**
+ * Host fake of the ESP32 Arduino Preferences (NVS) API (native build only)
+ *
+ * Storage is a process-wide map, so it survives simulated ESP.restart()
+ * the way NVS survives a reboot.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+class Preferences {
+public:
+    bool begin(const char* name, bool readOnly = false);
+    void end();
+
+    bool isKey(const char* key);
+    bool remove(const char* key);
+    bool clear();
+
+    size_t getBytesLength(const char* key);
+    size_t getBytes(const char* key, void* buf, size_t maxLen);
+    size_t putBytes(const char* key, const void* value, size_t len);
+
+    String getString(const char* key, const String& defaultValue = String());
+    size_t getString(const char* key, char* value, size_t maxLen);
+    size_t putString(const char* key, const char* value);
+
+private:
+    std::string space;
+    bool open = false;
+    bool readOnly = false;
+};
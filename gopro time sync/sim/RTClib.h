@@ -0,0 +1,53 @@
+/**
+ * Host fake of the Adafruit RTClib DS3231 API used by the firmware (native build only)
+ *
+ * The simulated DS3231 counts whole seconds from a fixed epoch on the
+ * virtual clock.
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <Wire.h>
+
+class DateTime {
+public:
+    DateTime(uint32_t t = 0);
+    DateTime(uint16_t year, uint8_t month, uint8_t day,
+             uint8_t hour = 0, uint8_t min = 0, uint8_t sec = 0);
+
+    uint16_t year() const { return yOff + 2000; }
+    uint8_t month() const { return m; }
+    uint8_t day() const { return d; }
+    uint8_t hour() const { return hh; }
+    uint8_t minute() const { return mm; }
+    uint8_t second() const { return ss; }
+    uint32_t unixtime() const;
+
+private:
+    uint8_t yOff = 0, m = 1, d = 1, hh = 0, mm = 0, ss = 0;
+};
+
+enum Ds3231SqwPinMode {
+    DS3231_OFF = 0x1C,
+    DS3231_SquareWave1Hz = 0x00,
+    DS3231_SquareWave1kHz = 0x08,
+    DS3231_SquareWave4kHz = 0x10,
+    DS3231_SquareWave8kHz = 0x18,
+};
+
+class RTC_DS3231 {
+public:
+    bool begin(TwoWire* wireInstance = &Wire) { (void)wireInstance; return true; }
+    bool lostPower() { return false; }
+    DateTime now();
+    void writeSqwPinMode(Ds3231SqwPinMode mode);
+};
+
+namespace sim {
+// Unix time of the simulated DS3231 at virtual time zero; its seconds tick
+// over on whole virtual seconds
+extern uint32_t rtcEpoch;
+// GPIO the DS3231 SQW output is wired to (1 Hz mode: falling edge per second)
+extern uint8_t rtcSqwPin;
+}
@@ -0,0 +1,178 @@
+#include <Arduino.h>
+#include <stdarg.h>
+#include <algorithm>
+#include <map>
+
+HardwareSerial Serial;
+EspClass ESP;
+
+unsigned long millis() { return (unsigned long)(sim::nowUs() / 1000); }
+uint32_t micros() { return (uint32_t)sim::nowUs(); }
+void delay(uint32_t ms) { sim::advanceMs(ms); }
+void delayMicroseconds(uint32_t us) { sim::advanceUs(us); }
+
+static uint32_t notificationCount = 0;
+
+TaskHandle_t xTaskGetCurrentTaskHandle() { return &notificationCount; }
+void xTaskNotifyGive(TaskHandle_t task) { (void)task; notificationCount++; }
+
+// Deadline for a blocking wait; portMAX_DELAY only runs already-pending events
+static uint64_t waitDeadline(TickType_t ticksToWait) {
+    return ticksToWait == portMAX_DELAY ? UINT64_MAX : sim::nowUs() + (uint64_t)ticksToWait * 1000;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearCountOnExit, TickType_t ticksToWait) {
+    uint64_t deadline = waitDeadline(ticksToWait);
+    while (notificationCount == 0) {
+        if (!sim::runNextEvent(deadline)) {
+            if (deadline != UINT64_MAX) sim::advanceUs(deadline - sim::nowUs());
+            return 0;
+        }
+    }
+    uint32_t value = notificationCount;
+    notificationCount = clearCountOnExit ? 0 : notificationCount - 1;
+    return value;
+}
+
+struct SimEventGroup {
+    EventBits_t bits;
+};
+
+EventGroupHandle_t xEventGroupCreate() { return new SimEventGroup{0}; }
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits) {
+    group->bits |= bits;
+    return group->bits;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits) {
+    EventBits_t before = group->bits;
+    group->bits &= ~bits;
+    return before;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t group) { return group->bits; }
+
+BaseType_t xEventGroupSetBitsFromISR(EventGroupHandle_t group, EventBits_t bits,
+                                     BaseType_t* higherPriorityTaskWoken) {
+    group->bits |= bits;
+    if (higherPriorityTaskWoken) *higherPriorityTaskWoken = pdFALSE;
+    return pdTRUE;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bitsToWaitFor,
+                                BaseType_t clearOnExit, BaseType_t waitForAllBits,
+                                TickType_t ticksToWait) {
+    uint64_t deadline = waitDeadline(ticksToWait);
+    for (;;) {
+        EventBits_t matched = group->bits & bitsToWaitFor;
+        bool done = waitForAllBits ? matched == bitsToWaitFor : matched != 0;
+        if (done) {
+            EventBits_t value = group->bits;
+            if (clearOnExit) group->bits &= ~bitsToWaitFor;
+            return value;
+        }
+        if (!sim::runNextEvent(deadline)) {
+            if (deadline != UINT64_MAX) sim::advanceUs(deadline - sim::nowUs());
+            return group->bits;
+        }
+    }
+}
+
+// Stack size by task name (ESP-IDF counts stacks in bytes)
+struct SimTask {
+    uint32_t stackBytes;
+};
+static std::map<std::string, SimTask> tasks = {{"loopTask", {8192}}, {"nimble_host", {4096}}};
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t task, const char* name, uint32_t stackDepth,
+                                   void* parameters, uint32_t priority, TaskHandle_t* created,
+                                   BaseType_t coreId) {
+    (void)task;
+    (void)parameters;
+    (void)priority;
+    (void)coreId;
+    sim::HeapExempt exempt;
+    SimTask& entry = tasks[name];
+    entry.stackBytes = stackDepth;
+    if (created != nullptr) *created = &entry;
+    return pdTRUE;
+}
+
+TaskHandle_t xTaskGetHandle(const char* name) {
+    sim::HeapExempt exempt;
+    auto it = tasks.find(name);
+    return it != tasks.end() ? &it->second : nullptr;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+    return task != nullptr ? ((SimTask*)task)->stackBytes / 2 : 0;
+}
+
+void vTaskDelay(TickType_t ticks) { sim::advanceMs(ticks); }
+
+void pinMode(uint8_t pin, uint8_t mode) { (void)pin; (void)mode; }
+void digitalWrite(uint8_t pin, uint8_t value) { (void)pin; (void)value; }
+
+// Attached ISRs by pin: (handler, edge mode)
+static std::map<uint8_t, std::pair<void (*)(), int>> interrupts;
+
+void attachInterrupt(uint8_t pin, void (*isr)(), int mode) { interrupts[pin] = {isr, mode}; }
+void detachInterrupt(uint8_t pin) { interrupts.erase(pin); }
+
+void sim::raiseInterrupt(uint8_t pin, int edge) {
+    auto it = interrupts.find(pin);
+    sim::FirmwareCallback firmware;
+    if (it != interrupts.end() && it->second.second == edge) it->second.first();
+}
+
+bool sim::serialFromOtherTask = false;
+uint64_t sim::serialBlockedUs = 0;
+
+static const uint64_t UART_BYTE_NS = 10ULL * 1000000000 / 115200;  // 8N1
+static const uint64_t UART_FIFO_BYTES = 128;
+static uint64_t uartIdleNs = 0;    // When the FIFO will have drained
+
+// Queue bytes on the UART, blocking until the last one is in the FIFO.
+// Inside a radio event (a callback) time cannot be advanced; the wait is
+// only counted there.
+static void uartTransmit(size_t bytes) {
+    uint64_t nowNs = sim::nowUs() * 1000;
+    uartIdleNs = std::max(uartIdleNs, nowNs) + bytes * UART_BYTE_NS;
+    uint64_t freeAtNs = uartIdleNs - std::min(uartIdleNs, UART_FIFO_BYTES * UART_BYTE_NS);
+    if (freeAtNs <= nowNs || sim::serialFromOtherTask) return;
+    uint64_t blockedUs = (freeAtNs - nowNs + 999) / 1000;
+    sim::serialBlockedUs += blockedUs;
+    if (!sim::runningEvent()) sim::advanceUs(blockedUs);
+}
+
+size_t HardwareSerial::print(const char* s) {
+    size_t n = strlen(s);
+    uartTransmit(n);
+    if (!sim::verbose) return n;
+    return fputs(s, stdout) < 0 ? 0 : n;
+}
+
+size_t HardwareSerial::println(const char* s) {
+    size_t n = print(s);
+    return n + print("\n");
+}
+
+size_t HardwareSerial::printf(const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    int n = sim::verbose ? vprintf(format, args) : vsnprintf(nullptr, 0, format, args);
+    va_end(args);
+    if (n > 0) uartTransmit((size_t)n);
+    return n < 0 ? 0 : (size_t)n;
+}
+
+size_t HardwareSerial::write(const uint8_t* data, size_t length) {
+    uartTransmit(length);
+    if (!sim::verbose) return length;
+    return fwrite(data, 1, length, stdout);
+}
+
+void EspClass::restart() {
+    throw SimRestart();
+}
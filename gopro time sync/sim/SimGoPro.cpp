@@ -0,0 +1,412 @@
+#include "SimGoPro.h"
+
+#include <RTClib.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <random>
+
+namespace sim {
+
+static uint64_t clockUs = 0;
+static std::mt19937 rng(1);
+
+bool verbose = false;
+uint32_t addressConflicts = 0;
+uint32_t tcpConnects = 0;
+uint32_t httpRequests = 0;
+LatencyModel latency;
+uint32_t backgroundAdvertisers = 24;
+uint32_t foreignGoPros = 0;
+size_t whiteListSize = 12;
+uint64_t advertisementsReported = 0;
+uint64_t advertisementsFiltered = 0;
+uint64_t scanListenUs = 0;
+uint64_t activeScanListenUs = 0;
+uint8_t maxConnections = 3;
+
+// Pending events ordered by due time (multimap keeps insertion order for ties)
+struct PendingEvent {
+    std::function<void()> run;
+    bool background;
+};
+static std::multimap<uint64_t, PendingEvent> pending;
+static size_t foregroundCount = 0;
+static uint32_t eventDepth = 0;
+
+uint64_t nowUs() { return clockUs; }
+
+void advanceUs(uint64_t us) {
+    uint64_t target = clockUs + us;
+    while (runNextEvent(target)) {}
+    clockUs = target;
+}
+
+void advanceMs(uint32_t ms) { advanceUs((uint64_t)ms * 1000); }
+
+void schedule(uint64_t atUs, std::function<void()> event, bool background) {
+    HeapExempt exempt;
+    pending.emplace(atUs < clockUs ? clockUs : atUs, PendingEvent{std::move(event), background});
+    if (!background) foregroundCount++;
+}
+
+bool runNextEvent(uint64_t deadlineUs) {
+    // An unbounded wait only lasts while something other than background
+    // ticks can still happen; otherwise it would never return
+    if (deadlineUs == UINT64_MAX && foregroundCount == 0) return false;
+    if (pending.empty() || pending.begin()->first > deadlineUs) return false;
+    auto it = pending.begin();
+    clockUs = it->first;
+    PendingEvent event = std::move(it->second);
+    pending.erase(it);
+    if (!event.background) foregroundCount--;
+    HeapExempt exempt;
+    eventDepth++;
+    event.run();
+    eventDepth--;
+    return true;
+}
+
+bool runningEvent() { return eventDepth > 0; }
+
+void seed(uint32_t value) { rng.seed(value); }
+
+uint32_t sampleMs(uint32_t loMs, uint32_t hiMs) {
+    if (hiMs <= loMs) return loMs;
+    std::uniform_int_distribution<uint32_t> dist(loMs, hiMs);
+    return dist(rng);
+}
+
+static uint64_t sampleUs(const Range& r) {
+    return (uint64_t)sampleMs(r.lo, r.hi) * 1000;
+}
+
+// GATT table layout modelled on a Hero 9: each characteristic takes a
+// declaration handle followed by its value handle (+1 for a CCCD).
+Camera::Camera() {
+    struct Def { const char* uuid; bool read; bool write; bool notify; };
+    struct Svc { const char* uuid; std::vector<Def> chars; };
+    const std::vector<Svc> layout = {
+        {"1800", {{"2a00", true, false, false}, {"2a01", true, false, false}}},
+        {"1801", {{"2a05", false, false, true}}},
+        {"180a", {{"2a29", true, false, false}, {"2a24", true, false, false},
+                  {"2a25", true, false, false}, {"2a26", true, false, false}}},
+        {"180f", {{"2a19", true, false, true}}},
+        {"b5f90001-aa8d-11e3-9046-0002a5d5c51b",
+            {{"b5f90002-aa8d-11e3-9046-0002a5d5c51b", true, true, false},
+             {"b5f90003-aa8d-11e3-9046-0002a5d5c51b", true, true, false},
+             {"b5f90004-aa8d-11e3-9046-0002a5d5c51b", false, true, false},
+             {"b5f90005-aa8d-11e3-9046-0002a5d5c51b", true, false, true}}},
+        {"fea6",
+            {{"b5f90072-aa8d-11e3-9046-0002a5d5c51b", false, true, false},
+             {"b5f90073-aa8d-11e3-9046-0002a5d5c51b", false, false, true},
+             {"b5f90074-aa8d-11e3-9046-0002a5d5c51b", false, true, false},
+             {"b5f90075-aa8d-11e3-9046-0002a5d5c51b", false, false, true},
+             {"b5f90076-aa8d-11e3-9046-0002a5d5c51b", false, true, false},
+             {"b5f90077-aa8d-11e3-9046-0002a5d5c51b", false, false, true}}},
+        {"b5f90090-aa8d-11e3-9046-0002a5d5c51b",
+            {{"b5f90091-aa8d-11e3-9046-0002a5d5c51b", false, true, false},
+             {"b5f90092-aa8d-11e3-9046-0002a5d5c51b", false, false, true}}},
+    };
+
+    uint16_t handle = 1;
+    for (const auto& svc : layout) {
+        Service service;
+        service.uuid = svc.uuid;
+        handle++;  // Service declaration
+        for (const auto& def : svc.chars) {
+            handle++;  // Characteristic declaration
+            service.characteristics.push_back({def.uuid, handle, def.read, def.write, def.notify});
+            handle++;
+            if (def.notify) handle++;  // CCCD
+        }
+        gatt.push_back(service);
+    }
+}
+
+void Camera::powerOn() {
+    powered = true;
+    generation++;
+    apEnabled = false;
+    subscribed.clear();
+    poweredOnAtUs = nowUs();
+    firstTimeSetUs = 0;
+    advertiseAtUs = nowUs() + sampleUs(latency.bootToAdvertise);
+    if (apOnAtBoot) {
+        apEnabled = true;
+        apReadyAtUs = advertiseAtUs;
+    }
+}
+
+void Camera::powerOff() {
+    powered = false;
+    apEnabled = false;
+    subscribed.clear();
+    generation++;
+}
+
+bool Camera::isAdvertising() const {
+    return powered && nowUs() >= advertiseAtUs;
+}
+
+// Open GoPro advertisement: company ID 0x02F2, schema version, camera
+// status (bit 0 processor on, bit 1 WiFi AP on, bit 2 pairing), camera ID, capabilities,
+// a 6-byte ID hash and the media offload status
+std::string Camera::manufacturerData() const {
+    std::string data = {(char)0xf2, (char)0x02, (char)0x02};
+    data += (char)(0x01 | (isAPUp() ? 0x02 : 0x00) | (pairingMode ? 0x04 : 0x00));
+    data += (char)0x37;
+    data += (char)0x0f;
+    for (size_t i = 0; i < 6; i++) data += (char)(address[i * 3] ^ address[i * 3 + 1] ^ i);
+    data += (char)0x00;
+    return data;
+}
+
+uint8_t Camera::apState() const {
+    if (!powered || !apEnabled) return 0x00;
+    return nowUs() >= apReadyAtUs ? 0x03 : 0x01;
+}
+
+bool Camera::isAPUp() const {
+    return apState() == 0x03;
+}
+
+static const Attribute* findAttribute(const std::vector<Service>& gatt, uint16_t handle) {
+    for (const auto& service : gatt) {
+        for (const auto& attr : service.characteristics) {
+            if (attr.handle == handle) return &attr;
+        }
+    }
+    return nullptr;
+}
+
+std::string Camera::readAttribute(uint16_t handle) const {
+    HeapExempt exempt;
+    const Attribute* attr = findAttribute(gatt, handle);
+    if (attr == nullptr || !attr->readable) return "";
+
+    if (attr->uuid == "b5f90002-aa8d-11e3-9046-0002a5d5c51b") return ssid;
+    if (attr->uuid == "b5f90003-aa8d-11e3-9046-0002a5d5c51b") return password;
+    if (attr->uuid == "b5f90005-aa8d-11e3-9046-0002a5d5c51b") return std::string(1, (char)apState());
+    if (attr->uuid == "2a00") return name;
+    if (attr->uuid == "2a19") return std::string(1, (char)87);
+    return "sim";
+}
+
+// Notify a characteristic, if the central subscribed to it
+void Camera::sendNotification(const char* uuid, const std::string& value) {
+    for (const auto& service : gatt) {
+        for (const auto& attr : service.characteristics) {
+            if (attr.uuid != uuid) continue;
+            bool enabled = std::find(subscribed.begin(), subscribed.end(), attr.handle) != subscribed.end();
+            if (enabled && notify) notify(attr.handle, value);
+        }
+    }
+}
+
+void Camera::notifyAPState() {
+    sendNotification("b5f90005-aa8d-11e3-9046-0002a5d5c51b", std::string(1, (char)apState()));
+}
+
+// The camera starts the written second clockApply after receiving it
+void Camera::applyTime(const uint8_t fields[6]) {
+    memcpy(clockFields, fields, sizeof(clockFields));
+    timeSetCount++;
+    lastTimeSetUs = nowUs() + sampleUs(latency.clockApply);
+    if (firstTimeSetUs == 0) firstTimeSetUs = lastTimeSetUs;
+}
+
+uint64_t Camera::clockUs() const {
+    const uint8_t* f = clockFields;
+    uint64_t setUs = (uint64_t)DateTime(2000 + f[0], f[1], f[2], f[3], f[4], f[5]).unixtime() * 1000000;
+    int64_t elapsedUs = (int64_t)(nowUs() - lastTimeSetUs);
+    return setUs + elapsedUs + (int64_t)(elapsedUs * clockDriftPpm / 1e6);
+}
+
+// Command channel: only Set/Get Date/Time (0x0D/0x0E) are modelled; anything
+// else is answered with status 0x02 (invalid parameter)
+void Camera::handleCommand(const uint8_t* data, size_t length) {
+    if (length < 2 || (data[0] & 0xe0) != 0 || (size_t)(data[0] & 0x1f) + 1 != length) return;
+
+    uint8_t commandId = data[1];
+    uint8_t status = 0x02;
+    if (commandId == 0x0D && length == 10 && data[2] == 0x07) {
+        status = 0x01;
+        if (bleDateTimeSupported) {
+            uint16_t year = (uint16_t)((data[3] << 8) | data[4]);
+            const uint8_t fields[6] = {(uint8_t)(year % 100), data[5], data[6], data[7], data[8], data[9]};
+            applyTime(fields);
+            status = 0x00;
+        }
+    }
+
+    std::string params;
+    if (commandId == 0x0E && length == 2) {
+        status = 0x01;
+        if (bleDateTimeSupported) {
+            lastClockReadUs = nowUs();
+            DateTime now((uint32_t)(clockUs() / 1000000));
+            params = {0x07, (char)(now.year() >> 8), (char)(now.year() & 0xff), (char)now.month(),
+                      (char)now.day(), (char)now.hour(), (char)now.minute(), (char)now.second()};
+            status = 0x00;
+        }
+    }
+
+    uint32_t gen = generation;
+    std::string response = std::string(1, (char)(2 + params.size())) + (char)commandId + (char)status + params;
+    schedule(nowUs() + sampleUs(latency.bleCommand), [this, gen, response]() {
+        if (gen == generation) sendNotification("b5f90073-aa8d-11e3-9046-0002a5d5c51b", response);
+    });
+}
+
+bool Camera::writeAttribute(uint16_t handle, const uint8_t* data, size_t length) {
+    HeapExempt exempt;
+    // CCCD of a notifiable characteristic (the handle after its value)
+    const Attribute* owner = findAttribute(gatt, handle - 1);
+    if (owner != nullptr && owner->notifiable) {
+        if (length < 2) return false;
+        subscribed.erase(std::remove(subscribed.begin(), subscribed.end(), owner->handle), subscribed.end());
+        if (data[0] & 0x01) subscribed.push_back(owner->handle);
+        return true;
+    }
+
+    const Attribute* attr = findAttribute(gatt, handle);
+    if (attr == nullptr || !attr->writable || length == 0) return false;
+
+    if (attr->uuid == "b5f90072-aa8d-11e3-9046-0002a5d5c51b") {
+        handleCommand(data, length);
+    } else if (attr->uuid == "b5f90004-aa8d-11e3-9046-0002a5d5c51b") {
+        if (data[0] == 0x01 && !apEnabled) {
+            apEnabled = true;
+            apReadyAtUs = nowUs() + sampleUs(latency.apStartup);
+            notifyAPState();
+
+            uint32_t gen = generation;
+            schedule(apReadyAtUs, [this, gen]() {
+                if (gen == generation && apEnabled) notifyAPState();
+            });
+        } else if (data[0] == 0x00) {
+            apEnabled = false;
+            notifyAPState();
+        }
+    }
+    return true;
+}
+
+// Parse "%YY%MM%DD%HH%MM%SS" hex pairs
+static bool parseLegacyDateTime(const std::string& query, uint8_t out[6]) {
+    size_t pos = 0;
+    for (int i = 0; i < 6; i++) {
+        if (pos + 3 > query.size() || query[pos] != '%') return false;
+        unsigned value = 0;
+        if (sscanf(query.c_str() + pos + 1, "%2x", &value) != 1) return false;
+        out[i] = (uint8_t)value;
+        pos += 3;
+    }
+    return true;
+}
+
+// Parse "date=YYYY_MM_DD&time=HH_MM_SS" (Open GoPro; year 2000-2099)
+static bool parseOpenGoProDateTime(const std::string& query, uint8_t out[6]) {
+    unsigned year, month, day, hour, minute, second;
+    if (sscanf(query.c_str(), "date=%4u_%2u_%2u&time=%2u_%2u_%2u",
+               &year, &month, &day, &hour, &minute, &second) != 6 || year < 2000 || year > 2099) {
+        return false;
+    }
+    out[0] = (uint8_t)(year - 2000);
+    out[1] = (uint8_t)month;
+    out[2] = (uint8_t)day;
+    out[3] = (uint8_t)hour;
+    out[4] = (uint8_t)minute;
+    out[5] = (uint8_t)second;
+    return true;
+}
+
+int Camera::handleHttpGet(const std::string& path, std::string& body) {
+    HeapExempt exempt;
+    static const char kLegacyDateTime[] = "/gp/gpControl/command/setup/date_time?p=";
+    static const char kOpenGoProDateTime[] = "/gopro/camera/set_date_time?";
+
+    body.clear();
+    if (path.compare(0, strlen(kLegacyDateTime), kLegacyDateTime) == 0) {
+        uint8_t fields[6];
+        if (!parseLegacyDateTime(path.substr(strlen(kLegacyDateTime)), fields)) {
+            body = "{\"error\":\"bad date\"}";
+            return 400;
+        }
+        applyTime(fields);
+        if (httpNoContent) return 204;
+        body = "{}";
+        return 200;
+    }
+    if (path.compare(0, strlen(kOpenGoProDateTime), kOpenGoProDateTime) == 0) {
+        uint8_t fields[6];
+        if (!parseOpenGoProDateTime(path.substr(strlen(kOpenGoProDateTime)), fields)) {
+            body = "{\"error\":\"bad date\"}";
+            return 400;
+        }
+        applyTime(fields);
+        if (httpNoContent) return 204;
+        body = "{}";
+        return 200;
+    }
+    if (path == "/gp/gpControl/status") {
+        lastClockReadUs = nowUs();
+        DateTime now((uint32_t)(clockUs() / 1000000));
+        char status[96];
+        snprintf(status, sizeof(status),
+                 "{\"status\":{\"40\":\"%%%02x%%%02x%%%02x%%%02x%%%02x%%%02x\"},\"settings\":{}}",
+                 now.year() % 100, now.month(), now.day(), now.hour(), now.minute(), now.second());
+        body = status;
+        return 200;
+    }
+
+    body = "{\"error\":\"not found\"}";
+    return 404;
+}
+
+std::deque<Camera>& cameras() {
+    static std::deque<Camera> all(1);
+    return all;
+}
+
+Camera& camera() {
+    return cameras().front();
+}
+
+Camera& addCamera() {
+    std::deque<Camera>& all = cameras();
+    uint8_t index = (uint8_t)all.size();
+    all.emplace_back();
+    Camera& cam = all.back();
+
+    char text[24];
+    snprintf(text, sizeof(text), "GoPro %04u", 9953 + index);
+    cam.name = text;
+    snprintf(text, sizeof(text), "f4:03:28:96:36:%02x", (0x4a + index) & 0xff);
+    cam.address = text;
+    snprintf(text, sizeof(text), "GP5002%04u", 9953 + index);
+    cam.ssid = text;
+    cam.bssid[5] = (uint8_t)(cam.bssid[5] + index);
+    static const uint8_t kChannels[3] = {6, 1, 11};
+    cam.channel = kChannels[index % 3];
+    return cam;
+}
+
+Camera* findCamera(const std::string& address) {
+    for (Camera& cam : cameras()) {
+        if (cam.address == address) return &cam;
+    }
+    return nullptr;
+}
+
+Camera* findCameraBySSID(const std::string& ssid) {
+    for (Camera& cam : cameras()) {
+        if (cam.ssid == ssid) return &cam;
+    }
+    return nullptr;
+}
+
+}  // namespace sim
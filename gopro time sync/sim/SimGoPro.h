@@ -0,0 +1,229 @@
+/**
+ * Simulated GoPro + virtual clock for the native build
+ *
+ * The fakes in this directory (Arduino.h, NimBLEDevice.h, WiFi.h,
+ * Wire.h, RTClib.h) stand in for the ESP32 libraries and
+ * talk to the simulated cameras defined here (one by default, a rig with
+ * addCamera()). Time is virtual: delay()
+ * and every simulated radio operation advance the clock by a latency drawn
+ * from a seeded RNG, so a full sync runs in microseconds of host time while
+ * still reporting realistic time-to-sync numbers.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace sim {
+
+// Virtual clock
+uint64_t nowUs();
+void advanceUs(uint64_t us);
+void advanceMs(uint32_t ms);
+
+// Timed events (radio callbacks). advanceUs() runs every event that falls
+// inside the advanced interval, in time order. Background events (periodic
+// hardware ticks) do not keep an unbounded wait alive on their own.
+void schedule(uint64_t atUs, std::function<void()> event, bool background = false);
+// Jump to and run the next event if it is due by deadlineUs
+bool runNextEvent(uint64_t deadlineUs);
+// An event is running (code called from it cannot advance the clock)
+bool runningEvent();
+
+// Heap allocations (operator new) made by the firmware and the library
+// calls it makes. The simulator's own bookkeeping (the event queue, the
+// radio and the cameras) has no counterpart on the ESP32, so events and
+// the fakes' internals run under a HeapExempt guard; a fake calling back
+// into the firmware from there wraps the call in a FirmwareCallback.
+extern uint64_t heapAllocations;
+// Bytes the firmware's allocations hold, and bytes a library leaked
+// outside operator new (--leak-bytes: leakHeap() on every BLE connect)
+extern uint64_t heapInUse;
+extern uint64_t heapLeaked;
+extern uint32_t leakBytesPerConnect;
+void leakHeap(size_t bytes);
+struct HeapExempt {
+    HeapExempt();
+    ~HeapExempt();
+};
+struct FirmwareCallback {
+    FirmwareCallback();
+    ~FirmwareCallback();
+    uint32_t savedDepth;
+};
+
+// Seeded latency source (uniform in [loMs, hiMs])
+void seed(uint32_t value);
+uint32_t sampleMs(uint32_t loMs, uint32_t hiMs);
+
+// Serial output is only printed when verbose
+extern bool verbose;
+
+// Latency model (milliseconds, min/max of a uniform distribution)
+struct Range {
+    uint32_t lo;
+    uint32_t hi;
+};
+
+struct LatencyModel {
+    Range bootToAdvertise   = {2500, 4500};   // Power-on until first BLE advertisement
+    Range advertisement     = {50, 700};      // Scan start until it catches an advertisement
+    Range bleConnect        = {200, 600};     // LE connection establishment
+    Range serviceDiscovery  = {300, 600};     // Primary service discovery
+    Range charDiscovery     = {150, 400};     // Characteristic discovery, per service
+    Range gattRead          = {40, 120};      // Single characteristic read
+    Range gattWrite         = {30, 80};       // Write with response
+    Range apStartup         = {800, 2500};    // AP enable write until AP state 0x03
+    Range wifiScan          = {1500, 3000};   // Full channel scan in WiFi.begin()
+    Range wifiChannelProbe  = {40, 120};      // Probe on a pinned channel/BSSID
+    Range wifiAssociate     = {100, 300};     // Auth + association
+    Range dhcp              = {300, 2500};    // DHCP lease from the camera
+    Range arpReply          = {5, 40};        // ARP reply from another station
+    Range bleCommand        = {20, 80};       // Command write until the response is sent
+    Range tcpConnect        = {10, 60};       // TCP handshake to 10.5.5.9
+    Range httpResponse      = {30, 250};      // Camera processing + response
+    Range clockApply        = {0, 0};         // Set received until the camera's second starts
+};
+
+extern LatencyModel latency;
+
+// The camera's HTTP server closes a keep-alive connection idle this long
+#define CAMERA_HTTP_IDLE_MS 5000
+
+// Static addresses the firmware took that another station held
+extern uint32_t addressConflicts;
+
+// TCP connections opened to the cameras, and HTTP requests they answered
+extern uint32_t tcpConnects;
+extern uint32_t httpRequests;
+
+// One characteristic in the simulated GATT table
+struct Attribute {
+    std::string uuid;
+    uint16_t handle;
+    bool readable;
+    bool writable;
+    bool notifiable;
+};
+
+struct Service {
+    std::string uuid;
+    std::vector<Attribute> characteristics;
+};
+
+// Simulated camera state
+class Camera {
+public:
+    Camera();
+
+    void powerOn();
+    void powerOff();
+
+    bool isPowered() const { return powered; }
+    bool isAdvertising() const;          // Booted far enough to advertise
+    std::string manufacturerData() const;  // GoPro manufacturer data of the advertisement
+    bool isAPUp() const;                 // AP state 0x03 and reachable
+    uint8_t apState() const;             // 0x00 disabled, 0x01 starting, 0x03 ready
+
+    // GATT behaviour
+    std::string readAttribute(uint16_t handle) const;
+    bool writeAttribute(uint16_t handle, const uint8_t* data, size_t length);
+    const std::vector<Service>& services() const { return gatt; }
+
+    // Notifications: CCCDs are cleared on every new link; notify is set by
+    // the BLE fake and delivers a value to the subscribed central
+    void resetSubscriptions() { subscribed.clear(); }
+    std::function<void(uint16_t handle, const std::string& value)> notify;
+
+    // HTTP behaviour: returns status code, fills body
+    int handleHttpGet(const std::string& path, std::string& body);
+
+    std::string name = "GoPro 9953";
+    std::string address = "f4:03:28:96:36:4a";
+    std::string ssid = "GP50029953";
+    std::string password = "r#P-jP7-bD3";
+    uint8_t bssid[6] = {0xf6, 0xdd, 0x9e, 0x87, 0x2a, 0x11};
+    uint8_t channel = 6;
+
+    // Firmware without Set Date/Time over BLE answers it with status 0x01
+    bool bleDateTimeSupported = true;
+
+    // HTTP replies: Set Date/Time answered "204 No Content" (no body, no
+    // Content-Length), and bodies sent with chunked transfer encoding
+    bool httpNoContent = false;
+    bool httpChunked = false;
+
+    // Put in pairing mode (Connect Device) until its first connection
+    bool pairingMode = true;
+
+    // WiFi AP brought up by the camera itself at power-on (wireless
+    // connections left on), ready by the time it advertises
+    bool apOnAtBoot = false;
+
+    // Other stations on the AP holding a static address (last octet of 10.5.5.x)
+    std::vector<uint8_t> occupiedHosts;
+
+    // Power-cycle generation, used to drop stale WiFi/BLE links
+    uint32_t generation = 0;
+
+    // Statistics read back by the benchmark
+    uint32_t timeSetCount = 0;
+    uint64_t firstTimeSetUs = 0;         // First set since power-on, 0 = none yet
+    uint64_t lastTimeSetUs = 0;
+    uint64_t lastClockReadUs = 0;        // Last Get Date/Time or status read
+    uint64_t poweredOnAtUs = 0;
+    uint8_t clockFields[6] = {16, 1, 1, 0, 0, 0};  // YY MM DD HH MM SS as last written
+
+    // Camera clock (Unix microseconds), running on from the last set at
+    // clockDriftPpm off the true rate
+    uint64_t clockUs() const;
+    double clockDriftPpm = 0;
+
+private:
+    bool powered = false;
+    uint64_t advertiseAtUs = 0;
+    uint64_t apReadyAtUs = 0;
+    bool apEnabled = false;
+    std::vector<Service> gatt;
+    std::vector<uint16_t> subscribed;    // Value handles with notifications enabled
+
+    void sendNotification(const char* uuid, const std::string& value);
+    void notifyAPState();
+    void handleCommand(const uint8_t* data, size_t length);
+    void applyTime(const uint8_t fields[6]);
+};
+
+// The first camera; addCamera() adds another with its own name, address,
+// SSID and AP (BSSID, channel). References stay valid.
+Camera& camera();
+Camera& addCamera();
+std::deque<Camera>& cameras();
+
+Camera* findCamera(const std::string& address);
+Camera* findCameraBySSID(const std::string& ssid);
+
+// Simultaneous LE links the controller accepts (ESP32 default: 3)
+extern uint8_t maxConnections;
+
+// Unrelated advertisers seen by every scan (phones, watches, beacons)
+extern uint32_t backgroundAdvertisers;
+
+// GoPros of other rigs nearby, advertising but not pairable
+extern uint32_t foreignGoPros;
+
+// Controller whitelist entries, and advertisements the controller handed
+// to the host (scan callbacks) or dropped with a whitelist filter policy
+extern size_t whiteListSize;
+extern uint64_t advertisementsReported;
+extern uint64_t advertisementsFiltered;
+
+// Scanner radio use, for the benchmark: time spent listening (the scan
+// window's share of scan time), and the part of it spent active scanning
+extern uint64_t scanListenUs;
+extern uint64_t activeScanListenUs;
+
+}  // namespace sim
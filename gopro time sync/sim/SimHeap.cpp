@@ -0,0 +1,83 @@
+#include "SimGoPro.h"
+
+#include <Arduino.h>
+#include <algorithm>
+#include <stdlib.h>
+#include <new>
+
+// Free heap of an ESP32 once WiFi and NimBLE are up
+#define SIM_HEAP_FREE_BYTES 180000
+
+namespace sim {
+
+uint64_t heapAllocations = 0;
+uint64_t heapInUse = 0;
+uint64_t heapLeaked = 0;
+uint32_t leakBytesPerConnect = 0;
+
+static uint32_t exemptDepth = 0;
+static uint64_t heapPeak = 0;      // Highest heapInUse + heapLeaked
+
+HeapExempt::HeapExempt() { exemptDepth++; }
+HeapExempt::~HeapExempt() { exemptDepth--; }
+
+FirmwareCallback::FirmwareCallback() : savedDepth(exemptDepth) { exemptDepth = 0; }
+FirmwareCallback::~FirmwareCallback() { exemptDepth = savedDepth; }
+
+static void updatePeak() {
+    heapPeak = std::max(heapPeak, heapInUse + heapLeaked);
+}
+
+void leakHeap(size_t bytes) {
+    heapLeaked += bytes;
+    updatePeak();
+}
+
+}  // namespace sim
+
+// Each block starts with a header recording its size and whether it was
+// counted, so freeing it gives the bytes back to the right total
+struct alignas(16) BlockHeader {
+    size_t size;
+    bool counted;
+};
+
+static void* allocate(size_t size) {
+    BlockHeader* header = (BlockHeader*)malloc(sizeof(BlockHeader) + size);
+    if (header == nullptr) throw std::bad_alloc();
+    header->size = size;
+    header->counted = sim::exemptDepth == 0;
+    if (header->counted) {
+        sim::heapAllocations++;
+        sim::heapInUse += size;
+        sim::updatePeak();
+    }
+    return header + 1;
+}
+
+static void release(void* p) {
+    if (p == nullptr) return;
+    BlockHeader* header = (BlockHeader*)p - 1;
+    if (header->counted) sim::heapInUse -= header->size;
+    free(header);
+}
+
+void* operator new(size_t size) { return allocate(size); }
+void* operator new[](size_t size) { return allocate(size); }
+void operator delete(void* p) noexcept { release(p); }
+void operator delete[](void* p) noexcept { release(p); }
+void operator delete(void* p, size_t) noexcept { release(p); }
+void operator delete[](void* p, size_t) noexcept { release(p); }
+
+uint32_t EspClass::getHeapSize() { return SIM_HEAP_FREE_BYTES; }
+
+uint32_t EspClass::getFreeHeap() {
+    uint64_t used = sim::heapInUse + sim::heapLeaked;
+    return used < SIM_HEAP_FREE_BYTES ? (uint32_t)(SIM_HEAP_FREE_BYTES - used) : 0;
+}
+
+uint32_t EspClass::getMinFreeHeap() {
+    return sim::heapPeak < SIM_HEAP_FREE_BYTES ? (uint32_t)(SIM_HEAP_FREE_BYTES - sim::heapPeak) : 0;
+}
+
+uint32_t EspClass::getMaxAllocHeap() { return getFreeHeap(); }
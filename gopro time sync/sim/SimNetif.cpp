@@ -0,0 +1,108 @@
+#include <WiFi.h>
+#include <esp_netif.h>
+#include <esp_netif_net_stack.h>
+#include <lwip/etharp.h>
+#include <lwip/netif.h>
+#include <lwip/tcpip.h>
+
+using sim::latency;
+
+struct esp_netif_obj {
+    int unused;
+};
+
+// lwIP's ARP table, cut down to what the firmware looks at
+struct ArpEntry {
+    bool used;
+    bool resolved;
+    ip4_addr_t ip;
+    struct eth_addr mac;
+};
+
+#define ARP_TABLE_SIZE 10
+
+static esp_netif_obj stationHandle;
+static struct netif stationNetif = {{0x24, 0x6f, 0x28, 0x1a, 0x5c, 0x31}};
+static ArpEntry arpTable[ARP_TABLE_SIZE];
+
+static ArpEntry* findEntry(uint32_t ip) {
+    for (ArpEntry& entry : arpTable) {
+        if (entry.used && entry.ip.addr == ip) return &entry;
+    }
+    return nullptr;
+}
+
+esp_netif_t* esp_netif_get_handle_from_ifkey(const char* if_key) {
+    return strcmp(if_key, "WIFI_STA_DEF") == 0 ? &stationHandle : nullptr;
+}
+
+void* esp_netif_get_netif_impl(esp_netif_t* esp_netif) {
+    return esp_netif == &stationHandle ? &stationNetif : nullptr;
+}
+
+esp_err_t esp_netif_dhcpc_stop(esp_netif_t* esp_netif) {
+    if (esp_netif != &stationHandle) return ESP_FAIL;
+    return WiFi.simStopDhcp() ? ESP_OK : ESP_ERR_ESP_NETIF_DHCP_ALREADY_STOPPED;
+}
+
+esp_err_t esp_netif_set_ip_info(esp_netif_t* esp_netif, const esp_netif_ip_info_t* ip_info) {
+    if (esp_netif != &stationHandle || ip_info->ip.addr != 0) return ESP_FAIL;
+    return WiFi.simClearAddress() ? ESP_OK : ESP_FAIL;
+}
+
+err_t tcpip_callback(tcpip_callback_fn function, void* ctx) {
+    sim::schedule(sim::nowUs(), [function, ctx]() { function(ctx); });
+    return ERR_OK;
+}
+
+// The station holding ip answers with an ARP reply to our MAC, which fills
+// in the pending entry (lwIP adds no entry for a reply it did not ask for)
+err_t etharp_query(struct netif* netif, const ip4_addr_t* ipaddr, struct pbuf* q) {
+    (void)q;
+    sim::Camera* cam = WiFi.associatedCamera();
+    if (netif != &stationNetif || cam == nullptr) return ERR_IF;
+
+    uint32_t ip = ipaddr->addr;
+    if (findEntry(ip) == nullptr) {
+        ArpEntry* slot = nullptr;
+        for (ArpEntry& entry : arpTable) {
+            if (!entry.used) {
+                slot = &entry;
+                break;
+            }
+        }
+        if (slot == nullptr) return ERR_MEM;
+        *slot = {true, false, *ipaddr, {}};
+    }
+    if ((ip & 0x00ffffff) != (10u | (5u << 8) | (5u << 16))) return ERR_OK;
+
+    uint8_t host = (uint8_t)(ip >> 24);
+    for (uint8_t occupied : cam->occupiedHosts) {
+        if (occupied != host) continue;
+
+        uint32_t generation = cam->generation;
+        uint64_t replyUs = sim::nowUs() + (uint64_t)sim::sampleMs(latency.arpReply.lo, latency.arpReply.hi) * 1000;
+        sim::schedule(replyUs, [ip, host, cam, generation]() {
+            if (WiFi.associatedCamera() != cam || cam->generation != generation) return;
+            ArpEntry* entry = findEntry(ip);
+            if (entry == nullptr) return;
+            entry->resolved = true;
+            entry->mac = {{0x24, 0x6f, 0x28, 0x00, 0x00, host}};
+        });
+    }
+    return ERR_OK;
+}
+
+ssize_t etharp_find_addr(struct netif* netif, const ip4_addr_t* ipaddr, struct eth_addr** eth_ret,
+                         const ip4_addr_t** ip_ret) {
+    ArpEntry* entry = netif == &stationNetif ? findEntry(ipaddr->addr) : nullptr;
+    if (entry == nullptr || !entry->resolved) return -1;
+    *eth_ret = &entry->mac;
+    *ip_ret = &entry->ip;
+    return entry - arpTable;
+}
+
+void etharp_cleanup_netif(struct netif* netif) {
+    if (netif != &stationNetif) return;
+    for (ArpEntry& entry : arpTable) entry = {};
+}
@@ -0,0 +1,588 @@
+#include <NimBLEDevice.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+
+using sim::latency;
+
+static void wait(const sim::Range& range) {
+    sim::advanceMs(sim::sampleMs(range.lo, range.hi));
+}
+
+// Open connections by connection handle, so the host C API can find its peer
+static std::map<uint16_t, NimBLEClient*> connections;
+static uint16_t nextConnId = 1;
+
+// Controller whitelist
+static std::vector<NimBLEAddress> whiteList;
+
+static NimBLEClient* clientFor(uint16_t connHandle) {
+    auto it = connections.find(connHandle);
+    if (it == connections.end() || !it->second->isConnected()) return nullptr;
+    return it->second;
+}
+
+// --- NimBLEAddress / NimBLEUUID ------------------------------------------
+
+NimBLEAddress::NimBLEAddress(const std::string& address, uint8_t type) : type(type) {
+    unsigned bytes[6];
+    if (sscanf(address.c_str(), "%x:%x:%x:%x:%x:%x",
+               &bytes[0], &bytes[1], &bytes[2], &bytes[3], &bytes[4], &bytes[5]) == 6) {
+        for (int i = 0; i < 6; i++) value[i] = (uint8_t)bytes[5 - i];
+    }
+}
+
+std::string NimBLEAddress::toString() const {
+    char text[18];
+    snprintf(text, sizeof(text), "%02x:%02x:%02x:%02x:%02x:%02x",
+             value[5], value[4], value[3], value[2], value[1], value[0]);
+    return text;
+}
+
+NimBLEUUID::NimBLEUUID(const char* uuid) {
+    size_t length = strlen(uuid);
+    if (length == 4) {
+        native.u16.u.type = BLE_UUID_TYPE_16;
+        native.u16.value = (uint16_t)strtoul(uuid, nullptr, 16);
+    } else if (length == 36) {
+        // Little-endian byte order, as NimBLE stores it
+        native.u128.u.type = BLE_UUID_TYPE_128;
+        int byte = 15;
+        for (size_t i = 0; i + 1 < length && byte >= 0; i++) {
+            if (uuid[i] == '-') continue;
+            char hex[3] = {uuid[i], uuid[i + 1], 0};
+            native.u128.value[byte--] = (uint8_t)strtoul(hex, nullptr, 16);
+            i++;
+        }
+    }
+}
+
+NimBLEUUID::NimBLEUUID(uint16_t uuid16) {
+    native.u16.u.type = BLE_UUID_TYPE_16;
+    native.u16.value = uuid16;
+}
+
+std::string NimBLEUUID::toString() const {
+    char text[37];
+    if (native.u.type == BLE_UUID_TYPE_16) {
+        snprintf(text, sizeof(text), "%04x", native.u16.value);
+        return text;
+    }
+    const uint8_t* v = native.u128.value;
+    snprintf(text, sizeof(text),
+             "%02x%02x%02x%02x-%02x%02x-%02x%02x-%02x%02x-%02x%02x%02x%02x%02x%02x",
+             v[15], v[14], v[13], v[12], v[11], v[10], v[9], v[8],
+             v[7], v[6], v[5], v[4], v[3], v[2], v[1], v[0]);
+    return text;
+}
+
+// --- Host C API -----------------------------------------------------------
+
+int ble_uuid_cmp(const ble_uuid_t* uuid1, const ble_uuid_t* uuid2) {
+    if (uuid1->type != uuid2->type) return (int)uuid1->type - (int)uuid2->type;
+    if (uuid1->type == BLE_UUID_TYPE_16) {
+        return (int)((const ble_uuid16_t*)uuid1)->value - (int)((const ble_uuid16_t*)uuid2)->value;
+    }
+    return memcmp(((const ble_uuid128_t*)uuid1)->value, ((const ble_uuid128_t*)uuid2)->value, 16);
+}
+
+int ble_hs_mbuf_to_flat(const struct os_mbuf* om, void* flat, uint16_t max_len, uint16_t* out_copy_len) {
+    uint16_t len = om->len < max_len ? om->len : max_len;
+    memcpy(flat, om->data, len);
+    if (out_copy_len) *out_copy_len = len;
+    return len < om->len ? BLE_HS_EDONE : 0;
+}
+
+static const sim::Attribute* findAttribute(const sim::Camera* cam, uint16_t handle) {
+    for (const auto& service : cam->services()) {
+        for (const auto& attr : service.characteristics) {
+            if (attr.handle == handle) return &attr;
+        }
+    }
+    return nullptr;
+}
+
+int ble_gattc_read_long(uint16_t conn_handle, uint16_t handle, uint16_t offset,
+                        ble_gatt_attr_fn* cb, void* cb_arg) {
+    NimBLEClient* client = clientFor(conn_handle);
+    if (client == nullptr) return BLE_HS_ENOTCONN;
+
+    wait(latency.gattRead);
+    const sim::Attribute* attr = findAttribute(client->peerCamera(), handle);
+    if (attr == nullptr || !attr->readable) {
+        ble_gatt_error error = {BLE_HS_ERR_ATT_BASE + BLE_ATT_ERR_INVALID_HANDLE, handle};
+        cb(conn_handle, &error, nullptr, cb_arg);
+        return 0;
+    }
+
+    std::string value;
+    {
+        sim::HeapExempt exempt;
+        value = client->peerCamera()->readAttribute(handle);
+        value = offset < value.size() ? value.substr(offset) : "";
+    }
+    os_mbuf om = {(const uint8_t*)value.data(), (uint16_t)value.size()};
+    ble_gatt_attr result = {handle, offset, &om};
+    ble_gatt_error ok = {0, handle};
+    cb(conn_handle, &ok, &result, cb_arg);
+
+    ble_gatt_error done = {BLE_HS_EDONE, handle};
+    cb(conn_handle, &done, nullptr, cb_arg);
+    return 0;
+}
+
+int ble_gattc_write_flat(uint16_t conn_handle, uint16_t attr_handle, const void* data,
+                         uint16_t data_len, ble_gatt_attr_fn* cb, void* cb_arg) {
+    NimBLEClient* client = clientFor(conn_handle);
+    if (client == nullptr) return BLE_HS_ENOTCONN;
+
+    // The camera sees the write halfway through the round trip
+    uint32_t rttMs = sim::sampleMs(latency.gattWrite.lo, latency.gattWrite.hi);
+    sim::advanceUs((uint64_t)rttMs * 500);
+    bool ok = client->peerCamera() != nullptr &&
+              client->peerCamera()->writeAttribute(attr_handle, (const uint8_t*)data, data_len);
+    sim::advanceUs((uint64_t)rttMs * 500);
+    ble_gatt_error error = {(uint16_t)(ok ? 0 : BLE_HS_ERR_ATT_BASE + BLE_ATT_ERR_INVALID_HANDLE), attr_handle};
+    ble_gatt_attr attr = {attr_handle, 0, nullptr};
+    cb(conn_handle, &error, &attr, cb_arg);
+    return 0;
+}
+
+int ble_gattc_write_no_rsp_flat(uint16_t conn_handle, uint16_t attr_handle,
+                                const void* data, uint16_t data_len) {
+    NimBLEClient* client = clientFor(conn_handle);
+    if (client == nullptr) return BLE_HS_ENOTCONN;
+
+    wait(sim::Range{5, 15});
+    client->peerCamera()->writeAttribute(attr_handle, (const uint8_t*)data, data_len);
+    return 0;
+}
+
+// Ranged discovery: one round trip for the results plus one that ends in
+// "attribute not found", as with a 255-byte MTU
+int ble_gattc_disc_all_chrs(uint16_t conn_handle, uint16_t start_handle, uint16_t end_handle,
+                            ble_gatt_chr_fn* cb, void* cb_arg) {
+    NimBLEClient* client = clientFor(conn_handle);
+    if (client == nullptr) return BLE_HS_ENOTCONN;
+
+    wait(latency.gattRead);
+    for (const auto& service : client->peerCamera()->services()) {
+        for (const auto& attr : service.characteristics) {
+            uint16_t defHandle = attr.handle - 1;
+            if (defHandle < start_handle || defHandle > end_handle) continue;
+
+            ble_gatt_chr chr = {};
+            chr.def_handle = defHandle;
+            chr.val_handle = attr.handle;
+            chr.properties = (attr.readable ? BLE_GATT_CHR_PROP_READ : 0) |
+                             (attr.writable ? BLE_GATT_CHR_PROP_WRITE : 0) |
+                             (attr.notifiable ? BLE_GATT_CHR_PROP_NOTIFY : 0);
+            chr.uuid = *NimBLEUUID(attr.uuid).getNative();
+            ble_gatt_error ok = {0, attr.handle};
+            cb(conn_handle, &ok, &chr, cb_arg);
+        }
+    }
+    wait(latency.gattRead);
+
+    ble_gatt_error done = {BLE_HS_EDONE, end_handle};
+    cb(conn_handle, &done, nullptr, cb_arg);
+    return 0;
+}
+
+// Find Information over the range: CCCDs, declarations and value handles
+// are told apart from the simulated table layout
+int ble_gattc_disc_all_dscs(uint16_t conn_handle, uint16_t start_handle, uint16_t end_handle,
+                            ble_gatt_dsc_fn* cb, void* cb_arg) {
+    NimBLEClient* client = clientFor(conn_handle);
+    if (client == nullptr) return BLE_HS_ENOTCONN;
+
+    const sim::Camera* cam = client->peerCamera();
+    wait(latency.gattRead);
+    for (uint32_t handle = start_handle + 1; handle <= end_handle; handle++) {
+        const sim::Attribute* before = findAttribute(cam, (uint16_t)(handle - 1));
+        const sim::Attribute* value = findAttribute(cam, (uint16_t)handle);
+        const sim::Attribute* after = findAttribute(cam, (uint16_t)(handle + 1));
+
+        ble_gatt_dsc dsc = {};
+        dsc.handle = (uint16_t)handle;
+        if (before != nullptr && before->notifiable) {
+            dsc.uuid = *NimBLEUUID((uint16_t)BLE_GATT_DSC_CLT_CFG_UUID16).getNative();
+        } else if (after != nullptr) {
+            dsc.uuid = *NimBLEUUID((uint16_t)BLE_ATT_UUID_CHARACTERISTIC).getNative();
+        } else if (value != nullptr) {
+            dsc.uuid = *NimBLEUUID(value->uuid).getNative();
+        } else {
+            dsc.uuid = *NimBLEUUID((uint16_t)BLE_ATT_UUID_PRIMARY_SERVICE).getNative();
+        }
+        ble_gatt_error ok = {0, dsc.handle};
+        cb(conn_handle, &ok, start_handle, &dsc, cb_arg);
+    }
+
+    ble_gatt_error done = {BLE_HS_EDONE, end_handle};
+    cb(conn_handle, &done, start_handle, nullptr, cb_arg);
+    return 0;
+}
+
+int ble_gap_conn_find(uint16_t handle, struct ble_gap_conn_desc* out_desc) {
+    if (clientFor(handle) == nullptr) return BLE_HS_ENOTCONN;
+    if (out_desc != nullptr) out_desc->conn_handle = handle;
+    return 0;
+}
+
+static std::vector<ble_gap_event_listener*> gapListeners;
+
+int ble_gap_event_listener_register(struct ble_gap_event_listener* listener,
+                                    ble_gap_event_fn* fn, void* arg) {
+    listener->fn = fn;
+    listener->arg = arg;
+    gapListeners.push_back(listener);
+    return 0;
+}
+
+// Notifications arrive one connection interval after the camera sends them
+static void deliverNotification(uint16_t connId, uint16_t handle, const std::string& value) {
+    uint64_t atUs = sim::nowUs() + (uint64_t)sim::sampleMs(5, 15) * 1000;
+    sim::schedule(atUs, [connId, handle, value]() {
+        if (clientFor(connId) == nullptr) return;
+        os_mbuf om = {(const uint8_t*)value.data(), (uint16_t)value.size()};
+        ble_gap_event event = {};
+        event.type = BLE_GAP_EVENT_NOTIFY_RX;
+        event.notify_rx.om = &om;
+        event.notify_rx.attr_handle = handle;
+        event.notify_rx.conn_handle = connId;
+        sim::FirmwareCallback firmware;
+        for (auto listener : gapListeners) listener->fn(&event, listener->arg);
+    });
+}
+
+// --- NimBLEScan -----------------------------------------------------------
+
+// Until a scan listening window out of every interval catches an
+// advertiser's next advertisement
+static uint64_t advertisementUs(uint16_t interval, uint16_t window) {
+    uint64_t us = (uint64_t)sim::sampleMs(latency.advertisement.lo, latency.advertisement.hi) * 1000;
+    return window < interval ? us * interval / window : us;
+}
+
+// AD structures of an advertisement: flags, the 16-bit service UUIDs
+// given, manufacturer data and (scan response) the complete local name
+static void encodePayload(NimBLEAdvertisedDevice& device, const std::vector<uint16_t>& uuids16) {
+    std::vector<uint8_t>& p = device.payload;
+    p = {0x02, 0x01, 0x06};
+    if (!uuids16.empty()) {
+        p.push_back((uint8_t)(1 + 2 * uuids16.size()));
+        p.push_back(0x03);
+        for (uint16_t uuid : uuids16) {
+            p.push_back(uuid & 0xff);
+            p.push_back(uuid >> 8);
+        }
+    }
+    if (device.haveManufacturerData()) {
+        p.push_back((uint8_t)(1 + device.manufacturerData.size()));
+        p.push_back(0xff);
+        p.insert(p.end(), device.manufacturerData.begin(), device.manufacturerData.end());
+    }
+    if (device.haveName()) {
+        std::string name = device.getName();
+        p.push_back((uint8_t)(1 + name.size()));
+        p.push_back(0x09);
+        p.insert(p.end(), name.begin(), name.end());
+    }
+}
+
+bool NimBLEScan::start(uint32_t duration, void (*scanCompleteCB)(NimBLEScanResults), bool is_continue) {
+    if (scanning) return false;
+    sim::HeapExempt exempt;
+    if (!is_continue) {
+        results.devices.clear();
+        reported.clear();
+    }
+
+    scanning = true;
+    startUs = sim::nowUs();
+    completeCB = scanCompleteCB;
+    uint32_t id = ++generation;
+    if (duration != 0) {
+        sim::schedule(sim::nowUs() + (uint64_t)duration * 1000000, [this, id]() {
+            if (scanning && id == generation) stop();
+        });
+    }
+
+    // Unrelated advertisers nearby (phones, beacons), some with Apple
+    // manufacturer data
+    for (uint32_t i = 0; i < sim::backgroundAdvertisers; i++) {
+        char addr[24];
+        snprintf(addr, sizeof(addr), "7c:%02x:11:22:33:%02x", i, i * 7 % 256);
+        NimBLEAdvertisedDevice device(i % 3 == 0 ? "" : "Phone", NimBLEAddress(addr));
+        if (i % 3 == 1) device.manufacturerData = std::string("\x4c\x00\x10\x05\x01\x18", 6);
+        encodePayload(device, {});
+        sim::schedule(sim::nowUs() + advertisementUs(interval, window), [this, id, device]() {
+            if (scanning && id == generation) report(device);
+        });
+    }
+
+    // Other crews' GoPros: paired elsewhere (not in pairing mode), and
+    // connections to them fail
+    for (uint32_t i = 0; i < sim::foreignGoPros; i++) {
+        char name[24];
+        char addr[24];
+        snprintf(name, sizeof(name), "GoPro %04u", 1200 + i);
+        snprintf(addr, sizeof(addr), "d4:d9:19:8a:%02x:%02x", i, 0x30 + i);
+        NimBLEAdvertisedDevice device(name, NimBLEAddress(addr));
+        device.services.push_back(NimBLEUUID((uint16_t)0xfea6));
+        if (activeScan) device.manufacturerData = std::string("\xf2\x02\x02\x01\x37\x0f\x5a\x11\x20\x31\x42\x53\x00", 13);
+        encodePayload(device, {0xfea6});
+        sim::schedule(sim::nowUs() + advertisementUs(interval, window), [this, id, device]() {
+            if (scanning && id == generation) report(device);
+        });
+    }
+
+    for (size_t i = 0; i < sim::cameras().size(); i++) watchCamera(i, id);
+    return true;
+}
+
+// Catch the camera's next advertisement (once it is on and has booted far
+// enough to advertise). Its name and FEA6 are in the advertisement itself, the
+// manufacturer data in the scan response.
+void NimBLEScan::watchCamera(size_t index, uint32_t id) {
+    sim::schedule(sim::nowUs() + advertisementUs(interval, window), [this, index, id]() {
+        if (!scanning || id != generation) return;
+        const sim::Camera& cam = sim::cameras()[index];
+        if (!cam.isAdvertising()) {
+            watchCamera(index, id);
+            return;
+        }
+        NimBLEAdvertisedDevice device(cam.name, NimBLEAddress(cam.address));
+        device.services.push_back(NimBLEUUID((uint16_t)0xfea6));
+        if (activeScan) device.manufacturerData = cam.manufacturerData();
+        encodePayload(device, {0xfea6});
+        report(device);
+    });
+}
+
+void NimBLEScan::report(const NimBLEAdvertisedDevice& device) {
+    // Dropped by the controller: the host never hears of it
+    if (policy == BLE_HCI_SCAN_FILT_USE_WL && !NimBLEDevice::onWhiteList(device.getAddress())) {
+        sim::advertisementsFiltered++;
+        return;
+    }
+    std::string address = device.getAddress().toString();
+    bool seen = false;
+    for (const std::string& other : reported) seen = seen || other == address;
+    if (seen && !duplicates) return;
+    if (!seen) reported.push_back(address);
+
+    if (!seen && results.devices.size() < resultLimit) results.devices.push_back(device);
+    if (deviceCallbacks != nullptr) {
+        sim::advertisementsReported++;
+        NimBLEAdvertisedDevice copy = device;
+        sim::FirmwareCallback firmware;
+        deviceCallbacks->onResult(&copy);
+    }
+}
+
+// Like NimBLE, stopping a scan hands what it kept to the completion callback
+bool NimBLEScan::stop() {
+    if (!scanning) return true;
+    scanning = false;
+    uint64_t listenUs = (sim::nowUs() - startUs) * (window < interval ? window : interval) / interval;
+    sim::scanListenUs += listenUs;
+    if (activeScan) sim::activeScanListenUs += listenUs;
+    sim::FirmwareCallback firmware;
+    if (completeCB != nullptr) completeCB(results);
+    return true;
+}
+
+// --- NimBLERemoteCharacteristic -------------------------------------------
+
+std::string NimBLERemoteCharacteristic::readValue() {
+    if (!client->isConnected()) return "";
+    wait(latency.gattRead);
+    sim::Camera* cam = client->peerCamera();
+    return cam != nullptr ? cam->readAttribute(handle) : "";
+}
+
+bool NimBLERemoteCharacteristic::writeValue(const uint8_t* data, size_t length, bool response) {
+    if (!client->isConnected()) return false;
+    wait(response ? latency.gattWrite : sim::Range{5, 15});
+    sim::Camera* cam = client->peerCamera();
+    return cam != nullptr && cam->writeAttribute(handle, data, length);
+}
+
+// --- NimBLERemoteService --------------------------------------------------
+
+NimBLERemoteService::~NimBLERemoteService() {
+    for (auto pChar : characteristics) delete pChar;
+}
+
+std::vector<NimBLERemoteCharacteristic*>* NimBLERemoteService::getCharacteristics(bool refresh) {
+    if (refresh) {
+        for (auto pChar : characteristics) delete pChar;
+        characteristics.clear();
+        if (!client->isConnected()) return &characteristics;
+
+        wait(latency.charDiscovery);
+        for (const auto& attr : definition.characteristics) {
+            characteristics.push_back(new NimBLERemoteCharacteristic(client, attr));
+        }
+    }
+    return &characteristics;
+}
+
+// --- NimBLEClient ---------------------------------------------------------
+
+NimBLEClient::~NimBLEClient() {
+    connections.erase(connId);
+    deleteServices();
+    if (ownsCallbacks) delete callbacks;
+}
+
+void NimBLEClient::deleteServices() {
+    for (auto pService : services) delete pService;
+    services.clear();
+}
+
+bool NimBLEClient::connect(const NimBLEAddress& address, bool deleteAttributes) {
+    if (deleteAttributes) deleteServices();
+
+    // The controller refuses another link at once when all are in use
+    if (connections.size() >= sim::maxConnections) {
+        return false;
+    }
+
+    sim::Camera* cam;
+    {
+        sim::HeapExempt exempt;
+        cam = sim::findCamera(address.toString());
+    }
+    if (cam == nullptr || !cam->isAdvertising()) {
+        sim::advanceMs(connectTimeout * 1000);
+        return false;
+    }
+
+    wait(latency.bleConnect);
+    cam->pairingMode = false;  // Paired (bonded) with us
+    connected = true;
+    connId = nextConnId++;
+    peerCam = cam;
+    linkGeneration = cam->generation;
+    peer = address;
+    {
+        sim::HeapExempt exempt;
+        connections[connId] = this;
+        uint16_t id = connId;
+        cam->resetSubscriptions();
+        cam->notify = [id](uint16_t handle, const std::string& value) {
+            deliverNotification(id, handle, value);
+        };
+    }
+    sim::leakHeap(sim::leakBytesPerConnect);
+    sim::FirmwareCallback firmware;
+    if (callbacks) callbacks->onConnect(this);
+    return true;
+}
+
+int NimBLEClient::disconnect(uint8_t reason) {
+    (void)reason;
+    if (!connected) return 0;
+    connected = false;
+    connections.erase(connId);
+    sim::FirmwareCallback firmware;
+    if (callbacks) callbacks->onDisconnect(this);
+    return 0;
+}
+
+bool NimBLEClient::isConnected() {
+    if (connected && (!peerCam->isPowered() || peerCam->generation != linkGeneration)) {
+        connected = false;
+        connections.erase(connId);
+        sim::FirmwareCallback firmware;
+        if (callbacks) callbacks->onDisconnect(this);
+    }
+    return connected;
+}
+
+sim::Camera* NimBLEClient::peerCamera() {
+    return isConnected() ? peerCam : nullptr;
+}
+
+void NimBLEClient::setClientCallbacks(NimBLEClientCallbacks* pCallbacks, bool deleteCallbacks) {
+    if (ownsCallbacks) delete callbacks;
+    callbacks = pCallbacks;
+    ownsCallbacks = deleteCallbacks;
+}
+
+std::vector<NimBLERemoteService*>* NimBLEClient::getServices(bool refresh) {
+    if (refresh) {
+        deleteServices();
+        if (!isConnected()) return &services;
+
+        wait(latency.serviceDiscovery);
+        for (const auto& service : peerCam->services()) {
+            services.push_back(new NimBLERemoteService(this, service));
+        }
+    }
+    return &services;
+}
+
+// Discover a single service by UUID (Find By Type Value, two round trips)
+NimBLERemoteService* NimBLEClient::getService(const NimBLEUUID& uuid) {
+    for (auto pService : services) {
+        if (pService->getUUID() == uuid) return pService;
+    }
+    if (!isConnected()) return nullptr;
+
+    wait(latency.gattRead);
+    wait(latency.gattRead);
+    for (const auto& service : peerCamera()->services()) {
+        if (NimBLEUUID(service.uuid) == uuid) {
+            services.push_back(new NimBLERemoteService(this, service));
+            return services.back();
+        }
+    }
+    return nullptr;
+}
+
+// --- NimBLEDevice ---------------------------------------------------------
+
+void NimBLEDevice::init(const std::string& deviceName) { (void)deviceName; }
+void NimBLEDevice::setPower(esp_power_level_t powerLevel) { (void)powerLevel; }
+
+NimBLEScan* NimBLEDevice::getScan() {
+    static NimBLEScan scan;
+    return &scan;
+}
+
+NimBLEClient* NimBLEDevice::createClient() {
+    return new NimBLEClient();
+}
+
+bool NimBLEDevice::whiteListAdd(const NimBLEAddress& address) {
+    if (onWhiteList(address)) return true;
+    if (whiteList.size() >= sim::whiteListSize) return false;
+    whiteList.push_back(address);
+    return true;
+}
+
+bool NimBLEDevice::whiteListRemove(const NimBLEAddress& address) {
+    for (auto it = whiteList.begin(); it != whiteList.end(); ++it) {
+        if (*it == address) {
+            whiteList.erase(it);
+            return true;
+        }
+    }
+    return true;
+}
+
+bool NimBLEDevice::onWhiteList(const NimBLEAddress& address) {
+    for (const NimBLEAddress& entry : whiteList) {
+        if (entry == address) return true;
+    }
+    return false;
+}
+
+size_t NimBLEDevice::getWhiteListCount() {
+    return whiteList.size();
+}
@@ -0,0 +1,81 @@
+#include <Preferences.h>
+
+#include "SimGoPro.h"
+
+#include <map>
+
+// NVS keys are limited to 15 characters, namespaces likewise
+#define NVS_KEY_MAX 15
+
+// Stands in for flash: its map nodes are not counted as firmware heap use
+static std::map<std::string, std::map<std::string, std::string>> storage;
+
+bool Preferences::begin(const char* name, bool ro) {
+    if (strlen(name) > NVS_KEY_MAX) return false;
+    space = name;
+    open = true;
+    readOnly = ro;
+    return true;
+}
+
+void Preferences::end() {
+    open = false;
+}
+
+bool Preferences::isKey(const char* key) {
+    sim::HeapExempt exempt;
+    return open && storage[space].count(key) != 0;
+}
+
+bool Preferences::remove(const char* key) {
+    sim::HeapExempt exempt;
+    if (!open || readOnly) return false;
+    return storage[space].erase(key) != 0;
+}
+
+bool Preferences::clear() {
+    sim::HeapExempt exempt;
+    if (!open || readOnly) return false;
+    storage[space].clear();
+    return true;
+}
+
+size_t Preferences::getBytesLength(const char* key) {
+    sim::HeapExempt exempt;
+    if (!isKey(key)) return 0;
+    return storage[space][key].size();
+}
+
+size_t Preferences::getBytes(const char* key, void* buf, size_t maxLen) {
+    sim::HeapExempt exempt;
+    size_t len = getBytesLength(key);
+    if (len == 0 || len > maxLen) return 0;
+    memcpy(buf, storage[space][key].data(), len);
+    return len;
+}
+
+String Preferences::getString(const char* key, const String& defaultValue) {
+    if (!isKey(key)) return defaultValue;
+    return String(storage[space][key]);
+}
+
+// Like the ESP32 core: length including the terminator, 0 if missing or too long
+size_t Preferences::getString(const char* key, char* value, size_t maxLen) {
+    sim::HeapExempt exempt;
+    if (!isKey(key)) return 0;
+    const std::string& stored = storage[space][key];
+    if (stored.size() + 1 > maxLen) return 0;
+    memcpy(value, stored.c_str(), stored.size() + 1);
+    return stored.size() + 1;
+}
+
+size_t Preferences::putString(const char* key, const char* value) {
+    return putBytes(key, value, strlen(value));
+}
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t len) {
+    sim::HeapExempt exempt;
+    if (!open || readOnly || strlen(key) > NVS_KEY_MAX) return 0;
+    storage[space][key].assign((const char*)value, len);
+    return len;
+}
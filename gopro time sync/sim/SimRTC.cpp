@@ -0,0 +1,61 @@
+#include <RTClib.h>
+
+TwoWire Wire;
+
+namespace sim {
+uint32_t rtcEpoch = 1763267884;  // 2025-11-16 04:38:04 UTC
+uint8_t rtcSqwPin = 4;
+}
+
+// Bumped on every SQW mode change, ending the previous edge chain
+static uint32_t sqwGeneration = 0;
+
+static void scheduleSqwEdge(uint32_t generation) {
+    uint64_t nextSecondUs = (sim::nowUs() / 1000000 + 1) * 1000000;
+    sim::schedule(nextSecondUs, [generation]() {
+        if (generation != sqwGeneration) return;
+        sim::raiseInterrupt(sim::rtcSqwPin, FALLING);
+        scheduleSqwEdge(generation);
+    }, true);
+}
+
+// Civil-from-days (Howard Hinnant), valid for the 2000-2099 range RTClib uses
+DateTime::DateTime(uint32_t t) {
+    ss = t % 60; t /= 60;
+    mm = t % 60; t /= 60;
+    hh = t % 24;
+    int32_t z = (int32_t)(t / 24) + 719468;
+    int32_t era = z / 146097;
+    uint32_t doe = (uint32_t)(z - era * 146097);
+    uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    uint32_t mp = (5 * doy + 2) / 153;
+    d = (uint8_t)(doy - (153 * mp + 2) / 5 + 1);
+    m = (uint8_t)(mp < 10 ? mp + 3 : mp - 9);
+    int32_t y = (int32_t)yoe + era * 400 + (m <= 2 ? 1 : 0);
+    yOff = (uint8_t)(y - 2000);
+}
+
+DateTime::DateTime(uint16_t year, uint8_t month, uint8_t day,
+                   uint8_t hour, uint8_t min, uint8_t sec)
+    : yOff((uint8_t)(year >= 2000 ? year - 2000 : year)), m(month), d(day),
+      hh(hour), mm(min), ss(sec) {}
+
+uint32_t DateTime::unixtime() const {
+    int32_t y = year() - (m <= 2 ? 1 : 0);
+    int32_t era = y / 400;
+    uint32_t yoe = (uint32_t)(y - era * 400);
+    uint32_t doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    uint32_t days = (uint32_t)(era * 146097 + (int32_t)doe - 719468);
+    return ((days * 24 + hh) * 60 + mm) * 60 + ss;
+}
+
+DateTime RTC_DS3231::now() {
+    return DateTime(sim::rtcEpoch + (uint32_t)(sim::nowUs() / 1000000));
+}
+
+void RTC_DS3231::writeSqwPinMode(Ds3231SqwPinMode mode) {
+    sqwGeneration++;
+    if (mode == DS3231_SquareWave1Hz) scheduleSqwEdge(sqwGeneration);
+}
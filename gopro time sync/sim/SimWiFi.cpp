@@ -0,0 +1,305 @@
+#include <WiFi.h>
+
+#include <algorithm>
+
+using sim::latency;
+
+WiFiClass WiFi;
+
+static uint64_t sampleUs(const sim::Range& range) {
+    return (uint64_t)sim::sampleMs(range.lo, range.hi) * 1000;
+}
+
+String IPAddress::toString() const {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%u.%u.%u.%u", octets[0], octets[1], octets[2], octets[3]);
+    return String(buf);
+}
+
+void WiFiClass::emit(arduino_event_id_t event, uint8_t reason) {
+    WiFiEventInfo_t info = {};
+    info.wifi_sta_disconnected.reason = reason;
+    sim::FirmwareCallback firmware;
+    for (const auto& handler : handlers) {
+        if (handler.second == ARDUINO_EVENT_MAX || handler.second == event) {
+            handler.first(event, info);
+        }
+    }
+}
+
+// The address is usable: GOT_IP. A static address another station holds
+// is counted as a conflict (it was taken without a probe answering).
+void WiFiClass::gotIP() {
+    if (staticAddress != IPAddress() && address[0] == 10 && address[1] == 5 && address[2] == 5) {
+        for (uint8_t occupied : joinedCamera->occupiedHosts) {
+            if (occupied == address[3]) sim::addressConflicts++;
+        }
+    }
+    emit(ARDUINO_EVENT_WIFI_STA_GOT_IP);
+}
+
+wifi_event_id_t WiFiClass::onEvent(WiFiEventFuncCb callback, arduino_event_id_t event) {
+    handlers.emplace_back(callback, event);
+    return handlers.size();
+}
+
+// The join is resolved up front: begin() decides the outcome and the time at
+// which status() flips, modelling scan (or a pinned-channel probe) +
+// association + DHCP, and schedules the matching events.
+wl_status_t WiFiClass::begin(const char* ssid, const char* passphrase,
+                             int32_t channel, const uint8_t* bssid, bool connect) {
+    (void)connect;
+    joining = true;
+    dhcpStopped = false;
+    uint32_t aid = ++addressId;
+    joinedCamera = sim::findCameraBySSID(ssid != nullptr ? ssid : "");
+    linkGeneration = joinedCamera != nullptr ? joinedCamera->generation : 0;
+    uint32_t id = ++joinId;
+
+    bool pinned = channel != 0 && bssid != nullptr;
+    uint64_t scanDoneUs = sim::nowUs() + sampleUs(pinned ? latency.wifiChannelProbe : latency.wifiScan);
+    bool apVisible = joinedCamera != nullptr && joinedCamera->isAPUp();
+    if (pinned) {
+        apVisible = apVisible && channel == joinedCamera->channel &&
+                    memcmp(bssid, joinedCamera->bssid, 6) == 0;
+    }
+
+    if (!apVisible) {
+        joinResult = WL_NO_SSID_AVAIL;
+        connectedAtUs = scanDoneUs;
+        sim::schedule(scanDoneUs, [this, id]() {
+            if (id == joinId && joining) emit(ARDUINO_EVENT_WIFI_STA_DISCONNECTED, WIFI_REASON_NO_AP_FOUND);
+        });
+        return WL_DISCONNECTED;
+    }
+
+    uint64_t assocDoneUs = scanDoneUs + sampleUs(latency.wifiAssociate);
+    if (passphrase == nullptr || joinedCamera->password != passphrase) {
+        joinResult = WL_CONNECT_FAILED;
+        connectedAtUs = assocDoneUs;
+        sim::schedule(assocDoneUs, [this, id]() {
+            if (id == joinId && joining) emit(ARDUINO_EVENT_WIFI_STA_DISCONNECTED, WIFI_REASON_AUTH_FAIL);
+        });
+        return WL_DISCONNECTED;
+    }
+
+    // A static address is usable on association; DHCP adds a lease exchange
+    joinResult = WL_CONNECTED;
+    associatedAtUs = assocDoneUs;
+    if (staticAddress != IPAddress()) {
+        connectedAtUs = assocDoneUs;
+        address = staticAddress;
+    } else {
+        connectedAtUs = assocDoneUs + sampleUs(latency.dhcp);
+        address = IPAddress(10, 5, 5, 100 + (uint8_t)sim::sampleMs(0, 100));
+    }
+    memcpy(joinedBSSID, joinedCamera->bssid, 6);
+    joinedChannel = joinedCamera->channel;
+    sim::schedule(assocDoneUs, [this, id]() {
+        if (id == joinId && joining) emit(ARDUINO_EVENT_WIFI_STA_CONNECTED);
+    });
+    sim::schedule(connectedAtUs, [this, id, aid]() {
+        if (id == joinId && joining && aid == addressId) gotIP();
+    });
+    return WL_DISCONNECTED;
+}
+
+// Switching while associated behaves like esp_netif: a static address
+// applies at once and fires GOT_IP, going back to DHCP starts a lease and
+// fires GOT_IP when it is bound.
+bool WiFiClass::config(IPAddress local, IPAddress gateway, IPAddress subnet,
+                       IPAddress dns1, IPAddress dns2) {
+    (void)gateway;
+    (void)subnet;
+    (void)dns1;
+    (void)dns2;
+    staticAddress = local;
+    dhcpStopped = local != IPAddress();
+    if (associatedCamera() == nullptr) return true;
+
+    uint32_t id = joinId;
+    uint32_t aid = ++addressId;
+    if (local != IPAddress()) {
+        address = local;
+        connectedAtUs = sim::nowUs();
+    } else {
+        connectedAtUs = sim::nowUs() + sampleUs(latency.dhcp);
+        address = IPAddress(10, 5, 5, 100 + (uint8_t)sim::sampleMs(0, 100));
+    }
+    sim::schedule(connectedAtUs, [this, id, aid]() {
+        if (id == joinId && joining && aid == addressId) gotIP();
+    });
+    return true;
+}
+
+// Without DHCP (and no static address) the station associates without an
+// address: status() stays WL_IDLE_STATUS until config() gives it one
+bool WiFiClass::simStopDhcp() {
+    if (dhcpStopped) return false;
+    dhcpStopped = true;
+    if (staticAddress == IPAddress()) {
+        address = IPAddress();
+        addressId++;
+    }
+    return true;
+}
+
+bool WiFiClass::simClearAddress() {
+    if (!dhcpStopped) return false;
+    staticAddress = IPAddress();
+    address = IPAddress();
+    addressId++;
+    return true;
+}
+
+uint8_t* WiFiClass::macAddress(uint8_t* mac) {
+    static const uint8_t kMac[6] = {0x24, 0x6f, 0x28, 0x1a, 0x5c, 0x31};
+    memcpy(mac, kMac, 6);
+    return mac;
+}
+
+uint8_t* WiFiClass::BSSID() {
+    return status() == WL_CONNECTED ? joinedBSSID : nullptr;
+}
+
+int32_t WiFiClass::channel() {
+    return status() == WL_CONNECTED ? joinedChannel : 0;
+}
+
+bool WiFiClass::disconnect(bool wifioff) {
+    joining = false;
+    joinId++;
+    joinResult = WL_DISCONNECTED;
+    if (wifioff) currentMode = WIFI_OFF;
+    return true;
+}
+
+wl_status_t WiFiClass::status() {
+    if (!joining) return WL_DISCONNECTED;
+    bool noAddress = joinResult == WL_CONNECTED && address == IPAddress();
+    if (sim::nowUs() < (noAddress ? associatedAtUs : connectedAtUs)) return WL_DISCONNECTED;
+    if (joinResult == WL_CONNECTED &&
+        (joinedCamera->generation != linkGeneration || !joinedCamera->isAPUp())) {
+        return WL_CONNECTION_LOST;
+    }
+    return noAddress ? WL_IDLE_STATUS : joinResult;
+}
+
+sim::Camera* WiFiClass::associatedCamera() {
+    wl_status_t s = status();
+    return s == WL_CONNECTED || s == WL_IDLE_STATUS ? joinedCamera : nullptr;
+}
+
+sim::Camera* WiFiClass::peerCamera() {
+    return status() == WL_CONNECTED ? joinedCamera : nullptr;
+}
+
+int WiFiClient::connect(IPAddress ip, uint16_t port) {
+    return connect(ip.toString().c_str(), port);
+}
+
+int WiFiClient::connect(const char* host, uint16_t port) {
+    stop();
+    sim::advanceUs(sampleUs(latency.tcpConnect));
+    sim::Camera* cam = WiFi.peerCamera();
+    if (cam == nullptr || strcmp(host, "10.5.5.9") != 0 || port != 80) {
+        return 0;
+    }
+    camera = cam;
+    generation = cam->generation;
+    socket = new uint8_t[64];
+    lastActivityUs = sim::nowUs();
+    sim::tcpConnects++;
+    return 1;
+}
+
+// The camera is still on the other end: not rebooted, station still on its
+// AP, and the connection not closed for idling
+bool WiFiClient::alive() {
+    if (socket == nullptr) return false;
+    if (WiFi.peerCamera() != camera || camera->generation != generation ||
+        sim::nowUs() - lastActivityUs > (uint64_t)CAMERA_HTTP_IDLE_MS * 1000) {
+        stop();
+        return false;
+    }
+    return true;
+}
+
+size_t WiFiClient::write(const uint8_t* buf, size_t size) {
+    if (!alive()) return 0;
+    sim::HeapExempt exempt;
+    request.append((const char*)buf, size);
+    lastActivityUs = sim::nowUs();
+
+    size_t end = request.find("\r\n\r\n");
+    if (end == std::string::npos) return size;
+    std::string head = request.substr(0, end);
+    request.erase(0, end + 4);
+
+    // "GET <path> HTTP/1.1"; the request takes half a round trip to arrive
+    sim::advanceUs(sampleUs(latency.tcpConnect) / 2);
+    if (!alive()) return size;
+    size_t pathStart = head.find(' ');
+    size_t pathEnd = head.find(' ', pathStart + 1);
+    std::string body;
+    int code = 400;
+    if (head.compare(0, 4, "GET ") == 0 && pathEnd != std::string::npos) {
+        code = camera->handleHttpGet(head.substr(pathStart + 1, pathEnd - pathStart - 1), body);
+    }
+    sim::httpRequests++;
+    sim::advanceUs(sampleUs(latency.httpResponse));
+
+    char header[112];
+    const char* reason = code == 200 ? "OK" : (code == 204 ? "No Content" : "Error");
+    if (code == 204) {
+        snprintf(header, sizeof(header), "HTTP/1.1 204 %s\r\nConnection: keep-alive\r\n\r\n", reason);
+    } else if (camera->httpChunked) {
+        snprintf(header, sizeof(header), "HTTP/1.1 %d %s\r\nTransfer-Encoding: chunked\r\nConnection: keep-alive\r\n\r\n",
+                 code, reason);
+    } else {
+        snprintf(header, sizeof(header), "HTTP/1.1 %d %s\r\nContent-Length: %u\r\nConnection: keep-alive\r\n\r\n",
+                 code, reason, (unsigned)body.size());
+    }
+    response.erase(0, readPos);
+    readPos = 0;
+    response += header;
+    if (code != 204 && camera->httpChunked) {
+        // Small chunks, so a field the firmware looks for spans a boundary
+        for (size_t at = 0; at < body.size(); at += 7) {
+            char size[8];
+            snprintf(size, sizeof(size), "%x\r\n", (unsigned)std::min<size_t>(7, body.size() - at));
+            response += size;
+            response.append(body, at, 7);
+            response += "\r\n";
+        }
+        response += "0\r\n\r\n";
+    } else if (code != 204) {
+        response += body;
+    }
+    lastActivityUs = sim::nowUs();
+    return size;
+}
+
+int WiFiClient::available() {
+    return (int)(response.size() - readPos);
+}
+
+int WiFiClient::read() {
+    if (readPos >= response.size()) return -1;
+    return (uint8_t)response[readPos++];
+}
+
+// Like the ESP32 client, unread data keeps a closed connection "connected"
+uint8_t WiFiClient::connected() {
+    return available() > 0 || alive();
+}
+
+void WiFiClient::stop() {
+    delete[] (uint8_t*)socket;
+    socket = nullptr;
+    camera = nullptr;
+    sim::HeapExempt exempt;
+    request.clear();
+    response.clear();
+    readPos = 0;
+}
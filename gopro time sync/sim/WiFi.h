@@ -0,0 +1,153 @@
+/**
+ * Host fake of the ESP32 Arduino WiFi API used by the firmware (native build only)
+ */
+
+#pragma once
+
+#include <Arduino.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+typedef enum {
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL = 1,
+    WL_SCAN_COMPLETED = 2,
+    WL_CONNECTED = 3,
+    WL_CONNECT_FAILED = 4,
+    WL_CONNECTION_LOST = 5,
+    WL_DISCONNECTED = 6,
+} wl_status_t;
+
+typedef enum {
+    WIFI_OFF = 0,
+    WIFI_STA = 1,
+    WIFI_AP = 2,
+    WIFI_AP_STA = 3,
+} wifi_mode_t;
+
+typedef enum {
+    ARDUINO_EVENT_WIFI_STA_START = 2,
+    ARDUINO_EVENT_WIFI_STA_CONNECTED = 4,
+    ARDUINO_EVENT_WIFI_STA_DISCONNECTED = 5,
+    ARDUINO_EVENT_WIFI_STA_GOT_IP = 7,
+    ARDUINO_EVENT_WIFI_STA_LOST_IP = 8,
+    ARDUINO_EVENT_MAX = 41,
+} arduino_event_id_t;
+
+// Disconnect reason codes (esp_wifi_types.h)
+#define WIFI_REASON_AUTH_EXPIRE              2
+#define WIFI_REASON_4WAY_HANDSHAKE_TIMEOUT   15
+#define WIFI_REASON_BEACON_TIMEOUT           200
+#define WIFI_REASON_NO_AP_FOUND              201
+#define WIFI_REASON_AUTH_FAIL                202
+#define WIFI_REASON_ASSOC_FAIL               203
+#define WIFI_REASON_HANDSHAKE_TIMEOUT        204
+
+typedef struct {
+    uint8_t ssid[33];
+    uint8_t ssid_len;
+    uint8_t bssid[6];
+    uint8_t reason;
+} wifi_event_sta_disconnected_t;
+
+typedef union {
+    wifi_event_sta_disconnected_t wifi_sta_disconnected;
+} arduino_event_info_t;
+
+typedef arduino_event_id_t WiFiEvent_t;
+typedef arduino_event_info_t WiFiEventInfo_t;
+typedef void (*WiFiEventFuncCb)(WiFiEvent_t event, WiFiEventInfo_t info);
+typedef size_t wifi_event_id_t;
+
+class IPAddress {
+public:
+    IPAddress() {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : octets{a, b, c, d} {}
+
+    uint8_t operator[](int index) const { return octets[index]; }
+    bool operator==(const IPAddress& other) const { return memcmp(octets, other.octets, 4) == 0; }
+    bool operator!=(const IPAddress& other) const { return !(*this == other); }
+    String toString() const;
+
+private:
+    uint8_t octets[4] = {0, 0, 0, 0};
+};
+
+class WiFiClass {
+public:
+    bool mode(wifi_mode_t m) { currentMode = m; return true; }
+    wl_status_t begin(const char* ssid, const char* passphrase = nullptr,
+                      int32_t channel = 0, const uint8_t* bssid = nullptr, bool connect = true);
+    bool config(IPAddress local, IPAddress gateway, IPAddress subnet,
+                IPAddress dns1 = IPAddress(), IPAddress dns2 = IPAddress());
+    bool disconnect(bool wifioff = false);
+    wl_status_t status();
+    IPAddress localIP() { return status() == WL_CONNECTED ? address : IPAddress(); }
+    uint8_t* macAddress(uint8_t* mac);
+    uint8_t* BSSID();
+    int32_t channel();
+    wifi_event_id_t onEvent(WiFiEventFuncCb callback, arduino_event_id_t event = ARDUINO_EVENT_MAX);
+
+    // Simulation: camera whose AP the station is on (null if not connected)
+    sim::Camera* peerCamera();
+    // Simulation: camera the station is associated with, address or not
+    sim::Camera* associatedCamera();
+    // Simulation: esp_netif_dhcpc_stop() (false if already stopped) and
+    // esp_netif_set_ip_info() to 0.0.0.0 (false while DHCP runs)
+    bool simStopDhcp();
+    bool simClearAddress();
+
+private:
+    void emit(arduino_event_id_t event, uint8_t reason = 0);
+    void gotIP();
+
+    std::vector<std::pair<WiFiEventFuncCb, arduino_event_id_t>> handlers;
+    uint32_t joinId = 0;               // Invalidates events of superseded joins
+    uint8_t joinedBSSID[6] = {0};
+    int32_t joinedChannel = 0;
+    wifi_mode_t currentMode = WIFI_OFF;
+    wl_status_t joinResult = WL_DISCONNECTED;
+    bool joining = false;
+    uint64_t associatedAtUs = 0;
+    uint64_t connectedAtUs = 0;        // Associated with an address
+    uint32_t addressId = 0;            // Invalidates GOT_IP of superseded addresses
+    bool dhcpStopped = false;
+    uint32_t linkGeneration = 0;
+    sim::Camera* joinedCamera = nullptr;
+    IPAddress address;
+    IPAddress staticAddress;           // 0.0.0.0 = DHCP
+};
+
+extern WiFiClass WiFi;
+
+// TCP client to the camera's HTTP server. connect() costs one handshake;
+// a request is answered once it has been written in full, after half a
+// round trip plus the camera's processing time. The camera closes a
+// connection left idle for CAMERA_HTTP_IDLE_MS.
+class WiFiClient {
+public:
+    WiFiClient() {}
+    WiFiClient(const WiFiClient&) = delete;
+    WiFiClient& operator=(const WiFiClient&) = delete;
+    ~WiFiClient() { stop(); }
+
+    int connect(IPAddress ip, uint16_t port);
+    int connect(const char* host, uint16_t port);
+    size_t write(const uint8_t* buf, size_t size);
+    int available();
+    int read();
+    uint8_t connected();
+    void stop();
+
+private:
+    bool alive();
+
+    sim::Camera* camera = nullptr;
+    uint32_t generation = 0;
+    void* socket = nullptr;            // Per-connection state, allocated like the ESP32 client's
+    uint64_t lastActivityUs = 0;
+    std::string request;               // Written, not yet complete
+    std::string response;              // Received, read up to readPos
+    size_t readPos = 0;
+};
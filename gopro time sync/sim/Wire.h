@@ -0,0 +1,14 @@
+/**
+ * Host fake of the Arduino Wire (I2C) API (native build only)
+ */
+
+#pragma once
+
+#include <Arduino.h>
+
+class TwoWire {
+public:
+    bool begin() { return true; }
+};
+
+extern TwoWire Wire;
@@ -0,0 +1,9 @@
+/**
+ * Host fake of the esp_netif network stack accessor (native build only)
+ */
+
+#pragma once
+
+#include <esp_netif.h>
+
+void* esp_netif_get_netif_impl(esp_netif_t* esp_netif);
@@ -0,0 +1,41 @@
+/**
+ * Host fake of the lwIP ARP API used by the firmware (native build only)
+ *
+ * A request for an address held by another simulated station is answered
+ * (latency.arpReply) like lwIP handles a reply: a pending entry for the
+ * address is filled in, nothing else is added.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <sys/types.h>
+
+typedef int8_t err_t;
+#define ERR_OK 0
+#define ERR_MEM -1
+#define ERR_IF -12
+
+typedef struct ip4_addr {
+    uint32_t addr;                     // Network byte order
+} ip4_addr_t;
+
+#define IP4_ADDR(ipaddr, a, b, c, d) \
+    ((ipaddr)->addr = (uint32_t)(a) | ((uint32_t)(b) << 8) | ((uint32_t)(c) << 16) | ((uint32_t)(d) << 24))
+
+struct eth_addr {
+    uint8_t addr[6];
+};
+
+struct netif;
+struct pbuf;
+
+// Request for ipaddr from the station's current address (q: queued packet,
+// unused by the firmware); leaves a pending entry
+err_t etharp_query(struct netif* netif, const ip4_addr_t* ipaddr, struct pbuf* q);
+
+// Index of the resolved entry for ipaddr, or -1
+ssize_t etharp_find_addr(struct netif* netif, const ip4_addr_t* ipaddr, struct eth_addr** eth_ret,
+                         const ip4_addr_t** ip_ret);
+
+void etharp_cleanup_netif(struct netif* netif);
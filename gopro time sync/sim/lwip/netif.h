@@ -0,0 +1,12 @@
+/**
+ * Host fake of the lwIP netif the firmware hands to the ARP API (native
+ * build only)
+ */
+
+#pragma once
+
+#include "lwip/etharp.h"
+
+struct netif {
+    uint8_t hwaddr[6];
+};
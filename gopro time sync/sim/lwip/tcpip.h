@@ -0,0 +1,12 @@
+/**
+ * Host fake of lwIP tcpip_callback (native build only): the callback runs as
+ * a sim event, asynchronously to the caller like on the tcpip thread
+ */
+
+#pragma once
+
+#include "lwip/etharp.h"
+
+typedef void (*tcpip_callback_fn)(void* ctx);
+
+err_t tcpip_callback(tcpip_callback_fn function, void* ctx);
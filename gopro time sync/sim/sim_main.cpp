@@ -0,0 +1,358 @@
+/**
+ * Native benchmark runner
+ *
+ * Boots the firmware against the simulated GoPros, then power-cycles the
+ * cameras repeatedly and measures the virtual time from power-on to the
+ * moment the last camera's clock is set. Usage:
+ *
+ *   .pio/build/native/program [--cameras N] [--cycles N] [--seed S] [--off-ms MS]
+ *                             [--rotate-password] [--occupy-ip HOST]
+ *                             [--reject-ble-time] [--ap-on] [--foreign N] [--no-sqw]
+ *                             [--late-apply-ms MS] [--drift-ppm PPM] [--http-204] [--http-chunked]
+ *                             [--soak-hours H] [--leak-bytes N] [--verbose]
+ *
+ * --cameras runs a rig of N cameras (all with the options below).
+ * --rotate-password changes the camera's WiFi password halfway through, to
+ * exercise the credential cache refresh path. --occupy-ip puts another
+ * station on 10.5.5.HOST (repeatable), to exercise static IP collisions;
+ * taking an address that station holds fails the run.
+ * --reject-ble-time makes the camera refuse Set Date/Time over BLE, to
+ * exercise the WiFi/HTTP fallback. --ap-on has the camera bring its WiFi AP
+ * up by itself at power-on, to exercise the join without a BLE connection
+ * (with --reject-ble-time). --foreign puts N GoPros of another rig in
+ * range, paired elsewhere, to exercise the paired camera whitelist.
+ * --no-sqw leaves the DS3231 SQW pin unconnected, so the set-time request
+ * is sent unaligned. --late-apply-ms makes the camera start the written
+ * second up to MS late, to exercise the read-back verification and re-set.
+ * --http-204 makes the camera answer an HTTP Set Date/Time with "204 No
+ * Content" and --http-chunked send HTTP bodies chunked (with
+ * --reject-ble-time), to exercise the response reader.
+ * --drift-ppm makes the camera clock run fast (or slow, if negative);
+ * --soak-hours then leaves the cameras on for H virtual hours after the
+ * power cycles and reports how often they were re-synced and how far off
+ * the worst one got in between.
+ *
+ * The firmware's heap allocations are counted per power cycle: after the
+ * cold boot (first discovery, client creation) a reconnect or a periodic
+ * sync must not touch the heap, and any that does fails the run. The WiFi/HTTP fallback
+ * (--reject-ble-time) opens a WiFiClient connection per sync, which
+ * allocates its socket state, and is only reported.
+ *
+ * --leak-bytes makes every BLE connect leak N bytes of heap outside
+ * operator new, as a library might; the firmware's memory telemetry must
+ * then raise its downward trend alarm, and must not raise it otherwise.
+ */
+
+#include <Arduino.h>
+#include <RTClib.h>
+
+#include "memory_watch.h"
+#include "serial_log.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+void setup();
+void loop();
+
+static const uint64_t CYCLE_TIMEOUT_US = 300ULL * 1000000;  // Give up on a cycle after 5 minutes
+static const uint64_t QUIET_US = 3000000;                   // No set or clock read this long = sync finished
+
+static uint32_t restarts = 0;
+
+// The serial log's drain task, which does not run here: it prints what
+// the firmware queued between engine passes, on the UART but without
+// holding up the firmware
+static void drainLog() {
+    sim::serialFromOtherTask = true;
+    logDrain();
+    sim::serialFromOtherTask = false;
+}
+
+// Run setup() the way the ROM bootloader would: again after every ESP.restart()
+static void boot() {
+    sim::FirmwareCallback firmware;
+    for (;;) {
+        try {
+            setup();
+            drainLog();
+            return;
+        } catch (const SimRestart&) {
+            restarts++;
+        }
+    }
+}
+
+// Heap allocations the firmware made inside step(). The runner itself
+// (its sample vectors) runs exempt, so it does not show in the firmware's
+// heap figures either.
+static uint64_t firmwareAllocations = 0;
+
+static void step() {
+    sim::FirmwareCallback firmware;
+    uint64_t before = sim::heapAllocations;
+    try {
+        loop();
+        drainLog();
+    } catch (const SimRestart&) {
+        restarts++;
+        boot();
+    }
+    firmwareAllocations += sim::heapAllocations - before;
+}
+
+// Camera clock minus DS3231 time
+static int64_t cameraOffsetUs(const sim::Camera& cam) {
+    return (int64_t)(cam.clockUs() - ((uint64_t)sim::rtcEpoch * 1000000 + sim::nowUs()));
+}
+
+// Every camera has had its clock set since it was powered on
+static bool allSet() {
+    for (const sim::Camera& cam : sim::cameras()) {
+        if (cam.firstTimeSetUs == 0) return false;
+    }
+    return true;
+}
+
+// Step until no camera has been set or read for QUIET_US (verification and
+// re-sets done), so offsets are taken from settled clocks
+static void settle() {
+    uint64_t until = sim::nowUs() + CYCLE_TIMEOUT_US;
+    for (;;) {
+        uint64_t lastUs = 0;
+        for (const sim::Camera& cam : sim::cameras()) {
+            lastUs = std::max(lastUs, std::max(cam.lastTimeSetUs, cam.lastClockReadUs));
+        }
+        if (sim::nowUs() >= lastUs + QUIET_US || sim::nowUs() >= until) return;
+        step();
+    }
+}
+
+static uint64_t percentile(std::vector<uint64_t> sorted, double p) {
+    size_t index = (size_t)(p * (sorted.size() - 1) + 0.5);
+    return sorted[index];
+}
+
+int main(int argc, char** argv) {
+    sim::HeapExempt runner;
+    uint32_t cameras = 1;
+    uint32_t cycles = 20;
+    uint32_t seed = 1;
+    uint32_t offMs = 15000;
+    uint32_t soakHours = 0;
+    bool rotatePassword = false;
+    bool rejectBleTime = false;
+    bool apOn = false;
+    bool httpNoContent = false;
+    bool httpChunked = false;
+    double driftPpm = 0;
+    std::vector<uint8_t> occupiedHosts;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--cameras") && i + 1 < argc) cameras = (uint32_t)atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--cycles") && i + 1 < argc) cycles = (uint32_t)atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--seed") && i + 1 < argc) seed = (uint32_t)atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--off-ms") && i + 1 < argc) offMs = (uint32_t)atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--rotate-password")) rotatePassword = true;
+        else if (!strcmp(argv[i], "--occupy-ip") && i + 1 < argc) {
+            occupiedHosts.push_back((uint8_t)atoi(argv[++i]));
+        }
+        else if (!strcmp(argv[i], "--reject-ble-time")) rejectBleTime = true;
+        else if (!strcmp(argv[i], "--ap-on")) apOn = true;
+        else if (!strcmp(argv[i], "--foreign") && i + 1 < argc) sim::foreignGoPros = (uint32_t)atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--no-sqw")) sim::rtcSqwPin = 0xff;
+        else if (!strcmp(argv[i], "--late-apply-ms") && i + 1 < argc) {
+            sim::latency.clockApply = {0, (uint32_t)atoi(argv[++i])};
+        }
+        else if (!strcmp(argv[i], "--http-204")) httpNoContent = true;
+        else if (!strcmp(argv[i], "--http-chunked")) httpChunked = true;
+        else if (!strcmp(argv[i], "--drift-ppm") && i + 1 < argc) driftPpm = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--soak-hours") && i + 1 < argc) soakHours = (uint32_t)atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--leak-bytes") && i + 1 < argc) {
+            sim::leakBytesPerConnect = (uint32_t)atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--verbose")) sim::verbose = true;
+        else {
+            fprintf(stderr, "usage: %s [--cameras N] [--cycles N] [--seed S] [--off-ms MS] [--rotate-password] [--occupy-ip HOST] [--reject-ble-time] [--ap-on] [--foreign N] [--no-sqw] [--late-apply-ms MS] [--drift-ppm PPM] [--http-204] [--http-chunked] [--soak-hours H] [--leak-bytes N] [--verbose]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    sim::seed(seed);
+    for (uint32_t i = 1; i < cameras; i++) {
+        sim::addCamera();
+    }
+    for (sim::Camera& cam : sim::cameras()) {
+        cam.occupiedHosts = occupiedHosts;
+        cam.bleDateTimeSupported = !rejectBleTime;
+        cam.apOnAtBoot = apOn;
+        cam.httpNoContent = httpNoContent;
+        cam.httpChunked = httpChunked;
+        cam.clockDriftPpm = driftPpm;
+    }
+
+    // Cold boot: cameras and sync unit powered at the same time
+    for (sim::Camera& cam : sim::cameras()) cam.powerOn();
+    boot();
+    while (!allSet() && sim::nowUs() < CYCLE_TIMEOUT_US) step();
+    if (!allSet()) {
+        fprintf(stderr, "[SIM] Cold boot did not sync every camera\n");
+        return 1;
+    }
+    uint64_t coldUs = 0;
+    for (const sim::Camera& cam : sim::cameras()) {
+        coldUs = std::max(coldUs, cam.firstTimeSetUs - cam.poweredOnAtUs);
+    }
+
+    std::vector<uint64_t> samples;       // Power-on until the last camera is set
+    std::vector<uint64_t> offsets;       // |camera - RTC| after each sync, every camera
+    uint32_t failures = 0;
+    uint64_t cycleAllocationsMax = 0;    // Heap allocations of the worst power cycle
+    uint32_t allocatingCycles = 0;
+
+    for (uint32_t cycle = 0; cycle < cycles; cycle++) {
+        uint64_t allocationsBefore = firmwareAllocations;
+        settle();
+        for (sim::Camera& cam : sim::cameras()) {
+            offsets.push_back((uint64_t)llabs(cameraOffsetUs(cam)));
+            cam.powerOff();
+            if (rotatePassword && cycle == cycles / 2) {
+                cam.password = "n3w-Pa55-w0rd";
+            }
+        }
+        uint64_t offUntil = sim::nowUs() + (uint64_t)offMs * 1000;
+        while (sim::nowUs() < offUntil) step();
+
+        for (sim::Camera& cam : sim::cameras()) cam.powerOn();
+        uint64_t poweredOnUs = sim::nowUs();
+        while (!allSet() && sim::nowUs() - poweredOnUs < CYCLE_TIMEOUT_US) step();
+
+        uint64_t cycleAllocations = firmwareAllocations - allocationsBefore;
+        cycleAllocationsMax = std::max(cycleAllocationsMax, cycleAllocations);
+        if (cycleAllocations > 0) allocatingCycles++;
+
+        if (!allSet()) {
+            failures++;
+            continue;
+        }
+        uint64_t rigUs = 0;
+        for (const sim::Camera& cam : sim::cameras()) {
+            rigUs = std::max(rigUs, cam.firstTimeSetUs - cam.poweredOnAtUs);
+        }
+        samples.push_back(rigUs);
+    }
+    settle();
+    for (const sim::Camera& cam : sim::cameras()) {
+        offsets.push_back((uint64_t)llabs(cameraOffsetUs(cam)));
+    }
+
+    // Soak: cameras stay on, periodic syncs only
+    uint32_t soakSets = 0;
+    uint64_t soakMaxOffsetUs = 0;
+    uint64_t soakAllocations = firmwareAllocations;
+    if (soakHours > 0) {
+        uint32_t before = 0;
+        for (const sim::Camera& cam : sim::cameras()) before += cam.timeSetCount;
+        uint64_t soakUntil = sim::nowUs() + (uint64_t)soakHours * 3600 * 1000000;
+        while (sim::nowUs() < soakUntil) {
+            for (const sim::Camera& cam : sim::cameras()) {
+                soakMaxOffsetUs = std::max(soakMaxOffsetUs, (uint64_t)llabs(cameraOffsetUs(cam)));
+            }
+            step();
+        }
+        for (const sim::Camera& cam : sim::cameras()) soakSets += cam.timeSetCount;
+        soakSets -= before;
+    }
+    soakAllocations = firmwareAllocations - soakAllocations;
+
+    uint32_t timeSets = 0;
+    for (const sim::Camera& cam : sim::cameras()) timeSets += cam.timeSetCount;
+
+    printf("[SIM] Rig of %u camera(s), time-to-sync of the last camera\n", cameras);
+    printf("[SIM] Cold boot time-to-sync: %llu ms\n", (unsigned long long)(coldUs / 1000));
+    printf("[SIM] Reconnect time-to-sync over %u power cycles (seed %u):\n", cycles, seed);
+    if (!samples.empty()) {
+        std::sort(samples.begin(), samples.end());
+        uint64_t total = 0;
+        for (uint64_t s : samples) total += s;
+        printf("[SIM]   min %llu ms, p50 %llu ms, p95 %llu ms, max %llu ms, mean %llu ms\n",
+               (unsigned long long)(samples.front() / 1000),
+               (unsigned long long)(percentile(samples, 0.50) / 1000),
+               (unsigned long long)(percentile(samples, 0.95) / 1000),
+               (unsigned long long)(samples.back() / 1000),
+               (unsigned long long)(total / samples.size() / 1000));
+    }
+    printf("[SIM]   failed cycles: %u, restarts: %u, time sets: %u for %u syncs\n", failures, restarts,
+           timeSets, (cycles + 1 - failures) * cameras);
+    if (!offsets.empty()) {
+        std::sort(offsets.begin(), offsets.end());
+        printf("[SIM] Camera clock offset from RTC: p50 %.1f ms, p95 %.1f ms, max %.1f ms\n",
+               percentile(offsets, 0.50) / 1000.0, percentile(offsets, 0.95) / 1000.0,
+               offsets.back() / 1000.0);
+    }
+
+    if (soakHours > 0) {
+        printf("[SIM] Soak %u h at %+.1f ppm: %u time sets, max camera offset %.1f ms, heap allocations %llu\n",
+               soakHours, driftPpm, soakSets, soakMaxOffsetUs / 1000.0, (unsigned long long)soakAllocations);
+    }
+
+    printf("[SIM] BLE scanner listening %.1f%% of the time (active scanning %.1f%%)\n",
+           100.0 * sim::scanListenUs / sim::nowUs(), 100.0 * sim::activeScanListenUs / sim::nowUs());
+    printf("[SIM] Serial output held up the firmware %.1f ms (log records dropped: %u)\n",
+           sim::serialBlockedUs / 1000.0, (unsigned)logDropped());
+    printf("[SIM] Heap allocations by the firmware per power cycle: max %llu (%u of %u cycles allocated)\n",
+           (unsigned long long)cycleAllocationsMax, allocatingCycles, cycles);
+    MemoryStatus memory;
+    memoryWatchStatus(memory);
+    printf("[SIM] Free heap %u bytes (min %u) after %u sync cycles: trend %+d bytes/cycle, %u leak alarm(s)\n",
+           (unsigned)ESP.getFreeHeap(), (unsigned)memory.minFreeHeap, (unsigned)memory.cycles,
+           (int)memory.slopeBytes, (unsigned)memory.alarms);
+    if (sim::httpRequests > 0) {
+        printf("[SIM] TCP connections to the cameras: %u for %u HTTP requests\n",
+               (unsigned)sim::tcpConnects, (unsigned)sim::httpRequests);
+    }
+    printf("[SIM] BLE advertisements reported to the host: %llu (%llu dropped by the controller whitelist)\n",
+           (unsigned long long)sim::advertisementsReported, (unsigned long long)sim::advertisementsFiltered);
+
+    printf("[SIM] Per-phase latency (last %d samples):\n", TRACE_WINDOW);
+    printf("[SIM]   %-14s %6s %6s %8s %8s %8s %8s\n", "phase", "count", "fail", "min ms", "p50 ms", "p95 ms", "max ms");
+    for (uint8_t i = 0; i < TRACE_PHASE_COUNT; i++) {
+        TraceStats s;
+        if (!traceGetStats((TracePhase)i, s)) continue;
+        printf("[SIM]   %-14s %6u %6u %8.1f %8.1f %8.1f %8.1f\n", tracePhaseName((TracePhase)i),
+               (unsigned)s.count, (unsigned)s.failures, s.minUs / 1000.0, s.p50Us / 1000.0,
+               s.p95Us / 1000.0, s.maxUs / 1000.0);
+    }
+
+    if (sim::addressConflicts > 0) {
+        printf("[SIM] FAIL: took a static IP another station holds (%u times)\n", (unsigned)sim::addressConflicts);
+        return 1;
+    }
+    // The reply's framing changes nothing on the camera, so every set it
+    // applied must have been taken as done, not timed out and sent again
+    bool framingOnly = (httpNoContent || httpChunked) && sim::latency.clockApply.hi == 0 && soakHours == 0;
+    if (framingOnly && timeSets > (cycles + 1 - failures) * cameras) {
+        printf("[SIM] FAIL: time sets the camera applied were sent again (%u for %u syncs)\n", timeSets,
+               (cycles + 1 - failures) * cameras);
+        return 1;
+    }
+    if (sim::leakBytesPerConnect == 0 && memory.alarms > 0) {
+        printf("[SIM] FAIL: memory leak alarm without a leak\n");
+        return 1;
+    }
+    if (sim::leakBytesPerConnect > 0 && memory.cycles >= MEMORY_TREND_CYCLES && memory.alarms == 0) {
+        printf("[SIM] FAIL: the injected leak raised no alarm\n");
+        return 1;
+    }
+
+    // WiFiClient allocates its socket state per connection; only the BLE
+    // path is heap-free
+    if ((allocatingCycles > 0 || soakAllocations > 0) && !rejectBleTime) {
+        printf("[SIM] FAIL: the firmware allocated on the heap during a power cycle\n");
+        return 1;
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,102 @@
+#include "camera_table.h"
+#include "gopro_ble.h"
+#include "serial_log.h"
+
+static GoProCamera cameras[CAMERA_MAX];
+static uint8_t count = 0;
+
+static const char* const STATE_NAMES[CAMERA_STATE_COUNT] = {
+    "absent", "found", "wait_ap", "wait_wifi", "wifi_join", "drift", "align", "verify", "synced",
+};
+
+uint8_t cameraCount() {
+    return count;
+}
+
+GoProCamera& cameraAt(uint8_t index) {
+    return cameras[index];
+}
+
+uint8_t cameraIndex(const GoProCamera& camera) {
+    return (uint8_t)(&camera - cameras);
+}
+
+GoProCamera* cameraFind(const NimBLEAddress& address) {
+    for (uint8_t i = 0; i < count; i++) {
+        if (cameras[i].address == address) {
+            return &cameras[i];
+        }
+    }
+    return nullptr;
+}
+
+GoProCamera* cameraAdd(const NimBLEAddress& address) {
+    GoProCamera* camera = cameraFind(address);
+    if (camera != nullptr || count == CAMERA_MAX) {
+        return camera;
+    }
+
+    camera = &cameras[count++];
+    *camera = {};
+    camera->address = address;
+    camera->state = CAMERA_ABSENT;
+    return camera;
+}
+
+GoProCamera* cameraForConnection(uint16_t connId) {
+    for (uint8_t i = 0; i < count; i++) {
+        NimBLEClient* client = cameras[i].client;
+        if (client != nullptr && client->getConnId() == connId) {
+            return &cameras[i];
+        }
+    }
+    return nullptr;
+}
+
+uint8_t cameraLinks() {
+    uint8_t links = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        if (cameras[i].client != nullptr && cameras[i].client->isConnected()) {
+            links++;
+        }
+    }
+    return links;
+}
+
+void cameraSetState(GoProCamera& camera, CameraState state) {
+    if (camera.state != state) {
+        LOG_INFO(CAM, "%s: %s -> %s", goProAddressText(camera.address).c_str(),
+                 STATE_NAMES[camera.state], STATE_NAMES[state]);
+    }
+    camera.state = state;
+    camera.stateSinceUs = micros();
+    camera.wakeMs = millis();
+}
+
+uint32_t cameraStateMs(const GoProCamera& camera) {
+    return (micros() - camera.stateSinceUs) / 1000;
+}
+
+void cameraWakeAfter(GoProCamera& camera, uint32_t delayMs) {
+    camera.wakeMs = millis() + delayMs;
+}
+
+bool cameraAwake(const GoProCamera& camera) {
+    return (int32_t)(millis() - camera.wakeMs) >= 0;
+}
+
+const char* cameraStateName(CameraState state) {
+    return state < CAMERA_STATE_COUNT ? STATE_NAMES[state] : "?";
+}
+
+void cameraTableDump() {
+    Serial.println("#camera,address,id,advert_status,state,link,parked,last_sync_ms,interval_ms");
+    for (uint8_t i = 0; i < count; i++) {
+        const GoProCamera& c = cameras[i];
+        const uint8_t* id = c.advert.idHash;
+        Serial.printf("camera,%s,%02x%02x%02x%02x%02x%02x,0x%02x,%s,%s,%u,%lu,%lu\n",
+                      goProAddressText(c.address).c_str(), id[0], id[1], id[2], id[3], id[4], id[5],
+                      c.advert.status, STATE_NAMES[c.state], c.bleLink ? "ble" : "http",
+                      (unsigned)c.parked, (unsigned long)c.lastSyncMs, (unsigned long)c.syncIntervalMs);
+    }
+}
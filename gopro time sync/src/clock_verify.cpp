@@ -0,0 +1,213 @@
+#include "clock_verify.h"
+#include "gopro_ble.h"
+#include "rtc_edge.h"
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include <algorithm>
+
+#define SYNC_LOG_NAMESPACE "synclog"
+#define SYNC_LOG_VERSION 1
+#define READ_MIN_LEAD_US 2000      // Time needed to issue a read before its slot
+
+// One verification, in an NVS slot of its own ("r0" to "r31"), so an append
+// writes one record rather than the whole log; bump SYNC_LOG_VERSION if the
+// layout changes
+struct SyncLogRecord {
+    uint8_t version;
+    uint8_t transport;         // LinkTransport
+    uint8_t sets;              // Set requests it took
+    uint8_t reads;
+    uint32_t sequence;         // Appends before this one; the newest has the highest
+    char camera[13];           // BLE address as 12 hex digits
+    uint32_t rtcTime;          // Unix time of the verification
+    int32_t offsetUs;
+    uint32_t uncertaintyUs;
+};
+
+// Sequence number of the next append, found from the slots on the first one
+static uint32_t nextSequence = 0;
+static bool sequenceKnown = false;
+
+// Floor division for the signed microsecond arithmetic below
+static int64_t floorDiv(int64_t value, int64_t divisor) {
+    int64_t q = value / divisor;
+    return (value % divisor != 0 && (value < 0) != (divisor < 0)) ? q - 1 : q;
+}
+
+// Intersect what every reading says about the offset. A narrow window
+// assumes the camera sampled its clock within 3 sigma of the one-way
+// estimate; otherwise only [sent, received] is assumed. False if the
+// readings contradict each other under that assumption.
+static bool bracketReadings(const CameraClockReading* readings, uint8_t count, uint32_t refSecond,
+                            uint32_t edgeUs, bool aligned, const LinkEstimate* link,
+                            int64_t& lo, int64_t& hi) {
+    lo = INT64_MIN;
+    hi = INT64_MAX;
+    for (uint8_t i = 0; i < count; i++) {
+        const CameraClockReading& r = readings[i];
+        int64_t camera = ((int64_t)r.second - (int64_t)refSecond) * 1000000;
+        int64_t s0 = (int32_t)(r.sentUs - edgeUs);
+        int64_t s1 = (int32_t)(r.receivedUs - edgeUs);
+        if (link != nullptr) {
+            int64_t spread = 3 * (int64_t)std::max<uint32_t>(link->stddevUs, 1000);
+            int64_t expected = s0 + link->oneWayUs;
+            s1 = std::min(s1, expected + spread);
+            s0 = std::max(s0, expected - spread);
+            if (s0 > s1) {
+                return false;
+            }
+        }
+
+        // The camera reported `second` at some RTC time within [s0, s1]
+        lo = std::max(lo, camera - s1 - (aligned ? 0 : 1000000));
+        hi = std::min(hi, camera + 1000000 - s0);
+        if (lo > hi) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void clockVerifyBegin(RTC_DS3231& rtc, const LinkEstimate& link, ClockVerifySession& session) {
+    // Times below are microseconds of RTC time since the start of second
+    // refSecond. Without SQW edges the RTC's sub-second phase is unknown,
+    // so a single read is taken and the bracket widened by a second.
+    DateTime rtcSecond;
+    session.aligned = rtcReadAtEdge(rtc, rtcSecond, session.edgeUs);
+    if (!session.aligned) {
+        rtcSecond = rtc.now();
+        session.edgeUs = micros();
+    }
+    session.refSecond = rtcSecond.unixtime();
+    session.link = link;
+    session.narrow = link.samples > 1;  // Narrow windows need a measured link
+    session.lo = INT64_MIN;
+    session.hi = INT64_MAX;
+    session.reads = 0;
+}
+
+uint32_t clockVerifyNextReadUs(const ClockVerifySession& session) {
+    if (session.reads == 0) {
+        return micros();
+    }
+
+    // Have the camera sample its clock at the RTC time where its seconds
+    // roll over if the offset is the middle of the bracket
+    int64_t mid = session.lo + (session.hi - session.lo) / 2;
+    int64_t oneWay = session.link.oneWayUs;
+    int64_t earliest = (int32_t)(micros() - session.edgeUs) + oneWay + READ_MIN_LEAD_US;
+    int64_t sampleAt = (floorDiv(earliest + mid - 1, 1000000) + 1) * 1000000 - mid;
+    return session.edgeUs + (uint32_t)(sampleAt - oneWay);
+}
+
+bool clockVerifyAddReading(ClockVerifySession& session, const CameraClockReading& reading) {
+    if (session.reads == CLOCK_VERIFY_MAX_READS) {
+        return false;
+    }
+    session.readings[session.reads++] = reading;
+
+    // Drop the narrow windows for good once the readings disagree under them
+    if (session.narrow &&
+        !bracketReadings(session.readings, session.reads, session.refSecond, session.edgeUs,
+                         session.aligned, &session.link, session.lo, session.hi)) {
+        session.narrow = false;
+    }
+    return session.narrow ||
+           bracketReadings(session.readings, session.reads, session.refSecond, session.edgeUs,
+                           session.aligned, nullptr, session.lo, session.hi);
+}
+
+bool clockVerifyDone(const ClockVerifySession& session) {
+    if (session.reads == 0) {
+        return false;
+    }
+    return !session.aligned || session.reads == CLOCK_VERIFY_MAX_READS ||
+           session.hi - session.lo <= CLOCK_VERIFY_RESOLUTION_US;
+}
+
+void clockVerifyResult(const ClockVerifySession& session, ClockOffset& offset) {
+    int64_t mid = session.lo + (session.hi - session.lo) / 2;
+    offset.offsetUs = (int32_t)std::max<int64_t>(INT32_MIN, std::min<int64_t>(INT32_MAX, mid));
+    offset.uncertaintyUs = (uint32_t)std::min<int64_t>(UINT32_MAX, (session.hi - session.lo + 1) / 2);
+    offset.reads = session.reads;
+}
+
+static void slotKey(uint8_t slot, char key[8]) {
+    snprintf(key, 8, "r%u", (unsigned)slot);
+}
+
+static bool loadSlot(Preferences& prefs, uint8_t slot, SyncLogRecord& record) {
+    char key[8];
+    slotKey(slot, key);
+    return prefs.getBytes(key, &record, sizeof(record)) == sizeof(record) && record.version == SYNC_LOG_VERSION;
+}
+
+void syncLogAppend(const NimBLEAddress& address, LinkTransport transport, uint8_t sets,
+                   uint32_t rtcTime, const ClockOffset& offset) {
+    Preferences prefs;
+    if (!prefs.begin(SYNC_LOG_NAMESPACE, false)) {
+        return;
+    }
+
+    SyncLogRecord record;
+    if (!sequenceKnown) {
+        for (uint8_t i = 0; i < SYNC_LOG_ENTRIES; i++) {
+            if (loadSlot(prefs, i, record) && record.sequence >= nextSequence) {
+                nextSequence = record.sequence + 1;
+            }
+        }
+        sequenceKnown = true;
+    }
+
+    record = {};
+    record.version = SYNC_LOG_VERSION;
+    record.transport = transport;
+    record.sets = sets;
+    record.reads = offset.reads;
+    record.sequence = nextSequence;
+    char key[16];
+    goProAddressKey(address, key);
+    strncpy(record.camera, key, sizeof(record.camera) - 1);
+    record.rtcTime = rtcTime;
+    record.offsetUs = offset.offsetUs;
+    record.uncertaintyUs = offset.uncertaintyUs;
+
+    char slot[8];
+    slotKey(nextSequence % SYNC_LOG_ENTRIES, slot);
+    if (prefs.putBytes(slot, &record, sizeof(record)) == sizeof(record)) {
+        nextSequence++;
+    }
+    prefs.end();
+}
+
+static bool olderRecord(const SyncLogRecord& a, const SyncLogRecord& b) {
+    return a.sequence < b.sequence;
+}
+
+void syncLogDump() {
+    Serial.println("#verify,camera,rtc_time,transport,sets,reads,offset_us,uncertainty_us");
+
+    Preferences prefs;
+    if (!prefs.begin(SYNC_LOG_NAMESPACE, true)) {
+        return;
+    }
+    static SyncLogRecord log[SYNC_LOG_ENTRIES];    // Too large for the loop task's stack
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < SYNC_LOG_ENTRIES; i++) {
+        if (loadSlot(prefs, i, log[count])) {
+            count++;
+        }
+    }
+    prefs.end();
+    std::sort(log, log + count, olderRecord);
+
+    for (uint8_t i = 0; i < count; i++) {
+        const SyncLogRecord& r = log[i];
+        DateTime time(r.rtcTime);
+        Serial.printf("verify,%s,%04d-%02d-%02dT%02d:%02d:%02d,%s,%u,%u,%ld,%lu\n", r.camera,
+                      time.year(), time.month(), time.day(), time.hour(), time.minute(), time.second(),
+                      linkTransportName((LinkTransport)r.transport), (unsigned)r.sets,
+                      (unsigned)r.reads, (long)r.offsetUs, (unsigned long)r.uncertaintyUs);
+    }
+}
@@ -0,0 +1,133 @@
+#include "credential_cache.h"
+#include "gopro_ble.h"
+
+#include <Preferences.h>
+
+#define CREDENTIAL_NAMESPACE "gopro_creds"
+
+struct APRecord {
+    uint8_t bssid[6];
+    uint8_t channel;
+};
+
+bool credentialCacheLoad(const NimBLEAddress& address, CredentialString& ssid, CredentialString& password) {
+    char ssidKey[16];
+    char passwordKey[16];
+    goProAddressKey(address, ssidKey, 's');
+    goProAddressKey(address, passwordKey, 'p');
+
+    Preferences prefs;
+    if (!prefs.begin(CREDENTIAL_NAMESPACE, true)) {
+        return false;
+    }
+
+    // Lengths include the terminator; 0 if missing or too long
+    char cachedSSID[CREDENTIAL_MAX_LENGTH + 1];
+    char cachedPassword[CREDENTIAL_MAX_LENGTH + 1];
+    size_t ssidLength = prefs.getString(ssidKey, cachedSSID, sizeof(cachedSSID));
+    size_t passwordLength = prefs.getString(passwordKey, cachedPassword, sizeof(cachedPassword));
+    prefs.end();
+
+    if (ssidLength <= 1 || passwordLength <= 1) {
+        return false;
+    }
+
+    ssid.assign(cachedSSID, ssidLength - 1);
+    password.assign(cachedPassword, passwordLength - 1);
+    return true;
+}
+
+bool credentialCacheStore(const NimBLEAddress& address, const CredentialString& ssid,
+                          const CredentialString& password) {
+    if (ssid.empty() || password.empty()) {
+        return false;
+    }
+
+    char ssidKey[16];
+    char passwordKey[16];
+    goProAddressKey(address, ssidKey, 's');
+    goProAddressKey(address, passwordKey, 'p');
+
+    Preferences prefs;
+    if (!prefs.begin(CREDENTIAL_NAMESPACE, false)) {
+        return false;
+    }
+
+    bool stored = prefs.putString(ssidKey, ssid.c_str()) == ssid.length() &&
+                  prefs.putString(passwordKey, password.c_str()) == password.length();
+    prefs.end();
+    return stored;
+}
+
+void credentialCacheErase(const NimBLEAddress& address) {
+    char ssidKey[16];
+    char passwordKey[16];
+    goProAddressKey(address, ssidKey, 's');
+    goProAddressKey(address, passwordKey, 'p');
+
+    char apKey[16];
+    goProAddressKey(address, apKey, 'a');
+
+    Preferences prefs;
+    if (prefs.begin(CREDENTIAL_NAMESPACE, false)) {
+        prefs.remove(ssidKey);
+        prefs.remove(passwordKey);
+        prefs.remove(apKey);
+        prefs.end();
+    }
+}
+
+bool credentialCacheLoadAP(const NimBLEAddress& address, uint8_t bssid[6], uint8_t& channel) {
+    char key[16];
+    goProAddressKey(address, key, 'a');
+
+    Preferences prefs;
+    if (!prefs.begin(CREDENTIAL_NAMESPACE, true)) {
+        return false;
+    }
+
+    APRecord record;
+    size_t length = prefs.getBytes(key, &record, sizeof(record));
+    prefs.end();
+
+    // 2.4 GHz channels only
+    if (length != sizeof(record) || record.channel < 1 || record.channel > 14) {
+        return false;
+    }
+
+    memcpy(bssid, record.bssid, sizeof(record.bssid));
+    channel = record.channel;
+    return true;
+}
+
+bool credentialCacheStoreAP(const NimBLEAddress& address, const uint8_t bssid[6], uint8_t channel) {
+    uint8_t cachedBSSID[6];
+    uint8_t cachedChannel;
+    if (credentialCacheLoadAP(address, cachedBSSID, cachedChannel) &&
+        cachedChannel == channel && memcmp(cachedBSSID, bssid, 6) == 0) {
+        return true;  // Unchanged: avoid a flash write
+    }
+
+    char key[16];
+    goProAddressKey(address, key, 'a');
+
+    Preferences prefs;
+    if (!prefs.begin(CREDENTIAL_NAMESPACE, false)) {
+        return false;
+    }
+
+    APRecord record;
+    memcpy(record.bssid, bssid, sizeof(record.bssid));
+    record.channel = channel;
+    bool stored = prefs.putBytes(key, &record, sizeof(record)) == sizeof(record);
+    prefs.end();
+    return stored;
+}
+
+bool credentialCacheEncrypted() {
+#ifdef CONFIG_NVS_ENCRYPTION
+    return true;
+#else
+    return false;
+#endif
+}
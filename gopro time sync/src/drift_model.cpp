@@ -0,0 +1,151 @@
+#include "drift_model.h"
+#include "gopro_ble.h"
+
+#include <Arduino.h>
+#include <Preferences.h>
+#include <math.h>
+
+#define DRIFT_NAMESPACE "drift"
+#define DRIFT_VERSION 1
+#define DRIFT_MIN_SPAN_S 60        // Shorter spans say nothing about the rate
+
+// Stored record; bump DRIFT_VERSION if the layout changes
+struct DriftRecord {
+    uint8_t version;
+    uint8_t anchored;
+    uint16_t measurements;
+    float ratePpm;
+    float variancePpm2;
+    uint32_t anchorTime;
+    int32_t anchorOffsetUs;
+    uint32_t anchorUncertaintyUs;
+};
+
+static DriftRecord freshRecord() {
+    DriftRecord record = {};
+    record.version = DRIFT_VERSION;
+    record.variancePpm2 = DRIFT_PRIOR_SIGMA_PPM * DRIFT_PRIOR_SIGMA_PPM;
+    return record;
+}
+
+static DriftRecord loadRecord(const NimBLEAddress& address) {
+    char key[16];
+    goProAddressKey(address, key);
+
+    DriftRecord record;
+    Preferences prefs;
+    if (!prefs.begin(DRIFT_NAMESPACE, true)) {
+        return freshRecord();
+    }
+    size_t length = prefs.getBytes(key, &record, sizeof(record));
+    prefs.end();
+
+    if (length != sizeof(record) || record.version != DRIFT_VERSION) {
+        return freshRecord();
+    }
+    return record;
+}
+
+static void storeRecord(const NimBLEAddress& address, const DriftRecord& record) {
+    char key[16];
+    goProAddressKey(address, key);
+
+    Preferences prefs;
+    if (prefs.begin(DRIFT_NAMESPACE, false)) {
+        prefs.putBytes(key, &record, sizeof(record));
+        prefs.end();
+    }
+}
+
+// Variance of a value known to lie uniformly within +/- uncertaintyUs
+static float bracketVariance(uint32_t uncertaintyUs) {
+    return (float)uncertaintyUs * (float)uncertaintyUs / 3.0f;
+}
+
+bool driftModelGet(const NimBLEAddress& address, DriftEstimate& estimate) {
+    DriftRecord record = loadRecord(address);
+    estimate.ratePpm = record.ratePpm;
+    estimate.sigmaPpm = sqrtf(record.variancePpm2);
+    estimate.measurements = record.measurements;
+    estimate.anchored = record.anchored != 0;
+    estimate.anchorTime = record.anchorTime;
+    estimate.anchorOffsetUs = record.anchorOffsetUs;
+    estimate.anchorUncertaintyUs = record.anchorUncertaintyUs;
+    return record.measurements > 0 || record.anchored;
+}
+
+void driftRecordSet(const NimBLEAddress& address, uint32_t rtcTime, const ClockOffset& offset) {
+    DriftRecord record = loadRecord(address);
+    record.anchored = 1;
+    record.anchorTime = rtcTime;
+    record.anchorOffsetUs = offset.offsetUs;
+    record.anchorUncertaintyUs = offset.uncertaintyUs;
+    storeRecord(address, record);
+}
+
+void driftRecordMeasurement(const NimBLEAddress& address, uint32_t rtcTime, const ClockOffset& offset) {
+    DriftRecord record = loadRecord(address);
+    if (!record.anchored || rtcTime < record.anchorTime + DRIFT_MIN_SPAN_S) {
+        return;
+    }
+
+    // Predict: the rate wanders between measurements
+    float spanS = (float)(rtcTime - record.anchorTime);
+    record.variancePpm2 += DRIFT_WANDER_PPM_PER_DAY * DRIFT_WANDER_PPM_PER_DAY * (spanS / 86400.0f);
+
+    // Update with the span's mean rate (us per s = ppm)
+    float measuredPpm = (float)(offset.offsetUs - record.anchorOffsetUs) / spanS;
+    float noisePpm2 = (bracketVariance(offset.uncertaintyUs) +
+                       bracketVariance(record.anchorUncertaintyUs)) / (spanS * spanS);
+    float gain = record.variancePpm2 / (record.variancePpm2 + noisePpm2);
+    record.ratePpm += gain * (measuredPpm - record.ratePpm);
+    record.variancePpm2 *= 1.0f - gain;
+    if (record.measurements < UINT16_MAX) {
+        record.measurements++;
+    }
+
+    // The set that follows starts a new span
+    record.anchored = 0;
+    storeRecord(address, record);
+}
+
+uint32_t driftNextSyncDelay(const NimBLEAddress& address, uint32_t rtcTime, uint32_t toleranceUs,
+                            uint32_t minMs, uint32_t maxMs) {
+    DriftRecord record = loadRecord(address);
+    if (!record.anchored) {
+        return minMs;
+    }
+
+    // Worst case: the anchor bracket's far edge, drifting at rate + 2 sigma
+    float startUs = fabsf((float)record.anchorOffsetUs) + (float)record.anchorUncertaintyUs;
+    float worstPpm = fabsf(record.ratePpm) + 2.0f * sqrtf(record.variancePpm2);
+    float budgetUs = (float)toleranceUs - startUs;
+    if (budgetUs <= 0.0f) {
+        return minMs;
+    }
+
+    float elapsedMs = rtcTime > record.anchorTime ? (float)(rtcTime - record.anchorTime) * 1000.0f : 0.0f;
+    float delayMs = (worstPpm > 0.0f ? budgetUs / worstPpm * 1000.0f : (float)maxMs) - elapsedMs;
+    if (delayMs < (float)minMs) {
+        return minMs;
+    }
+    if (delayMs > (float)maxMs) {
+        return maxMs;
+    }
+    return (uint32_t)delayMs;
+}
+
+void driftModelDump(const NimBLEAddress* addresses, uint8_t count) {
+    Serial.println("#drift,camera,rate_ppm,sigma_ppm,measurements,anchor_time,anchor_offset_us,anchor_uncertainty_us");
+    for (uint8_t i = 0; i < count; i++) {
+        DriftEstimate e;
+        if (!driftModelGet(addresses[i], e)) {
+            continue;
+        }
+        char key[16];
+        goProAddressKey(addresses[i], key);
+        Serial.printf("drift,%s,%.2f,%.2f,%u,%lu,%ld,%lu\n", key, e.ratePpm, e.sigmaPpm,
+                      (unsigned)e.measurements, (unsigned long)e.anchorTime,
+                      (long)e.anchorOffsetUs, (unsigned long)e.anchorUncertaintyUs);
+    }
+}
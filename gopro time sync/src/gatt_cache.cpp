@@ -0,0 +1,360 @@
+#include "gatt_cache.h"
+#include "gopro_ble.h"
+
+#include <Arduino.h>
+#include <Preferences.h>
+
+#define GATT_CACHE_NAMESPACE "gattcache"
+#define GATT_CACHE_VERSION 2
+#define GATT_MAX_SUBSCRIPTIONS 8      // AP state + command response per LE link, and spares
+#define GATT_CCCD_SEARCH_SPAN 3    // Handles after the value handle searched for its CCCD
+
+// Stored record; bump GATT_CACHE_VERSION if the layout changes
+struct GattCacheRecord {
+    uint8_t version;
+    uint8_t reserved;
+    GoProHandles handles;
+};
+
+// Completion state shared with the NimBLE host callbacks
+struct GattRequest {
+    TaskHandle_t task;
+    int status;
+    uint8_t* value;            // Read buffer, null for writes
+    size_t capacity;
+    size_t length;             // Bytes read so far
+    bool overflow;             // Value did not fit the buffer
+};
+
+struct ValidateRequest {
+    TaskHandle_t task;
+    int status;
+    const uint16_t* handles;
+    const NimBLEUUID* const* uuids;
+    uint8_t matched;           // Bit per handle that matched (or is unknown)
+};
+
+struct DescriptorRequest {
+    TaskHandle_t task;
+    int status;
+    uint16_t cccd;             // 0 = not found
+    bool pastCharacteristic;
+};
+
+// Notification routes; a reused connection handle overwrites its slot, and
+// routes of closed connections are reused before live ones
+struct Subscription {
+    uint16_t connId;
+    uint16_t handle;
+    uint16_t cccd;
+    GattNotifyCallback callback;
+};
+
+static Subscription subscriptions[GATT_MAX_SUBSCRIPTIONS] = {};
+static uint8_t nextSubscription = 0;
+static struct ble_gap_event_listener notifyListener;
+static bool notifyListenerRegistered = false;
+
+static const uint8_t CACHED_CHARS = 6;
+
+// Pointers, so this table does not depend on static initialization order
+static const NimBLEUUID* const CACHED_UUIDS[CACHED_CHARS] = {
+    &GOPRO_WIFI_SSID_UUID,
+    &GOPRO_WIFI_PASSWORD_UUID,
+    &GOPRO_WIFI_AP_ENABLE_UUID,
+    &GOPRO_WIFI_AP_STATE_UUID,
+    &GOPRO_COMMAND_UUID,
+    &GOPRO_COMMAND_RESPONSE_UUID,
+};
+
+bool gattCacheLoad(const NimBLEAddress& address, GoProHandles& handles) {
+    char key[16];
+    goProAddressKey(address, key);
+
+    Preferences prefs;
+    if (!prefs.begin(GATT_CACHE_NAMESPACE, true)) {
+        return false;
+    }
+
+    GattCacheRecord record;
+    size_t length = prefs.getBytes(key, &record, sizeof(record));
+    prefs.end();
+
+    if (length != sizeof(record) || record.version != GATT_CACHE_VERSION) {
+        return false;
+    }
+    if (record.handles.ssid == 0 || record.handles.password == 0 ||
+        record.handles.apEnable == 0 || record.handles.apState == 0) {
+        return false;
+    }
+
+    handles = record.handles;
+    return true;
+}
+
+bool gattCacheStore(const NimBLEAddress& address, const GoProHandles& handles) {
+    char key[16];
+    goProAddressKey(address, key);
+
+    Preferences prefs;
+    if (!prefs.begin(GATT_CACHE_NAMESPACE, false)) {
+        return false;
+    }
+
+    GattCacheRecord record = {GATT_CACHE_VERSION, 0, handles};
+    bool stored = prefs.putBytes(key, &record, sizeof(record)) == sizeof(record);
+    prefs.end();
+    return stored;
+}
+
+void gattCacheErase(const NimBLEAddress& address) {
+    char key[16];
+    goProAddressKey(address, key);
+
+    Preferences prefs;
+    if (prefs.begin(GATT_CACHE_NAMESPACE, false)) {
+        prefs.remove(key);
+        prefs.end();
+    }
+}
+
+static int onCharacteristic(uint16_t connHandle, const struct ble_gatt_error* error,
+                            const struct ble_gatt_chr* chr, void* arg) {
+    (void)connHandle;
+    ValidateRequest* request = (ValidateRequest*)arg;
+
+    if (error->status == 0 && chr != nullptr) {
+        for (uint8_t i = 0; i < CACHED_CHARS; i++) {
+            if (chr->val_handle == request->handles[i] &&
+                ble_uuid_cmp(&chr->uuid.u, &request->uuids[i]->getNative()->u) == 0) {
+                request->matched |= (1 << i);
+            }
+        }
+        return 0;
+    }
+
+    request->status = (error->status == BLE_HS_EDONE) ? 0 : error->status;
+    xTaskNotifyGive(request->task);
+    return 0;
+}
+
+bool gattValidateHandles(NimBLEClient* pClient, const GoProHandles& handles) {
+    const uint16_t list[CACHED_CHARS] = {
+        handles.ssid, handles.password, handles.apEnable, handles.apState,
+        handles.command, handles.commandResponse
+    };
+
+    // The declarations sit one handle below each value handle; unknown
+    // (optional) handles have nothing to check
+    uint16_t start = 0xffff;
+    uint16_t end = 0;
+    uint8_t unknown = 0;
+    for (uint8_t i = 0; i < CACHED_CHARS; i++) {
+        if (list[i] == 0) {
+            unknown |= (1 << i);
+            continue;
+        }
+        if (list[i] < 2) {
+            return false;
+        }
+        if (list[i] - 1 < start) {
+            start = list[i] - 1;
+        }
+        if (list[i] > end) {
+            end = list[i];
+        }
+    }
+
+    ValidateRequest request = {xTaskGetCurrentTaskHandle(), 0, list, CACHED_UUIDS, unknown};
+    int rc = ble_gattc_disc_all_chrs(pClient->getConnId(), start, end, onCharacteristic, &request);
+    if (rc != 0) {
+        return false;
+    }
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    return request.status == 0 && request.matched == (1 << CACHED_CHARS) - 1;
+}
+
+static int onAttribute(uint16_t connHandle, const struct ble_gatt_error* error,
+                       struct ble_gatt_attr* attr, void* arg) {
+    (void)connHandle;
+    GattRequest* request = (GattRequest*)arg;
+
+    // Long reads deliver one chunk per callback and finish with BLE_HS_EDONE
+    if (error->status == 0 && attr != nullptr && request->value != nullptr) {
+        uint16_t length = OS_MBUF_PKTLEN(attr->om);
+        if (request->length + length > request->capacity) {
+            request->overflow = true;
+            return 0;
+        }
+        ble_hs_mbuf_to_flat(attr->om, request->value + request->length, length, nullptr);
+        request->length += length;
+        return 0;
+    }
+
+    request->status = (error->status == BLE_HS_EDONE) ? 0 : error->status;
+    xTaskNotifyGive(request->task);
+    return 0;
+}
+
+static bool isSecurityError(int status) {
+    return status == BLE_HS_ERR_ATT_BASE + BLE_ATT_ERR_INSUFFICIENT_AUTHEN ||
+           status == BLE_HS_ERR_ATT_BASE + BLE_ATT_ERR_INSUFFICIENT_ENC;
+}
+
+bool gattReadHandle(NimBLEClient* pClient, uint16_t handle,
+                    uint8_t* value, size_t capacity, size_t& length) {
+    for (int attempt = 0; attempt < 2; attempt++) {
+        length = 0;
+        GattRequest request = {xTaskGetCurrentTaskHandle(), 0, value, capacity, 0, false};
+
+        int rc = ble_gattc_read_long(pClient->getConnId(), handle, 0, onAttribute, &request);
+        if (rc != 0) {
+            return false;
+        }
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        if (request.status == 0) {
+            length = request.length;
+            return !request.overflow;
+        }
+        if (!isSecurityError(request.status) || !pClient->secureConnection()) {
+            return false;
+        }
+    }
+    return false;
+}
+
+bool gattWriteHandle(NimBLEClient* pClient, uint16_t handle,
+                     const uint8_t* data, size_t length, bool response) {
+    if (!response) {
+        return ble_gattc_write_no_rsp_flat(pClient->getConnId(), handle, data, length) == 0;
+    }
+
+    for (int attempt = 0; attempt < 2; attempt++) {
+        GattRequest request = {xTaskGetCurrentTaskHandle(), 0, nullptr, 0, 0, false};
+
+        int rc = ble_gattc_write_flat(pClient->getConnId(), handle, data, length, onAttribute, &request);
+        if (rc != 0) {
+            return false;
+        }
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        if (request.status == 0) {
+            return true;
+        }
+        if (!isSecurityError(request.status) || !pClient->secureConnection()) {
+            return false;
+        }
+    }
+    return false;
+}
+
+static int onDescriptor(uint16_t connHandle, const struct ble_gatt_error* error,
+                        uint16_t chrHandle, const struct ble_gatt_dsc* dsc, void* arg) {
+    (void)connHandle;
+    (void)chrHandle;
+    DescriptorRequest* request = (DescriptorRequest*)arg;
+
+    // The search span is a few handles, so it completes in one round trip;
+    // anything after the next characteristic or service declaration is not ours
+    if (error->status == 0 && dsc != nullptr) {
+        if (dsc->uuid.u.type == BLE_UUID_TYPE_16 && !request->pastCharacteristic) {
+            if (dsc->uuid.u16.value == BLE_GATT_DSC_CLT_CFG_UUID16 && request->cccd == 0) {
+                request->cccd = dsc->handle;
+            } else if (dsc->uuid.u16.value == BLE_ATT_UUID_CHARACTERISTIC ||
+                       dsc->uuid.u16.value == BLE_ATT_UUID_PRIMARY_SERVICE) {
+                request->pastCharacteristic = true;
+            }
+        }
+        return 0;
+    }
+
+    request->status = (error->status == BLE_HS_EDONE) ? 0 : error->status;
+    xTaskNotifyGive(request->task);
+    return 0;
+}
+
+// GAP listeners see notifications for every connection, including handles
+// NimBLE-Arduino has no NimBLERemoteCharacteristic for
+static int onGapEvent(struct ble_gap_event* event, void* arg) {
+    (void)arg;
+    if (event->type != BLE_GAP_EVENT_NOTIFY_RX) {
+        return 0;
+    }
+
+    for (uint8_t i = 0; i < GATT_MAX_SUBSCRIPTIONS; i++) {
+        const Subscription& sub = subscriptions[i];
+        if (sub.callback != nullptr && sub.connId == event->notify_rx.conn_handle &&
+            sub.handle == event->notify_rx.attr_handle) {
+            uint8_t data[32];
+            uint16_t length = 0;
+            ble_hs_mbuf_to_flat(event->notify_rx.om, data, sizeof(data), &length);
+            sub.callback(sub.connId, sub.handle, data, length);
+        }
+    }
+    return 0;
+}
+
+bool gattSubscribe(NimBLEClient* pClient, uint16_t handle, GattNotifyCallback callback) {
+    if (!notifyListenerRegistered) {
+        if (ble_gap_event_listener_register(&notifyListener, onGapEvent, nullptr) != 0) {
+            return false;
+        }
+        notifyListenerRegistered = true;
+    }
+
+    DescriptorRequest request = {xTaskGetCurrentTaskHandle(), 0, 0, false};
+    int rc = ble_gattc_disc_all_dscs(pClient->getConnId(), handle, handle + GATT_CCCD_SEARCH_SPAN,
+                                     onDescriptor, &request);
+    if (rc != 0) {
+        return false;
+    }
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    if (request.status != 0 || request.cccd == 0) {
+        return false;
+    }
+
+    // Route first, so a notification racing the CCCD write response is not lost
+    uint16_t connId = pClient->getConnId();
+    uint8_t slot = GATT_MAX_SUBSCRIPTIONS;
+    for (uint8_t i = 0; i < GATT_MAX_SUBSCRIPTIONS; i++) {
+        if (subscriptions[i].connId == connId && subscriptions[i].handle == handle) {
+            slot = i;
+            break;
+        }
+    }
+    for (uint8_t i = 0; i < GATT_MAX_SUBSCRIPTIONS && slot == GATT_MAX_SUBSCRIPTIONS; i++) {
+        const Subscription& sub = subscriptions[i];
+        if (sub.callback == nullptr || ble_gap_conn_find(sub.connId, nullptr) != 0) {
+            slot = i;
+        }
+    }
+    if (slot == GATT_MAX_SUBSCRIPTIONS) {
+        slot = nextSubscription;
+        nextSubscription = (nextSubscription + 1) % GATT_MAX_SUBSCRIPTIONS;
+    }
+    subscriptions[slot] = {connId, handle, request.cccd, callback};
+
+    const uint8_t enable[2] = {0x01, 0x00};
+    return gattWriteHandle(pClient, request.cccd, enable, sizeof(enable), true);
+}
+
+bool gattProbe(NimBLEClient* pClient, uint16_t handle, uint32_t& rttUs) {
+    uint16_t connId = pClient->getConnId();
+    for (uint8_t i = 0; i < GATT_MAX_SUBSCRIPTIONS; i++) {
+        const Subscription& sub = subscriptions[i];
+        if (sub.callback == nullptr || sub.connId != connId || sub.handle != handle) {
+            continue;
+        }
+
+        const uint8_t enable[2] = {0x01, 0x00};
+        uint32_t start = micros();
+        if (!gattWriteHandle(pClient, sub.cccd, enable, sizeof(enable), true)) {
+            return false;
+        }
+        rttUs = micros() - start;
+        return true;
+    }
+    return false;
+}
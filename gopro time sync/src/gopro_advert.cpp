@@ -0,0 +1,65 @@
+#include "gopro_advert.h"
+
+#include <string.h>
+
+#include "gopro_ble.h"
+
+#define AD_TYPE_SHORT_NAME 0x08
+#define AD_TYPE_COMPLETE_NAME 0x09
+#define AD_TYPE_MANUFACTURER_DATA 0xFF
+#define ADVERT_FIELDS_LENGTH 11    // Schema .. media offload status
+
+const uint8_t* goProAdvertFind(const uint8_t* payload, size_t payloadLength, size_t& length) {
+    // AD structures: length (type + data), type, data
+    size_t offset = 0;
+    while (offset + 1 < payloadLength) {
+        size_t fieldLength = payload[offset];
+        if (fieldLength == 0 || offset + 1 + fieldLength > payloadLength) {
+            break;
+        }
+        const uint8_t* field = payload + offset + 1;
+        if (field[0] == AD_TYPE_MANUFACTURER_DATA && fieldLength >= 3 &&
+            field[1] == (GOPRO_COMPANY_ID & 0xff) && field[2] == (GOPRO_COMPANY_ID >> 8)) {
+            length = fieldLength - 3;
+            return field + 3;
+        }
+        offset += 1 + fieldLength;
+    }
+    length = 0;
+    return nullptr;
+}
+
+const char* goProAdvertName(const uint8_t* payload, size_t payloadLength, size_t& length) {
+    size_t offset = 0;
+    while (offset + 1 < payloadLength) {
+        size_t fieldLength = payload[offset];
+        if (fieldLength == 0 || offset + 1 + fieldLength > payloadLength) {
+            break;
+        }
+        const uint8_t* field = payload + offset + 1;
+        if (field[0] == AD_TYPE_COMPLETE_NAME || field[0] == AD_TYPE_SHORT_NAME) {
+            length = fieldLength - 1;
+            return (const char*)(field + 1);
+        }
+        offset += 1 + fieldLength;
+    }
+    length = 0;
+    return nullptr;
+}
+
+bool goProAdvertParse(const uint8_t* payload, size_t payloadLength, GoProAdvert& advert) {
+    advert = {};
+    size_t length;
+    const uint8_t* data = goProAdvertFind(payload, payloadLength, length);
+    if (data == nullptr || length < ADVERT_FIELDS_LENGTH) {
+        return false;
+    }
+
+    advert.schema = data[0];
+    advert.status = data[1];
+    advert.cameraId = data[2];
+    advert.capabilities = data[3];
+    memcpy(advert.idHash, data + 4, GOPRO_ADVERT_ID_HASH_LENGTH);
+    advert.mediaOffload = data[10];
+    return true;
+}
@@ -0,0 +1,43 @@
+#include "gopro_ble.h"
+
+#include "gopro_advert.h"
+
+#include <string.h>
+
+const NimBLEUUID GOPRO_WIFI_AP_SERVICE_UUID("b5f90001-aa8d-11e3-9046-0002a5d5c51b");
+const NimBLEUUID GOPRO_WIFI_SSID_UUID("b5f90002-aa8d-11e3-9046-0002a5d5c51b");
+const NimBLEUUID GOPRO_WIFI_PASSWORD_UUID("b5f90003-aa8d-11e3-9046-0002a5d5c51b");
+const NimBLEUUID GOPRO_WIFI_AP_ENABLE_UUID("b5f90004-aa8d-11e3-9046-0002a5d5c51b");
+const NimBLEUUID GOPRO_WIFI_AP_STATE_UUID("b5f90005-aa8d-11e3-9046-0002a5d5c51b");
+
+const NimBLEUUID GOPRO_CONTROL_SERVICE_UUID((uint16_t)0xfea6);
+const NimBLEUUID GOPRO_COMMAND_UUID("b5f90072-aa8d-11e3-9046-0002a5d5c51b");
+const NimBLEUUID GOPRO_COMMAND_RESPONSE_UUID("b5f90073-aa8d-11e3-9046-0002a5d5c51b");
+
+bool goProIsAdvertisement(NimBLEAdvertisedDevice* device) {
+    size_t length;
+    if (goProAdvertFind(device->getPayload(), device->getPayloadLength(), length) != nullptr) {
+        return true;
+    }
+    if (device->isAdvertisingService(GOPRO_CONTROL_SERVICE_UUID)) {
+        return true;
+    }
+    const char* name = goProAdvertName(device->getPayload(), device->getPayloadLength(), length);
+    return name != nullptr && length >= 5 && memcmp(name, "GoPro", 5) == 0;
+}
+
+BleAddressText goProAddressText(const NimBLEAddress& address) {
+    const uint8_t* a = address.getNative();
+    BleAddressText text;
+    text.format("%02x:%02x:%02x:%02x:%02x:%02x", a[5], a[4], a[3], a[2], a[1], a[0]);
+    return text;
+}
+
+void goProAddressKey(const NimBLEAddress& address, char key[16], char suffix) {
+    const uint8_t* a = address.getNative();
+    snprintf(key, 16, "%02x%02x%02x%02x%02x%02x", a[5], a[4], a[3], a[2], a[1], a[0]);
+    if (suffix != '\0') {
+        key[12] = suffix;
+        key[13] = '\0';
+    }
+}
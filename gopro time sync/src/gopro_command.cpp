@@ -0,0 +1,164 @@
+#include "gopro_command.h"
+
+#include <Arduino.h>
+
+#define RESPONSE_BIT (1 << 0)
+#define RESPONSE_MAX_LENGTH 20    // One notification at the default ATT MTU
+
+// A command waiting for its response. Commands are sent one at a time,
+// across all connections.
+struct ResponseWaiter {
+    uint16_t connId;
+    uint8_t data[RESPONSE_MAX_LENGTH];
+    size_t length;
+};
+
+// The notify callback (NimBLE host task) copies the next response from the
+// waiter's connection into its buffer and clears the pointer, under the
+// lock, so a late or duplicate notification never overwrites a response
+// the engine is parsing
+static EventGroupHandle_t responseEvents = nullptr;
+static portMUX_TYPE responseLock = portMUX_INITIALIZER_UNLOCKED;
+static ResponseWaiter* waiter = nullptr;
+
+const char* goProCommandResultName(GoProCommandResult result) {
+    switch (result) {
+        case GOPRO_CMD_OK: return "ok";
+        case GOPRO_CMD_REJECTED: return "rejected";
+        case GOPRO_CMD_NO_RESPONSE: return "no response";
+        case GOPRO_CMD_UNAVAILABLE: return "unavailable";
+    }
+    return "unknown";
+}
+
+static void onCommandResponse(uint16_t connId, uint16_t handle, const uint8_t* data, size_t length) {
+    (void)handle;
+    bool delivered = false;
+    portENTER_CRITICAL(&responseLock);
+    if (waiter != nullptr && waiter->connId == connId) {
+        waiter->length = length < RESPONSE_MAX_LENGTH ? length : RESPONSE_MAX_LENGTH;
+        memcpy(waiter->data, data, waiter->length);
+        waiter = nullptr;
+        delivered = true;
+    }
+    portEXIT_CRITICAL(&responseLock);
+    if (delivered) {
+        xEventGroupSetBits(responseEvents, RESPONSE_BIT);
+    }
+}
+
+// Wait for the next response into response; nullptr stops waiting
+static void awaitResponse(ResponseWaiter* response) {
+    portENTER_CRITICAL(&responseLock);
+    waiter = response;
+    portEXIT_CRITICAL(&responseLock);
+    xEventGroupClearBits(responseEvents, RESPONSE_BIT);
+}
+
+bool goProCommandBegin(NimBLEClient* pClient, const GoProHandles& handles) {
+    if (handles.command == 0 || handles.commandResponse == 0) {
+        return false;
+    }
+    if (responseEvents == nullptr) {
+        responseEvents = xEventGroupCreate();
+    }
+    return gattSubscribe(pClient, handles.commandResponse, onCommandResponse);
+}
+
+void goProBuildSetDateTime(uint8_t packet[GOPRO_CMD_SET_DATE_TIME_LENGTH],
+                           uint16_t year, uint8_t month, uint8_t day,
+                           uint8_t hour, uint8_t minute, uint8_t second) {
+    packet[0] = GOPRO_CMD_SET_DATE_TIME_LENGTH - 1;     // Header: bytes that follow
+    packet[1] = GOPRO_CMD_SET_DATE_TIME;
+    packet[2] = 0x07;                                   // Parameter length
+    packet[3] = (uint8_t)(year >> 8);
+    packet[4] = (uint8_t)(year & 0xff);
+    packet[5] = month;
+    packet[6] = day;
+    packet[7] = hour;
+    packet[8] = minute;
+    packet[9] = second;
+}
+
+// Send a single-packet command; on success, params receives the response
+// after the status byte (its own length prefix included)
+static GoProCommandResult transact(NimBLEClient* pClient, const GoProHandles& handles,
+                                   const uint8_t* packet, size_t length, uint32_t* writeRttUs,
+                                   uint8_t* params, size_t* paramsLength) {
+    if (handles.command == 0 || responseEvents == nullptr) {
+        return GOPRO_CMD_UNAVAILABLE;
+    }
+
+    // Armed before the write: the response can beat the write confirmation
+    ResponseWaiter response;
+    response.connId = pClient->getConnId();
+    awaitResponse(&response);
+    uint32_t writeStart = micros();
+    if (!gattWriteHandle(pClient, handles.command, packet, length, true)) {
+        awaitResponse(nullptr);
+        return GOPRO_CMD_UNAVAILABLE;
+    }
+    if (writeRttUs != nullptr) {
+        *writeRttUs = micros() - writeStart;
+    }
+
+    uint8_t commandId = packet[1];
+    unsigned long start = millis();
+    while (millis() - start < GOPRO_CMD_RESPONSE_TIMEOUT_MS) {
+        uint32_t remaining = GOPRO_CMD_RESPONSE_TIMEOUT_MS - (millis() - start);
+        EventBits_t bits = xEventGroupWaitBits(responseEvents, RESPONSE_BIT, pdTRUE, pdFALSE,
+                                               pdMS_TO_TICKS(remaining));
+        if (!(bits & RESPONSE_BIT)) {
+            break;
+        }
+
+        // The callback has let go of response; general header: top 3 bits
+        // zero, low 5 bits = payload length
+        const uint8_t* data = response.data;
+        size_t payload = data[0] & 0x1f;
+        if (response.length < 3 || (data[0] & 0xe0) != 0 || payload < 2 ||
+            payload + 1 > response.length || data[1] != commandId) {
+            awaitResponse(&response);
+            continue;  // Response to something else
+        }
+        if (data[2] != 0x00) {
+            return GOPRO_CMD_REJECTED;
+        }
+        if (params != nullptr) {
+            *paramsLength = payload - 2;
+            memcpy(params, data + 3, *paramsLength);
+        }
+        return GOPRO_CMD_OK;
+    }
+    awaitResponse(nullptr);
+    return GOPRO_CMD_NO_RESPONSE;
+}
+
+GoProCommandResult goProSendCommand(NimBLEClient* pClient, const GoProHandles& handles,
+                                    const uint8_t* packet, size_t length, uint32_t* writeRttUs) {
+    return transact(pClient, handles, packet, length, writeRttUs, nullptr, nullptr);
+}
+
+GoProCommandResult goProGetDateTime(NimBLEClient* pClient, const GoProHandles& handles,
+                                    GoProDateTime& value) {
+    const uint8_t packet[2] = {0x01, GOPRO_CMD_GET_DATE_TIME};
+    uint8_t params[RESPONSE_MAX_LENGTH];
+    size_t length = 0;
+    GoProCommandResult result = transact(pClient, handles, packet, sizeof(packet), nullptr,
+                                         params, &length);
+    if (result != GOPRO_CMD_OK) {
+        return result;
+    }
+
+    // 07 YYhi YYlo MM DD hh mm ss
+    if (length < 8 || params[0] != 0x07) {
+        return GOPRO_CMD_REJECTED;
+    }
+    value.year = (uint16_t)((params[1] << 8) | params[2]);
+    value.month = params[3];
+    value.day = params[4];
+    value.hour = params[5];
+    value.minute = params[6];
+    value.second = params[7];
+    return GOPRO_CMD_OK;
+}
@@ -0,0 +1,343 @@
+#include "gopro_http.h"
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <string.h>
+#include <strings.h>
+
+#define REQUEST_TAIL " HTTP/1.1\r\nHost: " GOPRO_HTTP_HOST "\r\nConnection: keep-alive\r\n\r\n"
+
+// Set date/time templates, and where their fields start
+#define LEGACY_DATE_TIME_HEAD "GET /gp/gpControl/command/setup/date_time?p="
+#define OPEN_GOPRO_DATE_HEAD "GET /gopro/camera/set_date_time?date="
+#define OPEN_GOPRO_TIME_HEAD OPEN_GOPRO_DATE_HEAD "2000_01_01&time="
+
+static const char LEGACY_DATE_TIME_REQUEST[] = LEGACY_DATE_TIME_HEAD "%00%01%01%00%00%00" REQUEST_TAIL;
+static const char OPEN_GOPRO_DATE_TIME_REQUEST[] = OPEN_GOPRO_TIME_HEAD "00_00_00" REQUEST_TAIL;
+static const size_t LEGACY_FIELDS = sizeof(LEGACY_DATE_TIME_HEAD) - 1;      // "%YY%MM%DD%HH%MM%SS"
+static const size_t OPEN_GOPRO_DATE = sizeof(OPEN_GOPRO_DATE_HEAD) - 1;     // "YYYY_MM_DD"
+static const size_t OPEN_GOPRO_TIME = sizeof(OPEN_GOPRO_TIME_HEAD) - 1;     // "HH_MM_SS"
+
+static_assert(sizeof(LEGACY_DATE_TIME_REQUEST) <= GOPRO_HTTP_REQUEST_MAX, "request template too long");
+static_assert(sizeof(OPEN_GOPRO_DATE_TIME_REQUEST) <= GOPRO_HTTP_REQUEST_MAX, "request template too long");
+
+static const char HEX_DIGITS[] = "0123456789abcdef";
+
+// "00" to "99"
+static const char DECIMAL_PAIRS[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+static WiFiClient session;
+
+bool goProHttpPrepare(GoProHttpRequest& request, const char* path) {
+    int length = snprintf(request.text, sizeof(request.text), "GET %s" REQUEST_TAIL, path);
+    if (length < 0 || (size_t)length >= sizeof(request.text)) {
+        request.length = 0;
+        return false;
+    }
+    request.length = (uint16_t)length;
+    return true;
+}
+
+void goProHttpPrepareDateTime(GoProHttpRequest& request, GoProHttpDateTimeForm form) {
+    const char* text = form == GOPRO_HTTP_DATE_TIME_LEGACY ? LEGACY_DATE_TIME_REQUEST : OPEN_GOPRO_DATE_TIME_REQUEST;
+    size_t size = form == GOPRO_HTTP_DATE_TIME_LEGACY ? sizeof(LEGACY_DATE_TIME_REQUEST)
+                                                      : sizeof(OPEN_GOPRO_DATE_TIME_REQUEST);
+    memcpy(request.text, text, size);
+    request.length = (uint16_t)(size - 1);
+}
+
+static void patchHex(char* at, uint8_t value) {
+    at[0] = HEX_DIGITS[value >> 4];
+    at[1] = HEX_DIGITS[value & 0x0f];
+}
+
+static void patchDecimal(char* at, uint8_t value) {
+    at[0] = DECIMAL_PAIRS[2 * value];
+    at[1] = DECIMAL_PAIRS[2 * value + 1];
+}
+
+void goProHttpPatchDateTime(GoProHttpRequest& request, GoProHttpDateTimeForm form, uint16_t year,
+                            uint8_t month, uint8_t day, uint8_t hour, uint8_t minute, uint8_t second) {
+    uint8_t yy = (uint8_t)(year % 100);
+    if (form == GOPRO_HTTP_DATE_TIME_LEGACY) {
+        char* fields = request.text + LEGACY_FIELDS;
+        patchHex(fields + 1, yy);
+        patchHex(fields + 4, month);
+        patchHex(fields + 7, day);
+        patchHex(fields + 10, hour);
+        patchHex(fields + 13, minute);
+        patchHex(fields + 16, second);
+    } else {
+        // The century ("20") stays as in the template
+        char* date = request.text + OPEN_GOPRO_DATE;
+        char* time = request.text + OPEN_GOPRO_TIME;
+        patchDecimal(date + 2, yy);
+        patchDecimal(date + 5, month);
+        patchDecimal(date + 8, day);
+        patchDecimal(time, hour);
+        patchDecimal(time + 3, minute);
+        patchDecimal(time + 6, second);
+    }
+}
+
+bool goProHttpOpen() {
+    if (session.connected()) {
+        return true;
+    }
+    session.stop();
+    return session.connect(GOPRO_HTTP_HOST, GOPRO_HTTP_PORT) == 1;
+}
+
+void goProHttpClose() {
+    session.stop();
+}
+
+// Next byte of the response; -1 once the deadline has passed or the camera
+// has closed the connection and everything it sent has been read
+static int readByte(uint32_t deadlineMs) {
+    for (;;) {
+        int c = session.read();
+        if (c >= 0) {
+            return c;
+        }
+        if (!session.connected() || (int32_t)(millis() - deadlineMs) >= 0) {
+            return -1;
+        }
+        delay(1);
+    }
+}
+
+// One line without its CRLF, cut to fit; false if the response ended first
+static bool readLine(char* line, uint32_t deadlineMs) {
+    size_t length = 0;
+    for (;;) {
+        int c = readByte(deadlineMs);
+        if (c < 0) {
+            return false;
+        }
+        if (c == '\n') {
+            break;
+        }
+        if (c != '\r' && length < GOPRO_HTTP_LINE_MAX - 1) {
+            line[length++] = (char)c;
+        }
+    }
+    line[length] = '\0';
+    return true;
+}
+
+// Copies the body text after field (up to the next '"') into value as the
+// body goes by, across chunk boundaries
+struct FieldScan {
+    const char* field;
+    size_t fieldLength;
+    size_t matched;
+    char* value;
+    size_t valueCapacity;
+    size_t captured;
+    bool capturing;
+};
+
+static void scanByte(FieldScan& scan, char c) {
+    if (scan.capturing) {
+        if (c == '"' || scan.captured == scan.valueCapacity - 1) {
+            scan.capturing = false;
+            scan.fieldLength = 0;
+        } else {
+            scan.value[scan.captured++] = c;
+            scan.value[scan.captured] = '\0';
+        }
+    } else if (scan.fieldLength > 0) {
+        // On a mismatch the match restarts, at this byte if it opens the
+        // field; enough for the quoted JSON keys looked for
+        scan.matched = c == scan.field[scan.matched] ? scan.matched + 1 : (c == scan.field[0] ? 1 : 0);
+        if (scan.matched == scan.fieldLength) {
+            scan.capturing = true;
+        }
+    }
+}
+
+// Read length bytes of body through the scan; length < 0: the body runs
+// until the camera closes
+static bool readBody(long length, uint32_t deadlineMs, FieldScan& scan) {
+    for (long remaining = length; remaining != 0; remaining--) {
+        int c = readByte(deadlineMs);
+        if (c < 0) {
+            return length < 0 && !session.connected();
+        }
+        scanByte(scan, (char)c);
+    }
+    return true;
+}
+
+// Chunked body: size line, data and CRLF per chunk, up to the zero-size
+// chunk, then the trailer up to its blank line
+static bool readChunkedBody(uint32_t deadlineMs, FieldScan& scan) {
+    char line[GOPRO_HTTP_LINE_MAX];
+    for (;;) {
+        if (!readLine(line, deadlineMs)) {
+            return false;
+        }
+        char* end;
+        long size = strtol(line, &end, 16);
+        if (end == line || size < 0) {
+            return false;
+        }
+        if (size == 0) {
+            break;
+        }
+        if (!readBody(size, deadlineMs, scan) || !readLine(line, deadlineMs) || line[0] != '\0') {
+            return false;
+        }
+    }
+    do {
+        if (!readLine(line, deadlineMs)) {
+            return false;
+        }
+    } while (line[0] != '\0');
+    return true;
+}
+
+struct ResponseHead {
+    int status;
+    bool keepAlive;
+    bool chunked;
+    long contentLength;        // -1 if not given
+};
+
+// Status line and headers, up to the blank line. first: the status line's
+// first byte, already read.
+static bool readHead(ResponseHead& head, char first, uint32_t deadlineMs) {
+    // Status line: "HTTP/1.1 200 OK"
+    char line[GOPRO_HTTP_LINE_MAX];
+    line[0] = first;
+    if (!readLine(line + 1, deadlineMs)) {
+        return false;
+    }
+    const char* code = strchr(line, ' ');
+    if (strncmp(line, "HTTP/1.", 7) != 0 || code == nullptr) {
+        return false;
+    }
+    head.status = atoi(code + 1);
+    head.keepAlive = line[7] == '1';
+    head.chunked = false;
+    head.contentLength = -1;
+
+    for (;;) {
+        if (!readLine(line, deadlineMs)) {
+            return false;
+        }
+        if (line[0] == '\0') {
+            return true;
+        }
+        if (strncasecmp(line, "Content-Length:", 15) == 0) {
+            head.contentLength = atol(line + 15);
+        } else if (strncasecmp(line, "Connection:", 11) == 0) {
+            head.keepAlive = strcasestr(line + 11, "close") == nullptr;
+        } else if (strncasecmp(line, "Transfer-Encoding:", 18) == 0) {
+            head.chunked = strcasestr(line + 18, "chunked") != nullptr;
+        }
+    }
+}
+
+// One exchange on the open session: status, or a GOPRO_HTTP_ERROR_*
+static int exchange(const GoProHttpRequest& request, GoProHttpTiming& timing, const char* field,
+                    char* value, size_t valueCapacity) {
+    timing.sentUs = micros();
+    if (session.write((const uint8_t*)request.text, request.length) != request.length) {
+        return GOPRO_HTTP_ERROR_SEND;
+    }
+    uint32_t deadlineMs = millis() + GOPRO_HTTP_TIMEOUT_MS;
+
+    // Interim (1xx) responses have no body; the final one follows them
+    ResponseHead head = {0, false, false, -1};
+    do {
+        int c = readByte(deadlineMs);
+        if (c < 0) {
+            return GOPRO_HTTP_ERROR_RESPONSE;
+        }
+        if (head.status == 0) {
+            timing.receivedUs = micros();
+        }
+        if (!readHead(head, (char)c, deadlineMs)) {
+            return GOPRO_HTTP_ERROR_RESPONSE;
+        }
+    } while (head.status >= 100 && head.status < 200);
+
+    FieldScan scan = {field, 0, 0, value, valueCapacity, 0, false};
+    if (field != nullptr && value != nullptr && valueCapacity > 0) {
+        scan.fieldLength = strlen(field);
+    }
+    bool complete;
+    if (head.status == 204 || head.status == 304) {
+        complete = true;
+    } else if (head.chunked) {
+        complete = readChunkedBody(deadlineMs, scan);
+    } else if (head.contentLength >= 0) {
+        complete = readBody(head.contentLength, deadlineMs, scan);
+    } else if (!head.keepAlive) {
+        complete = readBody(-1, deadlineMs, scan);
+    } else {
+        // No way to tell where the body ends short of the timeout; fail now
+        // (the caller closes the session)
+        return GOPRO_HTTP_ERROR_RESPONSE;
+    }
+    if (!complete) {
+        return GOPRO_HTTP_ERROR_RESPONSE;
+    }
+    if (!head.keepAlive) {
+        session.stop();
+    }
+    return head.status;
+}
+
+bool goProHttpConnected() {
+    return session.connected();
+}
+
+int goProHttpSend(const GoProHttpRequest& request, GoProHttpTiming* timing, const char* field,
+                  char* value, size_t valueCapacity) {
+    GoProHttpTiming local;
+    if (timing == nullptr) {
+        timing = &local;
+    }
+    if (value != nullptr && valueCapacity > 0) {
+        value[0] = '\0';
+    }
+    if (!goProHttpOpen()) {
+        return GOPRO_HTTP_ERROR_CONNECT;
+    }
+
+    // No retry here: a request is aimed at its send slot, and a copy sent
+    // later would carry a stale second
+    int status = exchange(request, *timing, field, value, valueCapacity);
+    if (status < 0) {
+        session.stop();
+    }
+    return status;
+}
+
+bool goProHttpProbe(uint32_t& rttUs) {
+    // The session's own handshake serves as the first probe
+    if (!session.connected()) {
+        session.stop();
+        uint32_t start = micros();
+        if (session.connect(GOPRO_HTTP_HOST, GOPRO_HTTP_PORT) != 1) {
+            return false;
+        }
+        rttUs = micros() - start;
+        return true;
+    }
+
+    WiFiClient probe;
+    uint32_t start = micros();
+    if (probe.connect(GOPRO_HTTP_HOST, GOPRO_HTTP_PORT) != 1) {
+        return false;
+    }
+    rttUs = micros() - start;
+    probe.stop();
+    return true;
+}
@@ -0,0 +1,101 @@
+#include "link_latency.h"
+#include "gopro_ble.h"
+
+#include <Arduino.h>
+#include <math.h>
+
+struct TransportState {
+    uint32_t samples;
+    uint32_t meanUs;
+    uint64_t varianceUs2;
+};
+
+struct CameraLatency {
+    bool used;
+    NimBLEAddress address;
+    TransportState transports[LINK_TRANSPORT_COUNT];
+};
+
+static CameraLatency cameras[LINK_MAX_CAMERAS];
+static uint8_t nextCamera = 0;
+
+static const char* const TRANSPORT_NAMES[LINK_TRANSPORT_COUNT] = {"ble", "http"};
+
+static CameraLatency* findCamera(const NimBLEAddress& address) {
+    for (uint8_t i = 0; i < LINK_MAX_CAMERAS; i++) {
+        if (cameras[i].used && cameras[i].address == address) {
+            return &cameras[i];
+        }
+    }
+    return nullptr;
+}
+
+const char* linkTransportName(LinkTransport transport) {
+    return transport < LINK_TRANSPORT_COUNT ? TRANSPORT_NAMES[transport] : "?";
+}
+
+void linkLatencyAddSample(const NimBLEAddress& address, LinkTransport transport, uint32_t oneWayUs) {
+    if (transport >= LINK_TRANSPORT_COUNT) {
+        return;
+    }
+
+    CameraLatency* camera = findCamera(address);
+    if (camera == nullptr) {
+        camera = &cameras[nextCamera];
+        nextCamera = (nextCamera + 1) % LINK_MAX_CAMERAS;
+        *camera = {};
+        camera->used = true;
+        camera->address = address;
+    }
+
+    TransportState& s = camera->transports[transport];
+    if (s.samples++ == 0) {
+        s.meanUs = oneWayUs;
+        s.varianceUs2 = 0;
+        return;
+    }
+
+    // Exponentially weighted mean and variance (West's incremental form)
+    int64_t diff = (int64_t)oneWayUs - s.meanUs;
+    int64_t step = diff / (1 << LINK_EWMA_SHIFT);
+    s.meanUs = (uint32_t)(s.meanUs + step);
+    uint64_t variance = s.varianceUs2 + (uint64_t)(diff * step);
+    s.varianceUs2 = variance - (variance >> LINK_EWMA_SHIFT);
+}
+
+bool linkLatencyGet(const NimBLEAddress& address, LinkTransport transport, LinkEstimate& estimate) {
+    const CameraLatency* camera = transport < LINK_TRANSPORT_COUNT ? findCamera(address) : nullptr;
+    if (camera == nullptr || camera->transports[transport].samples == 0) {
+        return false;
+    }
+
+    const TransportState& s = camera->transports[transport];
+    estimate.samples = s.samples;
+    estimate.oneWayUs = s.meanUs;
+    estimate.varianceUs2 = s.varianceUs2;
+    estimate.stddevUs = (uint32_t)sqrt((double)s.varianceUs2);
+    return true;
+}
+
+uint32_t linkLatencyOneWay(const NimBLEAddress& address, LinkTransport transport, uint32_t defaultUs) {
+    LinkEstimate estimate;
+    return linkLatencyGet(address, transport, estimate) ? estimate.oneWayUs : defaultUs;
+}
+
+void linkLatencyDump() {
+    Serial.println("#link,camera,transport,samples,one_way_us,stddev_us,variance_us2");
+    for (uint8_t i = 0; i < LINK_MAX_CAMERAS; i++) {
+        if (!cameras[i].used) {
+            continue;
+        }
+        for (uint8_t t = 0; t < LINK_TRANSPORT_COUNT; t++) {
+            LinkEstimate e;
+            if (!linkLatencyGet(cameras[i].address, (LinkTransport)t, e)) {
+                continue;
+            }
+            Serial.printf("link,%s,%s,%u,%u,%u,%llu\n", goProAddressText(cameras[i].address).c_str(),
+                          TRANSPORT_NAMES[t], (unsigned)e.samples, (unsigned)e.oneWayUs,
+                          (unsigned)e.stddevUs, (unsigned long long)e.varianceUs2);
+        }
+    }
+}
@@ -11,593 +11,1812 @@
  * Process:
  * 1. Read time from DS3231 RTC
  * 2. Connect to GoPro via BLE
+ * 3. Set time with the Open GoPro Set Date/Time BLE command (GP-0072)
+ * 
+ * Fallback, for firmware that rejects the BLE command:
  * 3. Read WiFi credentials and enable WiFi AP
  * 4. Connect to GoPro WiFi network
  * 5. Set time via HTTP API
  * 
- * API Endpoint: /gp/gpControl/command/setup/date_time (legacy format)
+ * Every GoPro the scan finds gets an entry in the camera table and runs
+ * through these steps as its own state machine (see runEngine), so one
+ * camera's AP start-up and WiFi join overlap the next camera's BLE work.
+ * Nothing in loop() waits on a camera for seconds: scans run in the
+ * background, BLE and WiFi callbacks wake the engine, and a timed send
+ * sleeps out only its last few milliseconds.
+ * 
+ * API Endpoint: /gp/gpControl/command/setup/date_time (legacy format), or
+ * /gopro/camera/set_date_time with HTTP_DATE_TIME_OPEN_GOPRO
  */
 
 #include <Arduino.h>
 #include <NimBLEDevice.h>
 #include <WiFi.h>
-#include <HTTPClient.h>
 #include <Wire.h>
 #include <RTClib.h>
 
-// GoPro WiFi AP BLE Characteristics
-#define GOPRO_WIFI_SSID_UUID "b5f90002-aa8d-11e3-9046-0002a5d5c51b"
-#define GOPRO_WIFI_PASSWORD_UUID "b5f90003-aa8d-11e3-9046-0002a5d5c51b"
-#define GOPRO_WIFI_AP_ENABLE_UUID "b5f90004-aa8d-11e3-9046-0002a5d5c51b"
-#define GOPRO_WIFI_AP_STATE_UUID "b5f90005-aa8d-11e3-9046-0002a5d5c51b"
+#include "camera_table.h"
+#include "credential_cache.h"
+#include "clock_verify.h"
+#include "drift_model.h"
+#include "gatt_cache.h"
+#include "gopro_advert.h"
+#include "gopro_ble.h"
+#include "gopro_command.h"
+#include "gopro_http.h"
+#include "link_latency.h"
+#include "memory_watch.h"
+#include "paired_cameras.h"
+#include "serial_log.h"
+#include "rtc_edge.h"
+#include "static_ip.h"
+#include "trace.h"
 
 // Configuration
-#define SCAN_TIME_SECONDS 10
+#define SCAN_TIME_SECONDS 10              // Longest scan (presence scan round); stops once its cameras are seen
+#define SCAN_LINGER_MS 2000               // Keep scanning this long after the first GoPro for the rest of a rig
+#define PRESENCE_SCAN_INTERVAL_MS 400     // Passive scan while a known camera is missing: listen for
+#define PRESENCE_SCAN_WINDOW_MS 100       // 100 ms out of every 400 ms
 #define BLE_CONNECT_TIMEOUT_MS 15000
 #define WIFI_CONNECT_TIMEOUT_MS 20000
-#define AP_READY_POLL_ATTEMPTS 25
+#define WIFI_FAST_JOIN_TIMEOUT_MS 3000    // Pinned BSSID/channel join before falling back to a scan
+#define SYNC_OVER_BLE 1                   // Set the time over the BLE command channel; WiFi/HTTP only as a fallback
+#define HTTP_DATE_TIME_OPEN_GOPRO 0       // HTTP set via /gopro/camera/set_date_time, 0 = legacy gpControl endpoint
+#define WIFI_STATIC_IP 1                  // Static address on the GoPro AP (skips DHCP), 0 = DHCP
+#define BLE_ONE_WAY_DEFAULT_US 30000      // Set-time send lead before the first measurement (BLE)
+#define HTTP_ONE_WAY_DEFAULT_US 60000     // Set-time send lead before the first measurement (HTTP)
+#define ALIGN_MIN_LEAD_US 1000            // Time needed to build the request before its send slot
+#define LINK_MAX_PROBES 4                 // RTT probes per sync, taken while waiting for the send slot
+#define LINK_PROBE_SLOT_US 250000         // Only probe while the send slot is further away than this
+#define SYNC_VERIFY 1                     // Read the camera clock back after every set
+#define SYNC_VERIFY_MAX_OFFSET_MS 100     // Re-set when the camera is provably further off than this
+#define SYNC_VERIFY_RESETS 2              // Re-sets per sync before accepting the offset
+#define SYNC_VERIFY_READ_RETRIES 2        // Failed read-backs started over before the sync counts as failed
+#define SYNC_SEND_RETRIES 2               // Failed set sends re-planned on a later second before giving up
+#define SYNC_DRIFT_TOLERANCE_MS 200       // Re-sync before a camera's predicted offset exceeds this
+#define SYNC_INTERVAL_MIN_MS 600000       // Periodic sync bounds (10 min .. 12 h)
+#define SYNC_INTERVAL_MAX_MS 43200000
+#define SYNC_INTERVAL_DEFAULT_MS 3600000  // Without a verified offset to predict from
+#define AP_READY_TIMEOUT_MS 10000         // Wait for AP state 0x03 after the enable write
+#define AP_READY_POLL_MS 200              // Poll interval if the camera refuses AP state notifications
+#define BLE_RELEASE_MS 1000               // Settle time between dropping BLE and joining the camera's AP
+#define CAMERA_RETRY_MS 5000              // Retry a failed sync (or a scan that would not start) this often
+#define CAMERA_DISCOVERY_INTERVAL_MS 300000  // Scan for cameras joining the rig this often
+#define ENGINE_TICK_MS 20                 // Longest loop() sleep between engine passes
+#define ENGINE_SLOT_LEAD_MS 40            // Wake this early for a timed send, then sleep out the rest
+#define CONNECT_GUARD_MS 1000             // Hold a BLE connect back this long before another camera's set
+#define EXCHANGE_GUARD_MS 200             // Same for a clock read or RTT probe
 
 // Buzzer Configuration
 #define BUZZER_PIN 25           // GPIO pin for buzzer (change if needed)
 #define BEEP_DURATION_MS 200    // Short beep duration
 
-// Global variables
-static NimBLEClient* pClient = nullptr;
+// Result of the last WiFi join (WL_CONNECT_FAILED = rejected credentials)
+static wl_status_t wifiJoinStatus = WL_IDLE_STATUS;
+
+// WiFi join progress, set from the WiFi event handler
+#define WIFI_GOT_IP_BIT      (1 << 0)
+#define WIFI_AUTH_FAILED_BIT (1 << 1)
+#define WIFI_NO_AP_BIT       (1 << 2)
+#define WIFI_ASSOCIATED_BIT  (1 << 3)
+static EventGroupHandle_t wifiEvents = nullptr;
+
+// The station joins one camera AP at a time: the camera joining or holding it
+static GoProCamera* wifiOwner = nullptr;
 
-// WiFi AP characteristics (only ones we actually use)
-static NimBLERemoteCharacteristic* pWiFiSSIDChar = nullptr;
-static NimBLERemoteCharacteristic* pWiFiPasswordChar = nullptr;
-static NimBLERemoteCharacteristic* pWiFiAPEnableChar = nullptr;
-static NimBLERemoteCharacteristic* pWiFiAPStateChar = nullptr;
+// Every static address was taken on the current join; waiting for DHCP
+static bool wifiDhcp = false;
 
-static String goProSSID = "";
-static String goProPassword = "";
+// AP readiness per camera table slot, set from the AP state notifications
+#define AP_READY_BIT(index) (1 << (index))
+static EventGroupHandle_t apEvents = nullptr;
 
 // DS3231 RTC
 static RTC_DS3231 rtc;
 
-// Simple BLE client callback
+// Engine wake-ups, set from the BLE, WiFi and scan callbacks
+#define ENGINE_WAKE_BIT      (1 << 0)
+#define ENGINE_SCAN_DONE_BIT (1 << 1)
+static EventGroupHandle_t engineEvents = nullptr;
+
+// Scans: active ones (scan requests, full duty) find new cameras and get
+// the scan response with the GoPro manufacturer data; the presence scan
+// only watches for cameras coming back
+enum ScanMode : uint8_t {
+    SCAN_DISCOVERY,    // Active, for cameras not in the table yet (cold boot, now and then)
+    SCAN_FOLLOW_UP,    // Active, once the presence scan saw a missing camera: the rest of the rig, scan responses
+    SCAN_PRESENCE,     // Passive and low duty, for as long as a camera is missing
+};
+
+// Last scan
+static bool scanned = false;
+static bool scanning = false;
+static ScanMode scanMode = SCAN_DISCOVERY;
+static bool scanEscalate = false;      // The presence scan saw a camera: follow up with SCAN_FOLLOW_UP
+static bool scanStartFailed = false;
+static bool scanStopped = false;       // Stopped by us (early exit, or giving way to a connect)
+static uint32_t scanStartUs = 0;
+static unsigned long lastScanMs = 0;
+static unsigned long firstSightingMs = 0;
+static uint8_t scanSightings = 0;
+static bool scanSeen[CAMERA_MAX];
+
+// GoPro advertisements matched by the scan callback (NimBLE host task),
+// taken by the engine on its next pass
+struct ScanSighting {
+    NimBLEAddress address;
+    char name[24];
+    GoProAdvert advert;        // Schema 0 when the camera sent no manufacturer data
+};
+static portMUX_TYPE sightingLock = portMUX_INITIALIZER_UNLOCKED;
+static ScanSighting sightings[CAMERA_MAX];
+static uint8_t sightingCount = 0;
+
+// Beep in progress (switched off from loop())
+static bool beeping = false;
+static unsigned long beepStartMs = 0;
+
+// Simple BLE client callback, shared by every camera's client
 class MyClientCallback : public NimBLEClientCallbacks {
     void onConnect(NimBLEClient* pClient) {
-        Serial.println("[BLE] Connected to GoPro");
+        LOG_INFO(BLE, "Connected to GoPro %s", goProAddressText(pClient->getPeerAddress()).c_str());
     }
-
+    
     void onDisconnect(NimBLEClient* pClient) {
-        Serial.println("[BLE] Disconnected from GoPro");
+        LOG_INFO(BLE, "Disconnected from GoPro %s", goProAddressText(pClient->getPeerAddress()).c_str());
+        xEventGroupSetBits(engineEvents, ENGINE_WAKE_BIT);
     }
 };
 
+static MyClientCallback clientCallbacks;
+
 // Buzzer control - short beep for successful time sync
 void beep() {
     digitalWrite(BUZZER_PIN, HIGH);
-    delay(BEEP_DURATION_MS);
-    digitalWrite(BUZZER_PIN, LOW);
+    beeping = true;
+    beepStartMs = millis();
+}
+
+// End the beep once it has lasted BEEP_DURATION_MS
+void updateBuzzer() {
+    if (beeping && millis() - beepStartMs >= BEEP_DURATION_MS) {
+        digitalWrite(BUZZER_PIN, LOW);
+        beeping = false;
+    }
 }
 
 // Get WiFi SSID from GoPro (by reading characteristic directly)
-bool getWiFiSSID() {
-    Serial.println("[BLE] Getting WiFi SSID...");
+bool getWiFiSSID(GoProCamera& cam) {
+    LOG_INFO(BLE, "Getting WiFi SSID...");
+    TraceSpan span(TRACE_READ_SSID);
     
-    if (pWiFiSSIDChar == nullptr || !pWiFiSSIDChar->canRead()) {
-        Serial.println("[BLE] ERROR: WiFi SSID characteristic not available");
+    if (cam.handles.ssid == 0) {
+        LOG_ERROR(BLE, "ERROR: WiFi SSID characteristic not available");
         return false;
     }
     
-    std::string ssidValue = pWiFiSSIDChar->readValue();
-    if (ssidValue.length() > 0) {
-        goProSSID = String(ssidValue.c_str());
-        Serial.printf("[BLE] WiFi SSID: %s\n", goProSSID.c_str());
+    uint8_t ssidValue[CREDENTIAL_MAX_LENGTH];
+    size_t length;
+    if (gattReadHandle(cam.client, cam.handles.ssid, ssidValue, sizeof(ssidValue), length) && length > 0) {
+        cam.ssid.assign((const char*)ssidValue, strnlen((const char*)ssidValue, length));
+        LOG_INFO(BLE, "WiFi SSID: %s", cam.ssid.c_str());
+        span.ok();
         return true;
     }
     
-    Serial.println("[BLE] ERROR: Failed to read WiFi SSID");
+    LOG_ERROR(BLE, "ERROR: Failed to read WiFi SSID");
     return false;
 }
 
 // Get WiFi password from GoPro (by reading characteristic directly)
-bool getWiFiPassword() {
-    Serial.println("[BLE] Getting WiFi password...");
+bool getWiFiPassword(GoProCamera& cam) {
+    LOG_INFO(BLE, "Getting WiFi password...");
+    TraceSpan span(TRACE_READ_PASSWORD);
     
-    if (pWiFiPasswordChar == nullptr || !pWiFiPasswordChar->canRead()) {
-        Serial.println("[BLE] ERROR: WiFi Password characteristic not available");
+    if (cam.handles.password == 0) {
+        LOG_ERROR(BLE, "ERROR: WiFi Password characteristic not available");
         return false;
     }
     
-    std::string passwordValue = pWiFiPasswordChar->readValue();
-    if (passwordValue.length() > 0) {
-        goProPassword = String(passwordValue.c_str());
-        Serial.printf("[BLE] WiFi password: %s\n", goProPassword.c_str());
+    uint8_t passwordValue[CREDENTIAL_MAX_LENGTH];
+    size_t length;
+    if (gattReadHandle(cam.client, cam.handles.password, passwordValue, sizeof(passwordValue), length) &&
+        length > 0) {
+        cam.password.assign((const char*)passwordValue, strnlen((const char*)passwordValue, length));
+        LOG_INFO(BLE, "WiFi password read (%u characters)", (unsigned)cam.password.length());
+        span.ok();
         return true;
     }
     
-    Serial.println("[BLE] ERROR: Failed to read WiFi password");
+    LOG_ERROR(BLE, "ERROR: Failed to read WiFi password");
     return false;
 }
 
+// AP state notification (runs on the NimBLE host task)
+void onAPStateNotify(uint16_t connId, uint16_t handle, const uint8_t* data, size_t length) {
+    (void)handle;
+    GoProCamera* cam = cameraForConnection(connId);
+    if (cam != nullptr && length > 0 && data[0] >= 0x03) {
+        xEventGroupSetBits(apEvents, AP_READY_BIT(cameraIndex(*cam)));
+        xEventGroupSetBits(engineEvents, ENGINE_WAKE_BIT);
+    }
+}
+
 // Enable WiFi AP on GoPro (by writing to characteristic directly)
-bool enableWiFiAP() {
-    Serial.println("[BLE] Enabling WiFi AP...");
+bool enableWiFiAP(GoProCamera& cam) {
+    LOG_INFO(BLE, "Enabling WiFi AP...");
+    TraceSpan span(TRACE_ENABLE_AP);
     
-    if (pWiFiAPEnableChar == nullptr || !pWiFiAPEnableChar->canWrite()) {
-        Serial.println("[BLE] ERROR: WiFi AP Enable characteristic not available");
+    if (cam.handles.apEnable == 0) {
+        LOG_ERROR(BLE, "ERROR: WiFi AP Enable characteristic not available");
         return false;
     }
     
+    // Subscribe before enabling, so the transition to 0x03 cannot be missed
+    xEventGroupClearBits(apEvents, AP_READY_BIT(cameraIndex(cam)));
+    cam.apStateNotifications = cam.handles.apState != 0 &&
+                               gattSubscribe(cam.client, cam.handles.apState, onAPStateNotify);
+    if (!cam.apStateNotifications) {
+        LOG_WARN(BLE, "WARNING: AP state notifications unavailable, will poll");
+    }
+    
     // Write 0x01 to enable the AP
     uint8_t enableValue = 0x01;
-    if (pWiFiAPEnableChar->writeValue(&enableValue, 1, false)) {
-        Serial.println("[BLE] WiFi AP enable command sent successfully");
-        delay(1000); // Give the AP time to start
+    if (gattWriteHandle(cam.client, cam.handles.apEnable, &enableValue, 1, false)) {
+        LOG_INFO(BLE, "WiFi AP enable command sent successfully");
+        span.ok();
         return true;
     }
     
-    Serial.println("[BLE] ERROR: Failed to write WiFi AP enable");
+    LOG_ERROR(BLE, "ERROR: Failed to write WiFi AP enable");
     return false;
 }
 
 
 // Check if AP mode is ready (by reading characteristic directly)
-bool checkAPModeStatus() {
-    Serial.println("[BLE] Checking AP mode status...");
+bool checkAPModeStatus(GoProCamera& cam) {
+    LOG_INFO(BLE, "Checking AP mode status...");
     
-    if (pWiFiAPStateChar == nullptr || !pWiFiAPStateChar->canRead()) {
-        Serial.println("[BLE] WARNING: WiFi AP State characteristic not available");
+    if (cam.handles.apState == 0) {
+        LOG_WARN(BLE, "WARNING: WiFi AP State characteristic not available");
         return false;
     }
     
-    std::string stateValue = pWiFiAPStateChar->readValue();
-    if (stateValue.length() > 0) {
-        uint8_t apState = (uint8_t)stateValue[0];
-        Serial.printf("[BLE] AP Mode status: 0x%02X\n", apState);
+    uint8_t apState;
+    size_t length;
+    if (gattReadHandle(cam.client, cam.handles.apState, &apState, sizeof(apState), length) && length > 0) {
+        LOG_INFO(BLE, "AP Mode status: 0x%02X", apState);
         
         // AP State values:
         // 0x00 = Disabled
         // 0x01 = Enabling/Starting
         // 0x03 = Enabled and broadcasting
         if (apState >= 0x03) {
-            Serial.println("[BLE] AP is ready and broadcasting!");
+            LOG_INFO(BLE, "AP is ready and broadcasting!");
             return true;
         } else if (apState == 0x01) {
-            Serial.println("[BLE] AP is still starting...");
+            LOG_INFO(BLE, "AP is still starting...");
             return false;
         } else {
-            Serial.println("[BLE] AP is disabled");
+            LOG_INFO(BLE, "AP is disabled");
             return false;
         }
     }
     
-    Serial.println("[BLE] ERROR: Failed to read AP state");
+    LOG_ERROR(BLE, "ERROR: Failed to read AP state");
     return false;
 }
 
-// Wait for AP mode to become ready
-bool waitForAPMode(int maxAttempts = AP_READY_POLL_ATTEMPTS) {
-    Serial.println("[BLE] Waiting for AP mode to be ready...");
+// Record the handle if this is one of the WiFi AP or command characteristics we use
+void matchGoProCharacteristic(GoProCamera& cam, NimBLERemoteCharacteristic* pChar) {
+    NimBLEUUID uuid = pChar->getUUID();
     
-    for (int attempt = 1; attempt <= maxAttempts; attempt++) {
-        if (checkAPModeStatus()) {
-            Serial.printf("[BLE] AP Mode is ready (poll #%d)\n", attempt);
-            return true;
-        }
-        delay(200);
+    if (uuid == GOPRO_WIFI_SSID_UUID && pChar->canRead()) {
+        cam.handles.ssid = pChar->getHandle();
+        LOG_DEBUG(BLE, "    -> WiFi SSID");
+    }
+    else if (uuid == GOPRO_WIFI_PASSWORD_UUID && pChar->canRead()) {
+        cam.handles.password = pChar->getHandle();
+        LOG_DEBUG(BLE, "    -> WiFi Password");
+    }
+    else if (uuid == GOPRO_WIFI_AP_ENABLE_UUID && pChar->canWrite()) {
+        cam.handles.apEnable = pChar->getHandle();
+        LOG_DEBUG(BLE, "    -> WiFi AP Enable");
+    }
+    else if (uuid == GOPRO_WIFI_AP_STATE_UUID && pChar->canRead()) {
+        cam.handles.apState = pChar->getHandle();
+        LOG_DEBUG(BLE, "    -> WiFi AP State");
+    }
+    else if (uuid == GOPRO_COMMAND_UUID && pChar->canWrite()) {
+        cam.handles.command = pChar->getHandle();
+        LOG_DEBUG(BLE, "    -> Command");
+    }
+    else if (uuid == GOPRO_COMMAND_RESPONSE_UUID) {
+        cam.handles.commandResponse = pChar->getHandle();
+        LOG_DEBUG(BLE, "    -> Command Response");
     }
-    
-    Serial.println("[BLE] ERROR: Timeout waiting for AP mode");
-    return false;
 }
 
-// Scan for GoPro devices
-NimBLEAddress* scanForGoPro() {
-    Serial.println("[BLE] Scanning for GoPro devices...");
-    
-    NimBLEScan* pScan = NimBLEDevice::getScan();
-    pScan->setActiveScan(true);
-    pScan->setInterval(100);
-    pScan->setWindow(99);
+// Discover only the WiFi AP service (by UUID) and the characteristics inside it
+bool discoverWiFiAPService(GoProCamera& cam) {
+    LOG_INFO(BLE, "Connected! Discovering WiFi AP service...");
     
-    NimBLEScanResults results = pScan->start(SCAN_TIME_SECONDS, false);
+    NimBLERemoteService* pService = cam.client->getService(GOPRO_WIFI_AP_SERVICE_UUID);
+    if (pService == nullptr) {
+        return false;
+    }
     
-    for (int i = 0; i < results.getCount(); i++) {
-        NimBLEAdvertisedDevice device = results.getDevice(i);
-        String deviceName = device.getName().c_str();
-        
-        // Look for devices starting with "GoPro"
-        if (deviceName.startsWith("GoPro")) {
-            Serial.printf("[BLE] Found GoPro: %s (%s)\n", 
-                         deviceName.c_str(), 
-                         device.getAddress().toString().c_str());
-            
-            static NimBLEAddress addr = device.getAddress();
-            pScan->clearResults();
-            return &addr;
-        }
+    std::vector<NimBLERemoteCharacteristic*>* pChars = pService->getCharacteristics(true);
+    if (pChars == nullptr || pChars->empty()) {
+        return false;
     }
     
-    pScan->clearResults();
-    Serial.println("[BLE] No GoPro devices found");
-    return nullptr;
+    for (auto pChar : *pChars) {
+        matchGoProCharacteristic(cam, pChar);
+    }
+    return true;
 }
 
-// Connect to GoPro via BLE
-bool connectToGoPro(NimBLEAddress* pAddress) {
-    Serial.printf("[BLE] Connecting to GoPro at %s...\n", pAddress->toString().c_str());
-    
-    if (pClient == nullptr) {
-        pClient = NimBLEDevice::createClient();
-        pClient->setClientCallbacks(new MyClientCallback());
-        pClient->setConnectTimeout(BLE_CONNECT_TIMEOUT_MS / 1000);
+// Discover the control service for the command channel (optional: without it
+// the time is set over WiFi)
+bool discoverControlService(GoProCamera& cam) {
+    NimBLERemoteService* pService = cam.client->getService(GOPRO_CONTROL_SERVICE_UUID);
+    if (pService == nullptr) {
+        return false;
     }
     
-    if (!pClient->connect(*pAddress)) {
-        Serial.println("[BLE] ERROR: Failed to connect");
+    std::vector<NimBLERemoteCharacteristic*>* pChars = pService->getCharacteristics(true);
+    if (pChars == nullptr) {
         return false;
     }
     
-    Serial.println("[BLE] Connected! Discovering services...");
-    
-    // Get all services first
-    std::vector<NimBLERemoteService*>* pServices = pClient->getServices(true);
+    for (auto pChar : *pChars) {
+        matchGoProCharacteristic(cam, pChar);
+    }
+    return cam.handles.command != 0 && cam.handles.commandResponse != 0;
+}
+
+// Discover every service and characteristic (fallback)
+bool discoverAllServices(GoProCamera& cam) {
+    std::vector<NimBLERemoteService*>* pServices = cam.client->getServices(true);
     if (pServices == nullptr || pServices->empty()) {
-        Serial.println("[BLE] ERROR: No services found");
+        LOG_ERROR(BLE, "ERROR: No services found");
         return false;
     }
     
-    Serial.printf("[BLE] Found %d services\n", pServices->size());
+    LOG_DEBUG(BLE, "Found %d services", (int)pServices->size());
     
     // Find characteristics across all services
     for (auto pService : *pServices) {
-        Serial.printf("[BLE] Checking service: %s\n", pService->getUUID().toString().c_str());
+        LOG_DEBUG(BLE, "Checking service: %s", pService->getUUID().toString().c_str());
         
         std::vector<NimBLERemoteCharacteristic*>* pChars = pService->getCharacteristics(true);
         if (pChars != nullptr) {
             for (auto pChar : *pChars) {
-                std::string uuidStd = pChar->getUUID().toString();
-                String uuid = String(uuidStd.c_str());
-                Serial.printf("[BLE]   - Characteristic: %s\n", uuid.c_str());
-                
-                // Only look for WiFi-related characteristics
-                if (uuid.equalsIgnoreCase(GOPRO_WIFI_SSID_UUID)) {
-                    pWiFiSSIDChar = pChar;
-                    Serial.println("[BLE]     -> WiFi SSID");
-                }
-                else if (uuid.equalsIgnoreCase(GOPRO_WIFI_PASSWORD_UUID)) {
-                    pWiFiPasswordChar = pChar;
-                    Serial.println("[BLE]     -> WiFi Password");
-                }
-                else if (uuid.equalsIgnoreCase(GOPRO_WIFI_AP_ENABLE_UUID)) {
-                    pWiFiAPEnableChar = pChar;
-                    Serial.println("[BLE]     -> WiFi AP Enable");
-                }
-                else if (uuid.equalsIgnoreCase(GOPRO_WIFI_AP_STATE_UUID)) {
-                    pWiFiAPStateChar = pChar;
-                    Serial.println("[BLE]     -> WiFi AP State");
-                }
+                LOG_DEBUG(BLE, "  - Characteristic: %s", pChar->getUUID().toString().c_str());
+                matchGoProCharacteristic(cam, pChar);
             }
         }
     }
+    return true;
+}
+
+// Connect to GoPro via BLE
+bool connectToGoPro(GoProCamera& cam) {
+    LOG_INFO(BLE, "Connecting to GoPro at %s...", goProAddressText(cam.address).c_str());
+    TraceSpan span(TRACE_CONNECT);
+    
+    if (cam.client == nullptr) {
+        cam.client = NimBLEDevice::createClient();
+        cam.client->setClientCallbacks(&clientCallbacks, false);
+        cam.client->setConnectTimeout(BLE_CONNECT_TIMEOUT_MS / 1000);
+    }
+    
+    cam.commandReady = false;
+    if (!cam.client->connect(cam.address)) {
+        LOG_ERROR(BLE, "ERROR: Failed to connect");
+        return false;
+    }
+    
+    // First connection: the camera is paired from now on, and the rig's
+    // scans let the controller filter on its address
+    if (!pairedCameraKnown(cam.address)) {
+        if (pairedCameraAdd(cam.address, cam.advert)) {
+            LOG_INFO(BLE, "Paired with %s, added to the whitelist", goProAddressText(cam.address).c_str());
+        } else {
+            LOG_WARN(BLE, "WARNING: Paired camera list is full, camera not whitelisted");
+        }
+    }
+    
+    // Fast path: cached handles from a previous connection to this camera
+    cam.handles = {};
+    GoProHandles cached;
+    if (gattCacheLoad(cam.address, cached)) {
+        if (gattValidateHandles(cam.client, cached)) {
+            cam.handles = cached;
+            LOG_INFO(BLE, "Using cached GATT handles (SSID 0x%04x, Password 0x%04x, Enable 0x%04x, State 0x%04x, Command 0x%04x)",
+                    cached.ssid, cached.password, cached.apEnable, cached.apState, cached.command);
+            LOG_INFO(BLE, "BLE connection established!");
+            span.ok();
+            return true;
+        }
+        LOG_INFO(BLE, "Cached GATT handles are stale, rediscovering...");
+        gattCacheErase(cam.address);
+    }
+    
+    // Targeted discovery of the WiFi AP service; full discovery only as a fallback
+    if (!discoverWiFiAPService(cam)) {
+        LOG_INFO(BLE, "WiFi AP service not found by UUID, discovering all services...");
+        if (!discoverAllServices(cam)) {
+            return false;
+        }
+    } else if (SYNC_OVER_BLE && !discoverControlService(cam)) {
+        LOG_INFO(BLE, "Command channel not found, time will be set over WiFi");
+    }
     
     // Check if we found all required WiFi characteristics
-    if (pWiFiSSIDChar == nullptr || pWiFiPasswordChar == nullptr || 
-        pWiFiAPEnableChar == nullptr || pWiFiAPStateChar == nullptr) {
-        Serial.println("[BLE] ERROR: Missing required WiFi characteristics");
-        Serial.printf("[BLE]   SSID: %s, Password: %s, Enable: %s, State: %s\n", 
-                     pWiFiSSIDChar ? "OK" : "MISSING",
-                     pWiFiPasswordChar ? "OK" : "MISSING",
-                     pWiFiAPEnableChar ? "OK" : "MISSING",
-                     pWiFiAPStateChar ? "OK" : "MISSING");
+    if (cam.handles.ssid == 0 || cam.handles.password == 0 ||
+        cam.handles.apEnable == 0 || cam.handles.apState == 0) {
+        LOG_ERROR(BLE, "ERROR: Missing required WiFi characteristics");
+        LOG_ERROR(BLE, "  SSID: %s, Password: %s, Enable: %s, State: %s",
+                 cam.handles.ssid ? "OK" : "MISSING",
+                 cam.handles.password ? "OK" : "MISSING",
+                 cam.handles.apEnable ? "OK" : "MISSING",
+                 cam.handles.apState ? "OK" : "MISSING");
         return false;
     }
     
-    Serial.println("[BLE] BLE connection established!");
+    // Remember the handles so the next connection can skip discovery
+    if (gattCacheStore(cam.address, cam.handles)) {
+        LOG_INFO(BLE, "GATT handles cached for next connection");
+    }
+    
+    LOG_INFO(BLE, "BLE connection established!");
+    span.ok();
     return true;
 }
 
-// Connect to GoPro WiFi AP
-bool connectToGoProWiFi() {
-    Serial.printf("[WiFi] Connecting to GoPro AP: %s...\n", goProSSID.c_str());
+// Get WiFi credentials from the per-camera cache, reading them over BLE on a miss
+bool getWiFiCredentials(GoProCamera& cam) {
+    if (credentialCacheLoad(cam.address, cam.ssid, cam.password)) {
+        LOG_INFO(BLE, "Using cached WiFi credentials (SSID: %s)", cam.ssid.c_str());
+        cam.credentialsRead = false;
+        return true;
+    }
     
-    WiFi.mode(WIFI_STA);
-    WiFi.begin(goProSSID.c_str(), goProPassword.c_str());
+    if (!getWiFiSSID(cam) || !getWiFiPassword(cam)) {
+        return false;
+    }
+    cam.credentialsRead = true;
     
-    uint32_t startTime = millis();
-    while (WiFi.status() != WL_CONNECTED && (millis() - startTime < WIFI_CONNECT_TIMEOUT_MS)) {
-        delay(500);
-        Serial.print(".");
+    if (credentialCacheStore(cam.address, cam.ssid, cam.password)) {
+        LOG_INFO(BLE, "WiFi credentials cached for next connection");
     }
-    Serial.println();
+    return true;
+}
+
+// WiFi event handler (runs on the WiFi event task)
+void onWiFiEvent(WiFiEvent_t event, WiFiEventInfo_t info) {
+    switch (event) {
+        case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+            xEventGroupSetBits(wifiEvents, WIFI_GOT_IP_BIT);
+            break;
+        case ARDUINO_EVENT_WIFI_STA_CONNECTED:
+            xEventGroupSetBits(wifiEvents, WIFI_ASSOCIATED_BIT);
+            break;
+        case ARDUINO_EVENT_WIFI_STA_DISCONNECTED: {
+            uint8_t reason = info.wifi_sta_disconnected.reason;
+            if (reason == WIFI_REASON_AUTH_FAIL || reason == WIFI_REASON_4WAY_HANDSHAKE_TIMEOUT ||
+                reason == WIFI_REASON_HANDSHAKE_TIMEOUT) {
+                xEventGroupSetBits(wifiEvents, WIFI_AUTH_FAILED_BIT);
+            } else if (reason == WIFI_REASON_NO_AP_FOUND) {
+                xEventGroupSetBits(wifiEvents, WIFI_NO_AP_BIT);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+    xEventGroupSetBits(engineEvents, ENGINE_WAKE_BIT);
+}
+
+// Probe the static address candidates from the address-less station and
+// take the first no other host claims (GOT_IP follows). False once every
+// candidate is taken, or if no probe can be sent.
+bool claimStaticIP() {
+    for (uint8_t attempt = 0; attempt < STATIC_IP_ATTEMPTS; attempt++) {
+        IPAddress ip = staticIPCandidate(attempt);
+        bool inUse;
+        if (!staticIPProbe(ip, inUse)) {
+            LOG_WARN(WIFI, "WARNING: Could not send an ARP probe");
+            return false;
+        }
+        if (!inUse) {
+            return staticIPApply(ip);
+        }
+        LOG_INFO(WIFI, "Static IP %u.%u.%u.%u already in use", ip[0], ip[1], ip[2], ip[3]);
+    }
+    return false;
+}
+
+// Join the AP; with a static address the station associates without one
+// until claimStaticIP() has probed it
+void beginWiFiJoin(GoProCamera& cam, int32_t channel, const uint8_t* bssid) {
+    xEventGroupClearBits(wifiEvents, WIFI_GOT_IP_BIT | WIFI_AUTH_FAILED_BIT | WIFI_NO_AP_BIT | WIFI_ASSOCIATED_BIT);
+    WiFi.begin(cam.ssid.c_str(), cam.password.c_str(), channel, bssid);
+    if (WIFI_STATIC_IP && !wifiDhcp && !staticIPHold()) {
+        wifiDhcp = true;
+    }
+}
+
+// Start joining the camera's WiFi AP, pinned to the cached BSSID/channel
+// when known. The station is the camera's until releaseWiFi(); the
+// CAMERA_WIFI_JOIN state waits for the outcome.
+void startWiFiJoin(GoProCamera& cam) {
+    LOG_INFO(WIFI, "Connecting to GoPro AP: %s...", cam.ssid.c_str());
+    traceBegin(TRACE_WIFI_JOIN);
+    wifiOwner = &cam;
     
-    if (WiFi.status() == WL_CONNECTED) {
-        Serial.printf("[WiFi] Connected! IP: %s\n", WiFi.localIP().toString().c_str());
-        return true;
+    WiFi.mode(WIFI_STA);
+    wifiJoinStatus = WL_IDLE_STATUS;
+    wifiDhcp = false;
+    
+    uint8_t bssid[6];
+    uint8_t channel;
+    cam.fastJoin = credentialCacheLoadAP(cam.address, bssid, channel);
+    if (cam.fastJoin) {
+        LOG_INFO(WIFI, "Fast join on channel %u, BSSID %02x:%02x:%02x:%02x:%02x:%02x",
+                 channel, bssid[0], bssid[1], bssid[2], bssid[3], bssid[4], bssid[5]);
+        beginWiFiJoin(cam, channel, bssid);
     } else {
-        Serial.println("[WiFi] ERROR: Connection failed");
-        return false;
+        beginWiFiJoin(cam, 0, nullptr);
     }
+    cameraSetState(cam, CAMERA_WIFI_JOIN);
 }
 
-// Set date/time on GoPro via HTTP
-bool setGoProDateTime() {
-    Serial.println("[HTTP] Setting GoPro date/time...");
+// Leave the camera's AP if the station is on it
+void releaseWiFi(GoProCamera& cam) {
+    if (wifiOwner == &cam) {
+        goProHttpClose();
+        WiFi.disconnect();
+        wifiOwner = nullptr;
+    }
+}
+
+// Choose the RTC second a set-time request will carry: the first upcoming
+// second whose edge is still more than oneWayUs away. edgeUs receives the
+// micros() time of that edge. Without SQW edges the current second is sent
+// at once, as before.
+DateTime nextSyncSecond(uint32_t oneWayUs, uint32_t& edgeUs) {
+    DateTime second;
+    if (!rtcReadAtEdge(rtc, second, edgeUs)) {
+        edgeUs = micros() + oneWayUs;
+        return rtc.now();
+    }
     
-    // Get current time from DS3231 RTC
-    DateTime now = rtc.now();
+    uint32_t target = second.unixtime() + 1;
+    edgeUs += 1000000;
+    while ((int32_t)(edgeUs - oneWayUs - micros()) < ALIGN_MIN_LEAD_US) {
+        target++;
+        edgeUs += 1000000;
+    }
+    return DateTime(target);
+}
+
+// Current one-way estimate for this camera
+uint32_t oneWayEstimate(GoProCamera& cam, LinkTransport transport) {
+    return linkLatencyOneWay(cam.address, transport,
+                             transport == LINK_BLE ? BLE_ONE_WAY_DEFAULT_US : HTTP_ONE_WAY_DEFAULT_US);
+}
+
+// Time one round trip on the set-time request's path and fold the implied
+// one-way delay into the camera's estimate
+bool probeLink(GoProCamera& cam, LinkTransport transport) {
+    uint32_t rttUs;
+    uint32_t oneWayUs;
+    if (transport == LINK_BLE) {
+        // Same ATT write request/response exchange as the command write
+        if (!gattProbe(cam.client, cam.handles.commandResponse, rttUs)) {
+            return false;
+        }
+        oneWayUs = rttUs / 2;
+    } else {
+        // The GET goes out on the open session: half a round trip
+        if (!goProHttpProbe(rttUs)) {
+            return false;
+        }
+        oneWayUs = rttUs / 2;
+    }
+    linkLatencyAddSample(cam.address, transport, oneWayUs);
+    return true;
+}
+
+// Log the camera's current one-way estimate for a transport
+void printLinkEstimate(GoProCamera& cam, LinkTransport transport) {
+    LinkEstimate estimate;
+    if (linkLatencyGet(cam.address, transport, estimate)) {
+        LOG_INFO(SYNC, "%s one-way %.1f ms (stddev %.1f ms, %u samples)",
+                 linkTransportName(transport), estimate.oneWayUs / 1000.0,
+                 estimate.stddevUs / 1000.0, (unsigned)estimate.samples);
+    }
+}
+
+// Set date/time on GoPro over the BLE command channel (Open GoPro Set Date/Time)
+GoProCommandResult setGoProDateTimeBLE(GoProCamera& cam, const DateTime& target) {
+    LOG_INFO(BLE, "Setting GoPro date/time over BLE...");
+    
+    if (!cam.commandReady) {
+        LOG_ERROR(BLE, "ERROR: Command channel unavailable");
+        return GOPRO_CMD_UNAVAILABLE;
+    }
     
-    Serial.printf("[RTC] Current time: %04d-%02d-%02d %02d:%02d:%02d\n",
-                  now.year(), now.month(), now.day(),
-                  now.hour(), now.minute(), now.second());
+    uint8_t packet[GOPRO_CMD_SET_DATE_TIME_LENGTH];
+    goProBuildSetDateTime(packet, target.year(), target.month(), target.day(),
+                          target.hour(), target.minute(), target.second());
     
-    // Use the legacy GoPro API endpoint with hex-encoded parameters
-    // Format: /gp/gpControl/command/setup/date_time?p=%YY%MM%DD%HH%MM%SS
-    char url[256];
-    snprintf(url, sizeof(url),
-             "http://10.5.5.9/gp/gpControl/command/setup/date_time?p=%%%02x%%%02x%%%02x%%%02x%%%02x%%%02x",
-             now.year() % 100, now.month(), now.day(),
-             now.hour(), now.minute(), now.second());
+    TraceSpan span(TRACE_SET_TIME);
+    uint32_t writeRttUs = 0;
+    GoProCommandResult result = goProSendCommand(cam.client, cam.handles, packet, sizeof(packet), &writeRttUs);
+    
+    LOG_INFO(RTC, "Sent time: %04d-%02d-%02d %02d:%02d:%02d",
+             target.year(), target.month(), target.day(),
+             target.hour(), target.minute(), target.second());
+    
+    if (result == GOPRO_CMD_OK) {
+        // The write lands about half its round trip after it is sent
+        linkLatencyAddSample(cam.address, LINK_BLE, writeRttUs / 2);
+        LOG_INFO(BLE, "Time synchronized successfully!");
+        printLinkEstimate(cam, LINK_BLE);
+        span.ok();
+    } else {
+        LOG_ERROR(BLE, "ERROR: Set date/time %s", goProCommandResultName(result));
+    }
+    return result;
+}
+
+// Set date/time on GoPro via HTTP
+bool setGoProDateTime(GoProCamera& cam, const DateTime& target) {
+    LOG_INFO(HTTP, "Setting GoPro date/time...");
+    
+    // Request template with the date and time patched in place
+    static const GoProHttpDateTimeForm form =
+        HTTP_DATE_TIME_OPEN_GOPRO ? GOPRO_HTTP_DATE_TIME_OPEN_GOPRO : GOPRO_HTTP_DATE_TIME_LEGACY;
+    static GoProHttpRequest request;
+    if (request.length == 0) {
+        goProHttpPrepareDateTime(request, form);
+    }
+    goProHttpPatchDateTime(request, form, target.year(), target.month(), target.day(),
+                           target.hour(), target.minute(), target.second());
     
-    Serial.printf("[HTTP] URL: %s\n", url);
+    TraceSpan span(TRACE_SET_TIME);
+    int httpCode = goProHttpSend(request);
     
-    HTTPClient http;
-    http.begin(url);
-    int httpCode = http.GET();
+    LOG_INFO(RTC, "Sent time: %04d-%02d-%02d %02d:%02d:%02d",
+             target.year(), target.month(), target.day(),
+             target.hour(), target.minute(), target.second());
     
     if (httpCode == 200 || httpCode == 204) {
-        Serial.println("[HTTP] Time synchronized successfully!");
-        http.end();
+        LOG_INFO(HTTP, "Time synchronized successfully!");
+        printLinkEstimate(cam, LINK_HTTP);
+        span.ok();
         return true;
     } else {
-        Serial.printf("[HTTP] ERROR: Request failed with code %d\n", httpCode);
-        String payload = http.getString();
-        if (payload.length() > 0) {
-            Serial.printf("[HTTP] Response: %s\n", payload.c_str());
+        LOG_ERROR(HTTP, "ERROR: Request failed with code %d", httpCode);
+        return false;
+    }
+}
+
+// Send the planned set over the camera's link. A camera that rejects the
+// BLE command is switched to the WiFi/HTTP path for the rest of this boot
+// (the caller starts the handover). The first set of a sync attempt closes
+// its time-to-sync sample.
+bool setGoProTime(GoProCamera& cam) {
+    DateTime target(cam.targetSecond);
+    bool ok;
+    if (!cam.bleLink) {
+        ok = setGoProDateTime(cam, target);
+    } else {
+        GoProCommandResult result = setGoProDateTimeBLE(cam, target);
+        ok = result == GOPRO_CMD_OK;
+        if (!ok && cam.client->isConnected()) {
+            LOG_INFO(BLE, "Set date/time over BLE %s, falling back to WiFi",
+                     goProCommandResultName(result));
+            cam.bleTimeRejected = true;
+            cam.bleLink = false;
         }
-        http.end();
+    }
+    
+    if (ok) {
+        cam.sets++;
+        if (cam.attemptActive) {
+            traceRecord(TRACE_TIME_TO_SYNC, cam.attemptStartUs, true);
+            cam.attemptActive = false;
+        }
+    }
+    return ok;
+}
+
+// Camera clock over the BLE command channel
+bool readGoProClockBLE(GoProCamera& cam, CameraClockReading& reading) {
+    GoProDateTime value;
+    reading.sentUs = micros();
+    if (goProGetDateTime(cam.client, cam.handles, value) != GOPRO_CMD_OK) {
         return false;
     }
+    reading.receivedUs = micros();
+    reading.second = DateTime(value.year, value.month, value.day,
+                              value.hour, value.minute, value.second).unixtime();
+    return true;
 }
 
-void setup() {
-    Serial.begin(115200);
-    delay(1000);
+// Camera clock from the legacy status document (status 40, "%YY%MM%DD%HH%MM%SS")
+bool readGoProClockHTTP(GoProCamera& cam, CameraClockReading& reading) {
+    (void)cam;
+    static GoProHttpRequest request;
+    if (request.length == 0) {
+        goProHttpPrepare(request, "/gp/gpControl/status");
+    }
     
-    Serial.println("\n\n==================================");
-    Serial.println("ESP32 GoPro Time Sync");
-    Serial.println("==================================\n");
+    GoProHttpTiming timing;
+    char clock[24];
+    int httpCode = goProHttpSend(request, &timing, "\"40\":\"", clock, sizeof(clock));
+    if (httpCode != 200) {
+        return false;
+    }
+    reading.sentUs = timing.sentUs;
+    reading.receivedUs = timing.receivedUs;
     
-    // Initialize buzzer pin
-    pinMode(BUZZER_PIN, OUTPUT);
-    digitalWrite(BUZZER_PIN, LOW);
-    Serial.printf("[BUZZER] Initialized on GPIO %d\n", BUZZER_PIN);
+    unsigned yy, mo, dd, hh, mi, ss;
+    if (sscanf(clock, "%%%2x%%%2x%%%2x%%%2x%%%2x%%%2x", &yy, &mo, &dd, &hh, &mi, &ss) != 6) {
+        return false;
+    }
+    reading.second = DateTime(2000 + yy, mo, dd, hh, mi, ss).unixtime();
+    return true;
+}
+
+// micros() at which the camera's planned set has to go out
+uint32_t setSendAtUs(GoProCamera& cam) {
+    return cam.targetEdgeUs - oneWayEstimate(cam, cam.bleLink ? LINK_BLE : LINK_HTTP);
+}
+
+// Another camera's set goes out before untilUs. Each exchange blocks the
+// engine for its round trip (a BLE connect for far longer), so one started
+// now could push that set past its slot.
+bool setDueBefore(uint32_t untilUs, const GoProCamera& cam) {
+    for (uint8_t i = 0; i < cameraCount(); i++) {
+        GoProCamera& other = cameraAt(i);
+        if (&other != &cam && other.state == CAMERA_ALIGN && (int32_t)(setSendAtUs(other) - untilUs) < 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Another camera's set is aimed at the second this camera's carries
+bool targetTaken(const GoProCamera& cam) {
+    for (uint8_t i = 0; i < cameraCount(); i++) {
+        const GoProCamera& other = cameraAt(i);
+        if (&other != &cam && other.state == CAMERA_ALIGN && other.targetSecond == cam.targetSecond) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Choose the RTC second the camera's next set carries: the first reachable
+// one that no other camera's set is aimed at, so sets go out one per edge
+void planTimeSet(GoProCamera& cam) {
+    LinkTransport transport = cam.bleLink ? LINK_BLE : LINK_HTTP;
+    cam.targetSecond = nextSyncSecond(oneWayEstimate(cam, transport), cam.targetEdgeUs).unixtime();
+    while (targetTaken(cam)) {
+        cam.targetSecond++;
+        cam.targetEdgeUs += 1000000;
+    }
+}
+
+// Sleep out the last ENGINE_SLOT_LEAD_MS before a timed send. Further out,
+// the camera is put to sleep until then and false returned, so the engine
+// serves other cameras meanwhile.
+bool reachSendSlot(GoProCamera& cam, uint32_t sendAtUs) {
+    int32_t waitUs = (int32_t)(sendAtUs - micros());
+    if (waitUs > ENGINE_SLOT_LEAD_MS * 1000) {
+        cameraWakeAfter(cam, waitUs / 1000 - ENGINE_SLOT_LEAD_MS);
+        return false;
+    }
+    rtcSleepUntil(sendAtUs);
+    return true;
+}
+
+// Subscribe to command responses (once per connection) ahead of a timed
+// exchange over BLE, so that the subscription write does not land inside
+// its slot
+void prepareCommandChannel(GoProCamera& cam) {
+    if (cam.bleLink && !cam.commandReady) {
+        cam.commandReady = goProCommandBegin(cam.client, cam.handles);
+    }
+}
+
+// Start bracketing the camera's offset from the RTC over the link in use
+// (CAMERA_DRIFT before a periodic set, CAMERA_VERIFY after every set)
+void beginMeasure(GoProCamera& cam, CameraState state) {
+    prepareCommandChannel(cam);
+    LinkTransport transport = cam.bleLink ? LINK_BLE : LINK_HTTP;
+    LinkEstimate link = {};
+    if (!linkLatencyGet(cam.address, transport, link)) {
+        link.oneWayUs = oneWayEstimate(cam, transport);
+    }
+    clockVerifyBegin(rtc, link, cam.measure);
+    cameraSetState(cam, state);
+}
+
+enum MeasureStep : uint8_t {
+    MEASURE_WAITING,           // Next read not due yet, or more reads needed
+    MEASURE_DONE,
+    MEASURE_FAILED,
+};
+
+// Take the measurement's next read once its slot comes up. offset is set
+// when the bracket is complete.
+MeasureStep stepMeasure(GoProCamera& cam, ClockOffset& offset) {
+    // Reads give way to sets; a read that misses its slot moves to the next second
+    uint32_t sendAtUs = clockVerifyNextReadUs(cam.measure);
+    if (setDueBefore(sendAtUs + EXCHANGE_GUARD_MS * 1000, cam) || !reachSendSlot(cam, sendAtUs)) {
+        return MEASURE_WAITING;
+    }
     
-    // Initialize I2C for DS3231 RTC
-    Serial.println("[RTC] Initializing DS3231 RTC...");
-    Wire.begin();
+    CameraClockReading reading;
+    bool ok = cam.bleLink ? readGoProClockBLE(cam, reading) : readGoProClockHTTP(cam, reading);
+    if (!ok || !clockVerifyAddReading(cam.measure, reading)) {
+        traceRecord(TRACE_VERIFY, cam.stateSinceUs, false);
+        return MEASURE_FAILED;
+    }
+    if (!clockVerifyDone(cam.measure)) {
+        return MEASURE_WAITING;
+    }
     
-    if (!rtc.begin()) {
-        Serial.println("[RTC] ERROR: Couldn't find DS3231 RTC!");
-        Serial.println("[RTC] Please check I2C connections (SDA=21, SCL=22)");
-        Serial.println("Restarting in 5 seconds...");
-        delay(5000);
-        ESP.restart();
+    clockVerifyResult(cam.measure, offset);
+    LOG_INFO(VERIFY, "Camera clock offset %+.1f ms (+/- %.1f ms, %u reads)",
+             offset.offsetUs / 1000.0, offset.uncertaintyUs / 1000.0, (unsigned)offset.reads);
+    traceRecord(TRACE_VERIFY, cam.stateSinceUs, true);
+    return MEASURE_DONE;
+}
+
+// Set the time on the next RTC second edge that can still be reached;
+// CAMERA_ALIGN waits for its send slot
+void beginTimeSet(GoProCamera& cam) {
+    prepareCommandChannel(cam);
+    cam.probes = 0;
+    cam.sendFailures = 0;
+    planTimeSet(cam);
+    cameraSetState(cam, CAMERA_ALIGN);
+}
+
+// Delay until the camera's next periodic sync: just before the drift model
+// predicts it could be SYNC_DRIFT_TOLERANCE_MS off
+uint32_t nextSyncDelayMs(GoProCamera& cam) {
+    DriftEstimate drift;
+    if (!SYNC_VERIFY || !driftModelGet(cam.address, drift) || !drift.anchored) {
+        return SYNC_INTERVAL_DEFAULT_MS;
+    }
+    
+    uint32_t delayMs = driftNextSyncDelay(cam.address, rtc.now().unixtime(),
+                                          (uint32_t)SYNC_DRIFT_TOLERANCE_MS * 1000,
+                                          SYNC_INTERVAL_MIN_MS, SYNC_INTERVAL_MAX_MS);
+    LOG_INFO(SYNC, "Drift %+.2f ppm (sigma %.2f ppm, %u measurements), next sync in %lu min",
+             drift.ratePpm, drift.sigmaPpm, (unsigned)drift.measurements,
+             (unsigned long)(delayMs / 60000));
+    return delayMs;
+}
+
+// The camera's link to us: BLE, or the station on its AP for HTTP sync
+bool linkUp(GoProCamera& cam) {
+    if (cam.bleLink) {
+        return cam.client != nullptr && cam.client->isConnected();
+    }
+    return wifiOwner == &cam && WiFi.status() == WL_CONNECTED;
+}
+
+// Drop the camera's links; the next scan finds it again
+void loseCamera(GoProCamera& cam) {
+    if (cam.client != nullptr && cam.client->isConnected()) {
+        cam.client->disconnect();
+    }
+    releaseWiFi(cam);
+    if (cam.attemptActive) {
+        traceRecord(TRACE_TIME_TO_SYNC, cam.attemptStartUs, false);
+        cam.attemptActive = false;
+    }
+    cam.parked = false;
+    cam.resync = false;
+    cameraSetState(cam, CAMERA_ABSENT);
+}
+
+// A camera that can give its LE link up: synced, or (so that another
+// camera's time is set first) waiting for its verification
+bool canPark(GoProCamera& cam, bool verifying) {
+    if (cam.parked || !cam.bleLink || !linkUp(cam)) {
+        return false;
+    }
+    return cam.state == CAMERA_SYNCED || (verifying && cam.state == CAMERA_VERIFY);
+}
+
+// Park a camera to free an LE link for another: the synced camera whose next
+// sync is furthest away, else one waiting for verification. False if no
+// camera can be parked.
+bool parkOneCamera(bool verifying) {
+    GoProCamera* victim = nullptr;
+    uint32_t victimScore = 0;
+    for (uint8_t i = 0; i < cameraCount(); i++) {
+        GoProCamera& c = cameraAt(i);
+        if (!canPark(c, verifying)) {
+            continue;
+        }
+        uint32_t score = 0;
+        if (c.state == CAMERA_SYNCED) {
+            uint32_t elapsedMs = millis() - c.lastSyncMs;
+            score = 1 + (elapsedMs < c.syncIntervalMs ? c.syncIntervalMs - elapsedMs : 0);
+        }
+        if (victim == nullptr || score > victimScore) {
+            victim = &c;
+            victimScore = score;
+        }
+    }
+    if (victim == nullptr) {
+        return false;
+    }
+    
+    LOG_INFO(CAM, "%s: parking (%s)", goProAddressText(victim->address).c_str(),
+             cameraStateName(victim->state));
+    victim->parked = true;
+    victim->client->disconnect();
+    return true;
+}
+
+// An LE link is free, or a camera can give its link up
+bool linkAvailable(bool verifying) {
+    if (cameraLinks() < CAMERA_MAX_LINKS) {
+        return true;
+    }
+    for (uint8_t i = 0; i < cameraCount(); i++) {
+        if (canPark(cameraAt(i), verifying)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Some camera is waiting for a link to have its time set, and could get one
+bool setPending() {
+    for (uint8_t i = 0; i < cameraCount(); i++) {
+        if (cameraAt(i).state == CAMERA_FOUND && linkAvailable(true)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// A sync attempt is over: schedule the next one from the drift model, or a
+// retry after a failure
+void finishSync(GoProCamera& cam, bool ok) {
+    cam.lastSyncMs = millis();
+    if (ok) {
+        LOG_INFO(SYNC, "%s: time synchronized!", goProAddressText(cam.address).c_str());
+        beep();  // Confirmation beep
+        cam.syncIntervalMs = nextSyncDelayMs(cam);
+    } else {
+        LOG_WARN(SYNC, "WARNING: Time sync failed, but connection is established");
+        cam.syncIntervalMs = CAMERA_RETRY_MS;
+    }
+    cameraSetState(cam, CAMERA_SYNCED);
+    memoryWatchCycle();
+}
+
+// Bring up the camera's WiFi AP over BLE (HTTP sync path). The AP wait and
+// the join are states of their own, so other cameras progress meanwhile.
+void startWiFiHandover(GoProCamera& cam) {
+    // WiFi credentials (cached per camera, re-read only if rejected)
+    if (!getWiFiCredentials(cam)) {
+        LOG_ERROR(BLE, "ERROR: Failed to get WiFi credentials");
+        loseCamera(cam);
         return;
     }
     
-    if (rtc.lostPower()) {
-        Serial.println("[RTC] WARNING: RTC lost power, time may be incorrect!");
+    if (!enableWiFiAP(cam)) {
+        LOG_ERROR(BLE, "ERROR: Failed to enable WiFi AP");
+        loseCamera(cam);
+        return;
     }
     
-    // Display current RTC time
-    DateTime now = rtc.now();
-    Serial.printf("[RTC] Current time: %04d-%02d-%02d %02d:%02d:%02d\n",
-                  now.year(), now.month(), now.day(),
-                  now.hour(), now.minute(), now.second());
+    LOG_INFO(BLE, "Waiting for AP mode to be ready...");
+    cameraSetState(cam, CAMERA_WAIT_AP);
     
-    Serial.println("\n[INFO] Waiting 5 seconds before connecting to GoPro...");
-    delay(5000);
+    // One read covers an AP that was already up (no state change, so no notification)
+    if (checkAPModeStatus(cam)) {
+        xEventGroupSetBits(apEvents, AP_READY_BIT(cameraIndex(cam)));
+    }
+}
+
+// A BLE connect cannot run alongside a scan. A presence scan that has not
+// seen anything yet gives way (runEngine restarts it); otherwise the scan
+// is waited out, which takes at most SCAN_LINGER_MS once it has seen a
+// GoPro. True while a scan is still running.
+bool scanInTheWay() {
+    if (scanning && scanMode == SCAN_PRESENCE && scanSightings == 0 && !scanStopped) {
+        scanStopped = true;
+        NimBLEDevice::getScan()->stop();
+    }
+    return scanning;
+}
+
+// A camera is waiting to open a BLE connection
+bool connectPending() {
+    for (uint8_t i = 0; i < cameraCount(); i++) {
+        GoProCamera& c = cameraAt(i);
+        bool connected = c.client != nullptr && c.client->isConnected();
+        if ((c.state == CAMERA_FOUND && !connected) || (c.state == CAMERA_VERIFY && c.parked)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Start a sync over the camera's link: a periodic sync reads the drift
+// first, then the time is set on an RTC second edge
+void startSync(GoProCamera& cam) {
+    cam.sets = 0;
+    cam.verifyFailures = 0;
+    bool resync = cam.resync;
+    cam.resync = false;
+    if (SYNC_VERIFY && resync) {
+        beginMeasure(cam, CAMERA_DRIFT);
+    } else {
+        beginTimeSet(cam);
+    }
+}
+
+// CAMERA_FOUND: connect over BLE (once a scan in progress is over, and
+// not right before another camera's set), then set the time over BLE or
+// start the WiFi handover
+void stepFound(GoProCamera& cam) {
+    if (cam.client == nullptr || !cam.client->isConnected()) {
+        if (scanInTheWay() || setDueBefore(micros() + CONNECT_GUARD_MS * 1000, cam)) {
+            return;
+        }
+        if (cameraLinks() >= CAMERA_MAX_LINKS && !parkOneCamera(true)) {
+            return;  // Every link is busy with a sync in progress
+        }
+        if (!connectToGoPro(cam)) {
+            LOG_ERROR(BLE, "ERROR: Failed to connect to GoPro via BLE");
+            loseCamera(cam);
+            return;
+        }
+    }
     
-    // Initialize BLE
-    Serial.println("[BLE] Initializing BLE...");
-    NimBLEDevice::init("ESP32-GoPro");
-    NimBLEDevice::setPower(ESP_PWR_LVL_P9);
+    // BLE-only sync: the time is set over the command channel and the
+    // camera's WiFi AP is never started
+    cam.bleLink = SYNC_OVER_BLE && !cam.bleTimeRejected && cam.handles.command != 0;
+    if (cam.bleLink) {
+        startSync(cam);
+    } else {
+        startWiFiHandover(cam);
+    }
+}
+
+// CAMERA_WAIT_AP: AP state 0x03 (notified, or polled when the camera
+// refuses notifications), then drop BLE ahead of the join
+void stepWaitAP(GoProCamera& cam) {
+    EventBits_t bit = AP_READY_BIT(cameraIndex(cam));
+    bool ready = (xEventGroupGetBits(apEvents) & bit) != 0;
+    if (!ready && !cam.apStateNotifications) {
+        ready = checkAPModeStatus(cam);
+        cameraWakeAfter(cam, AP_READY_POLL_MS);
+    }
     
-    // Scan for GoPro
-    NimBLEAddress* pGoProAddress = scanForGoPro();
-    if (pGoProAddress == nullptr) {
-        Serial.println("\n[ERROR] No GoPro found. Please ensure:");
-        Serial.println("  1. GoPro is powered on");
-        Serial.println("  2. GoPro Bluetooth is enabled");
-        Serial.println("  3. GoPro is in pairing mode");
-        Serial.println("\nRestarting in 5 seconds...");
-        delay(5000);
-        ESP.restart();
+    if (!ready) {
+        if (cameraStateMs(cam) >= AP_READY_TIMEOUT_MS) {
+            traceRecord(TRACE_WAIT_AP, cam.stateSinceUs, false);
+            LOG_ERROR(BLE, "ERROR: Timeout waiting for AP mode");
+            loseCamera(cam);
+        }
         return;
     }
     
-    // Connect via BLE
-    if (!connectToGoPro(pGoProAddress)) {
-        Serial.println("\n[ERROR] Failed to connect to GoPro via BLE");
-        Serial.println("Restarting in 5 seconds...");
-        delay(5000);
-        ESP.restart();
+    xEventGroupClearBits(apEvents, bit);
+    traceRecord(TRACE_WAIT_AP, cam.stateSinceUs, true);
+    LOG_INFO(BLE, "AP Mode is ready (after %lu ms)", (unsigned long)cameraStateMs(cam));
+    LOG_INFO(BLE, "GoPro WiFi AP is ready!");
+    LOG_INFO(BLE, "  SSID: %s", cam.ssid.c_str());
+    
+    // Disconnect BLE (we'll use WiFi now)
+    LOG_INFO(BLE, "Disconnecting BLE...");
+    cam.client->disconnect();
+    cameraSetState(cam, CAMERA_WAIT_WIFI);
+    cameraWakeAfter(cam, BLE_RELEASE_MS);
+}
+
+// CAMERA_WAIT_WIFI: take the station once no other camera is joining or
+// syncing over it. A synced camera holding it is parked.
+void stepWaitWiFi(GoProCamera& cam) {
+    if (wifiOwner != nullptr) {
+        if (wifiOwner->state != CAMERA_SYNCED) {
+            return;
+        }
+        LOG_INFO(WIFI, "Leaving %s for %s", wifiOwner->ssid.c_str(), cam.ssid.c_str());
+        wifiOwner->parked = true;
+        releaseWiFi(*wifiOwner);
+    }
+    startWiFiJoin(cam);
+}
+
+// CAMERA_WIFI_JOIN: outcome of the join. A rejected cached password is
+// re-read over BLE; a pinned join that misses the AP falls back to a scan.
+void stepWiFiJoin(GoProCamera& cam) {
+    EventBits_t bits = xEventGroupGetBits(wifiEvents);
+    
+    // Associated without an address: probe for a static one before taking it
+    if ((bits & WIFI_ASSOCIATED_BIT) && WIFI_STATIC_IP && !wifiDhcp) {
+        xEventGroupClearBits(wifiEvents, WIFI_ASSOCIATED_BIT);
+        if (!claimStaticIP()) {
+            // GOT_IP is raised once DHCP has leased an address, within the
+            // full join timeout
+            LOG_INFO(WIFI, "No free static IP, falling back to DHCP...");
+            wifiDhcp = true;
+            cam.fastJoin = false;
+            if (!staticIPRelease()) {
+                traceEnd(TRACE_WIFI_JOIN, false);
+                LOG_ERROR(WIFI, "ERROR: Connection failed");
+                loseCamera(cam);
+                return;
+            }
+            cameraSetState(cam, CAMERA_WIFI_JOIN);
+        }
         return;
     }
     
-    // Get WiFi credentials (using direct characteristic reads)
-    Serial.println("\n[BLE] Reading WiFi credentials...");
-    delay(500);  // Give connection time to stabilize
+    if (bits & WIFI_GOT_IP_BIT) {
+        xEventGroupClearBits(wifiEvents, WIFI_GOT_IP_BIT);
+        wifiJoinStatus = WL_CONNECTED;
+        IPAddress local = WiFi.localIP();
+        LOG_INFO(WIFI, "Connected! IP: %u.%u.%u.%u", local[0], local[1], local[2], local[3]);
     
-    if (!getWiFiSSID() || !getWiFiPassword()) {
-        Serial.println("\n[ERROR] Failed to get WiFi credentials");
-        pClient->disconnect();
-        delay(5000);
-        ESP.restart();
+        // Remember where the AP is for the next join
+        uint8_t* pBSSID = WiFi.BSSID();
+        if (pBSSID != nullptr) {
+            credentialCacheStoreAP(cam.address, pBSSID, (uint8_t)WiFi.channel());
+        }
+        traceEnd(TRACE_WIFI_JOIN, true);
+        startSync(cam);
         return;
     }
     
-    // Enable WiFi AP
-    if (!enableWiFiAP()) {
-        Serial.println("\n[ERROR] Failed to enable WiFi AP");
-        pClient->disconnect();
-        delay(5000);
-        ESP.restart();
+    if (bits & WIFI_AUTH_FAILED_BIT) {
+        wifiJoinStatus = WL_CONNECT_FAILED;
+        traceEnd(TRACE_WIFI_JOIN, false);
+        LOG_ERROR(WIFI, "ERROR: Authentication failed");
+        releaseWiFi(cam);
+        if (cam.credentialsRead) {
+            loseCamera(cam);
+            return;
+        }
+        LOG_INFO(WIFI, "Credentials rejected, re-reading them over BLE...");
+        credentialCacheErase(cam.address);
+        cameraSetState(cam, CAMERA_FOUND);
         return;
     }
     
-    // Wait for AP to be ready
-    if (!waitForAPMode()) {
-        Serial.println("\n[ERROR] WiFi AP did not become ready");
-        pClient->disconnect();
-        delay(5000);
-        ESP.restart();
+    uint32_t timeoutMs = cam.fastJoin ? WIFI_FAST_JOIN_TIMEOUT_MS : WIFI_CONNECT_TIMEOUT_MS;
+    bool noAP = cam.fastJoin && (bits & WIFI_NO_AP_BIT);
+    if (!noAP && cameraStateMs(cam) < timeoutMs) {
         return;
     }
     
-    Serial.println("\n[SUCCESS] GoPro WiFi AP is ready!");
-    Serial.printf("  SSID: %s\n", goProSSID.c_str());
-    Serial.printf("  Password: %s\n", goProPassword.c_str());
+    if (cam.fastJoin) {
+        LOG_INFO(WIFI, "Fast join failed, falling back to full scan...");
+        WiFi.disconnect();
+        cam.fastJoin = false;
+        beginWiFiJoin(cam, 0, nullptr);
+        cameraSetState(cam, CAMERA_WIFI_JOIN);
+        return;
+    }
     
-    // Disconnect BLE (we'll use WiFi now)
-    Serial.println("\n[BLE] Disconnecting BLE...");
-    pClient->disconnect();
-    delay(1000);
+    wifiJoinStatus = WiFi.status();
+    traceEnd(TRACE_WIFI_JOIN, false);
+    LOG_ERROR(WIFI, "ERROR: Connection failed");
+    loseCamera(cam);
+}
+
+// Report a camera whose link dropped
+void reportLinkLost(GoProCamera& cam) {
+    LOG_INFO(APP, "\n========================================");
+    LOG_INFO(RECONNECT, "%s %s disconnected!", goProAddressText(cam.address).c_str(),
+             cam.bleLink ? "BLE" : "WiFi");
+    LOG_INFO(APP, "GoPro may have powered off or restarted");
+    LOG_INFO(APP, "========================================");
+}
+
+// CAMERA_DRIFT: read how far the camera drifted since its last sync, then
+// set it. The drift model only loses a sample if the reads fail.
+void stepDrift(GoProCamera& cam) {
+    if (!linkUp(cam)) {
+        reportLinkLost(cam);
+        loseCamera(cam);
+        return;
+    }
     
-    // Connect to GoPro WiFi
-    if (!connectToGoProWiFi()) {
-        Serial.println("\n[ERROR] Failed to connect to GoPro WiFi");
-        delay(5000);
-        ESP.restart();
+    ClockOffset offset;
+    MeasureStep step = stepMeasure(cam, offset);
+    if (step == MEASURE_WAITING) {
+        return;
+    }
+    if (step == MEASURE_DONE) {
+        driftRecordMeasurement(cam.address, rtc.now().unixtime(), offset);
+    }
+    beginTimeSet(cam);
+}
+
+// CAMERA_ALIGN: spend the wait for the send slot on RTT probes (one per
+// pass), sleep until the slot is close, then send the set. A slot missed
+// while other cameras were served moves to a later second, and so does a
+// failed send (up to SYNC_SEND_RETRIES times) with the second patched anew.
+void stepAlign(GoProCamera& cam) {
+    if (!linkUp(cam)) {
+        reportLinkLost(cam);
+        loseCamera(cam);
         return;
     }
     
-    // Set date/time via HTTP
-    delay(1000); // Give WiFi connection time to stabilize
-    if (setGoProDateTime()) {
-        Serial.println("\n[SUCCESS] Date/time synchronized!");
-        beep();  // Confirmation beep
-    } else {
-        Serial.println("\n[WARNING] Failed to set date/time via HTTP");
-        Serial.println("The WiFi AP is still available for manual control.");
+    if ((int32_t)(setSendAtUs(cam) - micros()) < 0) {
+        planTimeSet(cam);
+    }
+    uint32_t sendAtUs = setSendAtUs(cam);
+    if ((int32_t)(sendAtUs - micros()) >= LINK_PROBE_SLOT_US && cam.probes < LINK_MAX_PROBES &&
+        !setDueBefore(micros() + EXCHANGE_GUARD_MS * 1000, cam)) {
+        LinkTransport transport = cam.bleLink ? LINK_BLE : LINK_HTTP;
+        cam.probes = probeLink(cam, transport) ? cam.probes + 1 : LINK_MAX_PROBES;
+        return;
+    }
+    // Reopen an HTTP session the camera closed now rather than in the slot;
+    // if that takes the slot, the next pass plans a later second
+    if (!cam.bleLink && !goProHttpConnected() && goProHttpOpen()) {
+        return;
+    }
+    if (!reachSendSlot(cam, sendAtUs)) {
+        return;
+    }
+    traceRecord(TRACE_ALIGN, cam.stateSinceUs, true);
+    
+    bool wasBLE = cam.bleLink;
+    if (setGoProTime(cam)) {
+        if (SYNC_VERIFY) {
+            beginMeasure(cam, CAMERA_VERIFY);
+        } else {
+            finishSync(cam, true);
+        }
+        return;
     }
     
-    Serial.println("\n==================================");
-    Serial.println("Setup complete!");
-    Serial.println("==================================\n");
+    if (wasBLE && !cam.bleLink) {
+        startWiFiHandover(cam);
+    } else if (!linkUp(cam)) {
+        loseCamera(cam);
+    } else if (cam.sendFailures < SYNC_SEND_RETRIES) {
+        cam.sendFailures++;
+        LOG_INFO(SYNC, "Set failed, sending again on a later second (%u of %u)",
+                 (unsigned)cam.sendFailures, (unsigned)SYNC_SEND_RETRIES);
+        planTimeSet(cam);
+    } else {
+        finishSync(cam, false);
+    }
 }
 
-// Full reconnection routine (BLE + WiFi)
-bool reconnectToGoPro() {
-    Serial.println("\n[RECONNECT] Starting full reconnection routine...");
+// CAMERA_VERIFY: read the clock back, and set it again while it is provably
+// off by more than SYNC_VERIFY_MAX_OFFSET_MS. Each verification is logged
+// per camera; the accepted one anchors the drift model. A camera parked for
+// another camera's set is reconnected first, and its reads start over.
+void stepVerify(GoProCamera& cam) {
+    if (cam.parked) {
+        if (scanInTheWay() || setDueBefore(micros() + CONNECT_GUARD_MS * 1000, cam)) {
+            return;
+        }
+        if (cameraLinks() >= CAMERA_MAX_LINKS && !parkOneCamera(false)) {
+            return;
+        }
+        cam.parked = false;
+        if (!connectToGoPro(cam)) {
+            LOG_ERROR(BLE, "ERROR: Failed to connect to GoPro via BLE");
+            loseCamera(cam);
+            return;
+        }
+        beginMeasure(cam, CAMERA_VERIFY);
+        return;
+    }
     
-    // Disconnect everything first
-    WiFi.disconnect();
-    if (pClient && pClient->isConnected()) {
-        pClient->disconnect();
+    if (!linkUp(cam)) {
+        reportLinkLost(cam);
+        loseCamera(cam);
+        return;
     }
-    delay(2000);
     
-    // Step 1: Scan for GoPro
-    Serial.println("[RECONNECT] Scanning for GoPro...");
-    NimBLEAddress* pGoProAddress = scanForGoPro();
-    if (pGoProAddress == nullptr) {
-        Serial.println("[RECONNECT] GoPro not found (may be powered off)");
-        return false;
+    ClockOffset offset;
+    MeasureStep step = stepMeasure(cam, offset);
+    if (step == MEASURE_WAITING) {
+        return;
+    }
+    if (step == MEASURE_FAILED) {
+        // An unverified set is not a sync: read again, then retry the sync
+        if (cam.verifyFailures < SYNC_VERIFY_READ_RETRIES) {
+            cam.verifyFailures++;
+            LOG_INFO(VERIFY, "Could not read the camera clock back, reading again (%u of %u)",
+                     (unsigned)cam.verifyFailures, (unsigned)SYNC_VERIFY_READ_RETRIES);
+            beginMeasure(cam, CAMERA_VERIFY);
+            return;
+        }
+        LOG_WARN(VERIFY, "WARNING: Could not read the camera clock back, set left unverified");
+        finishSync(cam, false);
+        return;
     }
     
-    // Step 2: Connect via BLE
-    Serial.println("[RECONNECT] Connecting via BLE...");
-    if (!connectToGoPro(pGoProAddress)) {
-        Serial.println("[RECONNECT] BLE connection failed");
-        return false;
+    uint32_t now = rtc.now().unixtime();
+    syncLogAppend(cam.address, cam.bleLink ? LINK_BLE : LINK_HTTP, cam.sets, now, offset);
+    
+    const int64_t limitUs = (int64_t)SYNC_VERIFY_MAX_OFFSET_MS * 1000;
+    bool tooFar = llabs(offset.offsetUs) - (int64_t)offset.uncertaintyUs > limitUs;
+    if (!tooFar || cam.sets > SYNC_VERIFY_RESETS) {
+        if (tooFar) {
+            LOG_WARN(VERIFY, "WARNING: Camera clock still off after re-setting it");
+        }
+        driftRecordSet(cam.address, now, offset);
+        finishSync(cam, true);
+        return;
     }
     
-    // Step 3: Read WiFi credentials (in case they changed)
-    if (!getWiFiSSID() || !getWiFiPassword()) {
-        Serial.println("[RECONNECT] Failed to get WiFi credentials");
-        pClient->disconnect();
-        return false;
+    LOG_INFO(VERIFY, "Offset over the limit, setting the time again");
+    beginTimeSet(cam);
+}
+
+// CAMERA_SYNCED: watch the link, and re-sync when the drift model says the
+// camera may be approaching the tolerance (hourly until it has a verified
+// offset). Parked cameras are reconnected first.
+void stepSynced(GoProCamera& cam) {
+    if (!cam.parked && !linkUp(cam)) {
+        reportLinkLost(cam);
+        loseCamera(cam);
+        return;
+    }
+    if (millis() - cam.lastSyncMs <= cam.syncIntervalMs) {
+        return;
     }
     
-    // Step 4: Enable WiFi AP
-    if (!enableWiFiAP()) {
-        Serial.println("[RECONNECT] Failed to enable WiFi AP");
-        pClient->disconnect();
+    LOG_INFO(SYNC, "\n%s: performing periodic time sync...", goProAddressText(cam.address).c_str());
+    cam.resync = true;
+    if (cam.parked) {
+        cam.parked = false;
+        cameraSetState(cam, CAMERA_FOUND);
+        return;
+    }
+    startSync(cam);
+}
+
+// A GoPro that is not paired yet is taken in pairing mode; before the first
+// pairing, also one without Open GoPro advertisement data to tell
+bool pairableCamera(const GoProAdvert& advert) {
+    if (advert.schema == 0) {
+        return pairedCameraCount() == 0;
+    }
+    return (advert.status & GOPRO_ADVERT_PAIRING) != 0;
+}
+
+// Advertised-device callback (runs on the NimBLE host task for every
+// advertiser in range): our GoPros are matched on the spot and queued for
+// the engine, everything else (other rigs' GoPros too) is dropped without
+// being stored
+class GoProScanCallbacks : public NimBLEAdvertisedDeviceCallbacks {
+    void onResult(NimBLEAdvertisedDevice* advertisedDevice) {
+        if (!goProIsAdvertisement(advertisedDevice)) {
+            return;
+        }
+        GoProAdvert advert;
+        goProAdvertParse(advertisedDevice->getPayload(), advertisedDevice->getPayloadLength(), advert);
+        if (!pairedCameraKnown(advertisedDevice->getAddress()) && !pairableCamera(advert)) {
+            return;
+        }
+        size_t nameLength;
+        const char* name = goProAdvertName(advertisedDevice->getPayload(),
+                                           advertisedDevice->getPayloadLength(), nameLength);
+        portENTER_CRITICAL(&sightingLock);
+        if (sightingCount < CAMERA_MAX) {
+            ScanSighting& sighting = sightings[sightingCount++];
+            sighting.address = advertisedDevice->getAddress();
+            snprintf(sighting.name, sizeof(sighting.name), "%.*s", (int)nameLength, name != nullptr ? name : "");
+            sighting.advert = advert;
+        }
+        portEXIT_CRITICAL(&sightingLock);
+        xEventGroupSetBits(engineEvents, ENGINE_WAKE_BIT);
+    }
+};
+
+// Scan completion (runs on the NimBLE host task)
+void onScanComplete(NimBLEScanResults results) {
+    (void)results;
+    xEventGroupSetBits(engineEvents, ENGINE_SCAN_DONE_BIT | ENGINE_WAKE_BIT);
+}
+
+// Every camera in the table is paired, so the controller whitelist covers the rig
+bool rigWhitelisted() {
+    if (cameraCount() == 0) {
         return false;
     }
+    for (uint8_t i = 0; i < cameraCount(); i++) {
+        if (!pairedCameraKnown(cameraAt(i).address)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Start a background scan for GoPro devices; takeSightings() handles each
+// camera as it is seen and finishScan() the end of the scan. The presence
+// scan is passive (no scan requests, so no scan response either) and runs
+// at a quarter duty cycle, in rounds started back to back. A round ends
+// SCAN_TIME_SECONDS after it started if it saw nothing, else like any other
+// scan (see takeSightings), so a rig powering up is caught by one round.
+// Scans for the rig use the whitelist filter policy once it is all paired;
+// the discovery scan hears every advertiser, for cameras in pairing mode.
+void startScan(ScanMode mode) {
+    bool presence = mode == SCAN_PRESENCE;
+    if (presence) {
+        LOG_INFO(BLE, "Watching for missing GoPros (passive scan)...");
+    } else {
+        LOG_INFO(BLE, "Scanning for GoPro devices...");
+    }
+    scanStartUs = micros();
+    scanMode = mode;
+    scanEscalate = false;
+    scanStopped = false;
+    scanSightings = 0;
+    memset(scanSeen, 0, sizeof(scanSeen));
+    portENTER_CRITICAL(&sightingLock);
+    sightingCount = 0;
+    portEXIT_CRITICAL(&sightingLock);
     
-    // Step 5: Wait for AP to be ready
-    if (!waitForAPMode()) {
-        Serial.println("[RECONNECT] WiFi AP did not become ready");
-        pClient->disconnect();
+    NimBLEScan* pScan = NimBLEDevice::getScan();
+    pScan->setActiveScan(!presence);
+    pScan->setInterval(presence ? PRESENCE_SCAN_INTERVAL_MS : 100);
+    pScan->setWindow(presence ? PRESENCE_SCAN_WINDOW_MS : 99);
+    bool whiteList = mode != SCAN_DISCOVERY && rigWhitelisted();
+    pScan->setFilterPolicy(whiteList ? BLE_HCI_SCAN_FILT_USE_WL : BLE_HCI_SCAN_FILT_NO_WL);
+    
+    xEventGroupClearBits(engineEvents, ENGINE_SCAN_DONE_BIT);
+    scanning = pScan->start(presence ? 0 : SCAN_TIME_SECONDS, onScanComplete, false);
+    if (!scanning) {
+        LOG_ERROR(BLE, "ERROR: Failed to start scan");
+        traceRecord(TRACE_SCAN, scanStartUs, false);
+    }
+}
+
+// What a camera's advertisement says about it
+void printAdvert(const GoProAdvert& advert) {
+    if (advert.schema == 0) {
+        return;
+    }
+    const uint8_t* id = advert.idHash;
+    LOG_INFO(BLE, "  Camera ID %02x%02x%02x%02x%02x%02x (model 0x%02x): %s, WiFi AP %s",
+             id[0], id[1], id[2], id[3], id[4], id[5], advert.cameraId,
+             (advert.status & GOPRO_ADVERT_PROCESSOR_ON) ? "awake" : "asleep",
+             (advert.status & GOPRO_ADVERT_WIFI_AP_ON) ? "on" : "off");
+}
+
+// Camera on the HTTP sync path with cached WiFi credentials (loaded)
+bool httpJoinCandidate(GoProCamera& cam) {
+    if (SYNC_OVER_BLE && !cam.bleTimeRejected) {
         return false;
     }
-    
-    Serial.println("[RECONNECT] GoPro WiFi AP is ready!");
-    
-    // Step 6: Disconnect BLE
-    pClient->disconnect();
-    delay(1000);
-    
-    // Step 7: Connect to GoPro WiFi
-    if (!connectToGoProWiFi()) {
-        Serial.println("[RECONNECT] Failed to connect to GoPro WiFi");
+    return credentialCacheLoad(cam.address, cam.ssid, cam.password);
+}
+
+// HTTP sync path for a camera that advertises its AP as already on: with
+// its credentials cached, the station joins straight away and no BLE
+// connection is made (a rejected password still goes back to BLE)
+bool joinWithoutBLE(GoProCamera& cam) {
+    if (!(cam.advert.status & GOPRO_ADVERT_WIFI_AP_ON) || !httpJoinCandidate(cam)) {
         return false;
     }
-    
-    Serial.println("[RECONNECT] Successfully reconnected!");
+    LOG_INFO(BLE, "WiFi AP already on, joining %s without a BLE connection", cam.ssid.c_str());
+    cam.credentialsRead = false;
+    cam.bleLink = false;
+    cameraSetState(cam, CAMERA_WAIT_WIFI);
     return true;
 }
 
-void loop() {
-    static bool wasConnected = true;
-    static unsigned long lastReconnectAttempt = 0;
-    static unsigned long lastSync = 0;
+// Take the GoPros the scan callback has matched. Every GoPro seen gets a
+// camera table entry, and cameras that were absent are marked found right
+// away. The scan is stopped once no camera it is for (absent, or parked and
+// not seen yet) is still missing - for a scan looking for new cameras, only
+// SCAN_LINGER_MS after the first GoPro, so the rest of a rig powering up
+// together is caught by the same scan. The presence scan stops at its first
+// GoPro, for an active follow-up scan if any camera is still missing.
+void takeSightings() {
+    ScanSighting taken[CAMERA_MAX];
+    uint8_t count;
+    portENTER_CRITICAL(&sightingLock);
+    count = sightingCount;
+    for (uint8_t i = 0; i < count; i++) {
+        taken[i] = sightings[i];
+    }
+    sightingCount = 0;
+    portEXIT_CRITICAL(&sightingLock);
+    
+    for (uint8_t i = 0; i < count; i++) {
+        GoProCamera* cam = cameraAdd(taken[i].address);
+        if (cam == nullptr) {
+            LOG_INFO(BLE, "Camera table full, ignoring %s", taken[i].name);
+            continue;
+        }
+        scanSeen[cameraIndex(*cam)] = true;
+        // Only cameras the scan is for (missing or new ones) count as
+        // sightings; cameras on a link or parked advertise all the time
+        if ((cam->state == CAMERA_ABSENT || scanMode == SCAN_DISCOVERY) && scanSightings++ == 0) {
+            firstSightingMs = millis();
+        }
+        if (taken[i].advert.schema != 0) {
+            cam->advert = taken[i].advert;
+        }
+        if (cam->state == CAMERA_ABSENT && taken[i].advert.schema == 0 && httpJoinCandidate(*cam)) {
+            // Whether its AP is up is in the scan response: the follow-up
+            // scan looks again, actively
+            continue;
+        }
+        if (cam->state == CAMERA_ABSENT) {
+            LOG_INFO(BLE, "Found GoPro: %s (%s) after %lu ms",
+                    taken[i].name,
+                    goProAddressText(taken[i].address).c_str(),
+                    (unsigned long)((micros() - scanStartUs) / 1000));
+            printAdvert(taken[i].advert);
+            cam->attemptStartUs = scanStartUs;
+            cam->attemptActive = true;
+            if (!joinWithoutBLE(*cam)) {
+                cameraSetState(*cam, CAMERA_FOUND);
+            }
+        }
+    }
     
-    // Check WiFi connection status
-    bool isConnected = (WiFi.status() == WL_CONNECTED);
+    if (!scanning || scanStopped) {
+        return;
+    }
+    if (scanSightings == 0) {
+        // A presence scan round that saw nothing ends here; the next one
+        // starts right away
+        if (scanMode == SCAN_PRESENCE && micros() - scanStartUs >= SCAN_TIME_SECONDS * 1000000UL) {
+            scanStopped = true;
+            NimBLEDevice::getScan()->stop();
+        }
+        return;
+    }
+    bool waiting = false;
+    for (uint8_t i = 0; i < cameraCount(); i++) {
+        GoProCamera& cam = cameraAt(i);
+        waiting |= cam.state == CAMERA_ABSENT || (cam.parked && !scanSeen[i]);
+    }
+    // The rest of a rig is collected by an active scan, which catches
+    // advertisements several times faster
+    if (scanMode == SCAN_PRESENCE && waiting) {
+        scanEscalate = true;
+    }
+    bool lingered = millis() - firstSightingMs >= SCAN_LINGER_MS;
+    if ((!waiting && scanMode != SCAN_DISCOVERY) || lingered || scanEscalate) {
+        LOG_INFO(BLE, "Stopping scan after %lu ms", (unsigned long)((micros() - scanStartUs) / 1000));
+        scanStopped = true;
+        NimBLEDevice::getScan()->stop();
+    }
+}
+
+// End of a scan. A parked camera has no link to lose, so one that scans
+// totalling SCAN_TIME_SECONDS have not seen is taken to have powered off
+// (however often they were cut short); it gets a fresh sync when it shows
+// up again. Returns the number of GoPros seen.
+uint8_t finishScan() {
+    takeSightings();
+    scanning = false;
+    
+    uint32_t scanMs = (micros() - scanStartUs) / 1000;
+    for (uint8_t i = 0; i < cameraCount(); i++) {
+        GoProCamera& cam = cameraAt(i);
+        if (!cam.parked || scanSeen[i]) {
+            cam.unseenScanMs = 0;
+            continue;
+        }
+        cam.unseenScanMs += scanMs;
+        if (cam.unseenScanMs >= SCAN_TIME_SECONDS * 1000UL) {
+            LOG_INFO(CAM, "%s: parked camera stopped advertising", goProAddressText(cam.address).c_str());
+            loseCamera(cam);
+        }
+    }
     
-    // Detect WiFi disconnect (GoPro powered off)
-    if (wasConnected && !isConnected) {
-        Serial.println("\n========================================");
-        Serial.println("[ALERT] WiFi disconnected!");
-        Serial.println("GoPro may have powered off or restarted");
-        Serial.println("========================================");
-        wasConnected = false;
+    traceRecord(TRACE_SCAN, scanStartUs, scanSightings > 0);
+    if (scanSightings == 0) {
+        LOG_INFO(BLE, "No GoPro devices found");
+    }
+    return scanSightings;
+}
+
+// One pass of the camera engine: scan in the background while a camera is
+// missing (and now and then for cameras joining the rig), then step every
+// camera that is awake. Steps return as soon as they would have to wait.
+// Verification waits while another camera could connect for its set: a
+// rig is set first, verified after.
+void runEngine() {
+    if (scanning) {
+        takeSightings();
+    }
+    if (xEventGroupGetBits(engineEvents) & ENGINE_SCAN_DONE_BIT) {
+        xEventGroupClearBits(engineEvents, ENGINE_SCAN_DONE_BIT);
+        if (finishScan() == 0 && cameraCount() == 0) {
+            LOG_ERROR(BLE, "\nERROR: No GoPro found. Please ensure:");
+            LOG_ERROR(APP, "  1. GoPro is powered on");
+            LOG_ERROR(APP, "  2. GoPro Bluetooth is enabled");
+            LOG_ERROR(APP, "  3. GoPro is in pairing mode");
+            LOG_INFO(APP, "\nWatching for it with a background scan...");
+        }
+        lastScanMs = millis();
     }
     
-    // If disconnected, try full reconnection every 5 seconds
-    if (!isConnected && (millis() - lastReconnectAttempt > 5000)) {
-        lastReconnectAttempt = millis();
-        
-        if (reconnectToGoPro()) {
-            wasConnected = true;
-            
-            // Sync time immediately after reconnection
-            Serial.println("\n[SYNC] Synchronizing time after reconnection...");
-            if (setGoProDateTime()) {
-                Serial.println("[SUCCESS] Time synchronized!");
-                beep();  // Confirmation beep
-                lastSync = millis();
-            } else {
-                Serial.println("[WARNING] Time sync failed, but connection is established");
+    // Scans hold back while a camera waits to connect (except the follow-up
+    // of a presence scan); the presence scan watches for as long as a camera
+    // is missing (retried after CAMERA_RETRY_MS if it would not start)
+    bool missing = cameraCount() == 0;
+    for (uint8_t i = 0; i < cameraCount(); i++) {
+        missing |= cameraAt(i).state == CAMERA_ABSENT;
+    }
+    unsigned long sinceScanMs = millis() - lastScanMs;
+    bool discover = !scanned || (cameraCount() < CAMERA_MAX && sinceScanMs > CAMERA_DISCOVERY_INTERVAL_MS);
+    if (!scanning && (scanEscalate || !connectPending()) && (!scanStartFailed || sinceScanMs > CAMERA_RETRY_MS)) {
+        if (discover || scanEscalate || missing) {
+            scanned = true;
+            startScan(discover ? SCAN_DISCOVERY : scanEscalate ? SCAN_FOLLOW_UP : SCAN_PRESENCE);
+            scanStartFailed = !scanning;
+            if (!scanning) {
+                lastScanMs = millis();
             }
-        } else {
-            Serial.println("\n[INFO] Reconnection failed, will retry in 5 seconds...");
         }
     }
     
-    // If connected, perform periodic time sync every hour
-    if (isConnected && (millis() - lastSync > 3600000)) { // 1 hour
-        Serial.println("\n[INFO] Performing periodic time sync...");
-        if (setGoProDateTime()) {
-            Serial.println("[SUCCESS] Periodic time sync complete!");
-            beep();  // Confirmation beep
-            lastSync = millis();
-        } else {
-            Serial.println("[WARNING] Periodic time sync failed");
+    for (uint8_t i = 0; i < cameraCount(); i++) {
+        GoProCamera& cam = cameraAt(i);
+        if (!cameraAwake(cam)) {
+            continue;
+        }
+        switch (cam.state) {
+            case CAMERA_FOUND: stepFound(cam); break;
+            case CAMERA_WAIT_AP: stepWaitAP(cam); break;
+            case CAMERA_WAIT_WIFI: stepWaitWiFi(cam); break;
+            case CAMERA_WIFI_JOIN: stepWiFiJoin(cam); break;
+            case CAMERA_DRIFT: stepDrift(cam); break;
+            case CAMERA_ALIGN: stepAlign(cam); break;
+            case CAMERA_VERIFY:
+                if (!setPending()) {
+                    stepVerify(cam);
+                }
+                break;
+            case CAMERA_SYNCED: stepSynced(cam); break;
+            default: break;
         }
     }
-    
-    delay(1000);
 }
 
+void setup() {
+    Serial.begin(115200);
+    logBegin();
+    delay(1000);
+    
+    LOG_INFO(APP, "\n\n==================================");
+    LOG_INFO(APP, "ESP32 GoPro Time Sync");
+    LOG_INFO(APP, "==================================\n");
+    
+    // Initialize buzzer pin
+    pinMode(BUZZER_PIN, OUTPUT);
+    digitalWrite(BUZZER_PIN, LOW);
+    LOG_INFO(BUZZER, "Initialized on GPIO %d", BUZZER_PIN);
+    
+    // Initialize I2C for DS3231 RTC
+    LOG_INFO(RTC, "Initializing DS3231 RTC...");
+    Wire.begin();
+    
+    if (!rtc.begin()) {
+        LOG_ERROR(RTC, "ERROR: Couldn't find DS3231 RTC!");
+        LOG_ERROR(RTC, "Please check I2C connections (SDA=21, SCL=22)");
+        LOG_ERROR(APP, "Restarting in 5 seconds...");
+        delay(5000);
+        ESP.restart();
+        return;
+    }
+    
+    if (rtc.lostPower()) {
+        LOG_WARN(RTC, "WARNING: RTC lost power, time may be incorrect!");
+    }
+    
+    // 1 Hz SQW edges time the set-time request to the RTC second
+    rtcEdgeBegin(rtc);
+    
+    if (!credentialCacheEncrypted()) {
+        LOG_WARN(NVS, "WARNING: NVS encryption is off, cached WiFi credentials are not encrypted");
+    }
+    
+    // Display current RTC time
+    DateTime now = rtc.now();
+    LOG_INFO(RTC, "Current time: %04d-%02d-%02d %02d:%02d:%02d",
+             now.year(), now.month(), now.day(),
+             now.hour(), now.minute(), now.second());
+    
+    // WiFi join, AP readiness and scans are event driven (see stepWiFiJoin,
+    // stepWaitAP, finishScan); the callbacks wake loop()
+    engineEvents = xEventGroupCreate();
+    wifiEvents = xEventGroupCreate();
+    apEvents = xEventGroupCreate();
+    WiFi.onEvent(onWiFiEvent);
+    
+    // Initialize BLE
+    LOG_INFO(BLE, "Initializing BLE...");
+    NimBLEDevice::init("ESP32-GoPro");
+    NimBLEDevice::setPower(ESP_PWR_LVL_P9);
+    
+    // Advertisements are matched as they arrive; the scan keeps none of them,
+    // and the controller reports each advertiser once per scan
+    NimBLEScan* pScan = NimBLEDevice::getScan();
+    pScan->setAdvertisedDeviceCallbacks(new GoProScanCallbacks(), false);
+    pScan->setMaxResults(0);
+    pScan->setDuplicateFilter(true);
+    
+    // Paired cameras go on the controller whitelist, for the rig's scans
+    pairedCamerasBegin();
+    LOG_INFO(BLE, "%u paired camera(s)", pairedCameraCount());
+    
+    // Cameras are found, connected and synced by the engine in loop()
+    LOG_INFO(APP, "\n==================================");
+    LOG_INFO(APP, "Setup complete!");
+    LOG_INFO(APP, "==================================\n");
+}
 
+// Serial diagnostics commands (single characters, see trace.h, link_latency.h,
+// clock_verify.h, drift_model.h, camera_table.h, paired_cameras.h and memory_watch.h)
+void handleSerialCommands() {
+    while (Serial.available() > 0) {
+        int command = Serial.read();
+        switch (command) {
+            case 't': traceDumpStats(); break;
+            case 'e': traceDumpEvents(); break;
+            case 'l': linkLatencyDump(); break;
+            case 'v': syncLogDump(); break;
+            case 'd': {
+                NimBLEAddress addresses[CAMERA_MAX];
+                for (uint8_t i = 0; i < cameraCount(); i++) {
+                    addresses[i] = cameraAt(i).address;
+                }
+                driftModelDump(addresses, cameraCount());
+                break;
+            }
+            case 'c': cameraTableDump(); break;
+            case 'p': pairedCamerasDump(); break;
+            case 'm': memoryWatchDump(); break;
+            case 'f':
+                // The whitelist cannot change under a scan; runEngine starts the next one
+                if (scanning && !scanStopped) {
+                    scanStopped = true;
+                    NimBLEDevice::getScan()->stop();
+                }
+                pairedCamerasForget();
+                LOG_INFO(BLE, "Forgot every paired camera; new ones pair in pairing mode");
+                break;
+            default: break;
+        }
+    }
+}
 
+void loop() {
+    handleSerialCommands();
+    runEngine();
+    updateBuzzer();
+    memoryWatchPoll();
+    
+    // Sleep until a callback has news for the engine, or the next tick
+    xEventGroupWaitBits(engineEvents, ENGINE_WAKE_BIT, pdTRUE, pdFALSE, pdMS_TO_TICKS(ENGINE_TICK_MS));
+}
@@ -0,0 +1,138 @@
+#include "memory_watch.h"
+#include "serial_log.h"
+
+#include <Arduino.h>
+
+static MemorySample samples[MEMORY_WINDOW];
+static uint8_t sampleCount = 0;
+static uint8_t nextSample = 0;
+
+// Free heap at the last MEMORY_TREND_CYCLES cycle ends, oldest first once full
+static uint32_t trendFree[MEMORY_TREND_CYCLES];
+static uint8_t trendCount = 0;
+static uint8_t nextTrend = 0;
+
+static uint32_t cycles = 0;
+static uint32_t alarms = 0;
+static uint32_t cyclesSinceAlarm = MEMORY_TREND_CYCLES;
+static int32_t slopeBytes = 0;
+static uint32_t lastPollMs = 0;
+
+static uint32_t minStackFree[MEMORY_TASK_COUNT] = {};
+static bool stackWarned[MEMORY_TASK_COUNT] = {};
+
+static const char* const TASK_NAMES[MEMORY_TASK_COUNT] = {"loopTask", "log", "nimble_host"};
+static TaskHandle_t taskHandles[MEMORY_TASK_COUNT] = {};
+
+const char* memoryTaskName(MemoryTask task) {
+    return task < MEMORY_TASK_COUNT ? TASK_NAMES[task] : "?";
+}
+
+static void takeSample(bool cycleEnd) {
+    MemorySample& s = samples[nextSample];
+    nextSample = (nextSample + 1) % MEMORY_WINDOW;
+    if (sampleCount < MEMORY_WINDOW) {
+        sampleCount++;
+    }
+
+    s.cycle = cycles;
+    s.uptimeMs = millis();
+    s.freeHeap = ESP.getFreeHeap();
+    s.largestBlock = ESP.getMaxAllocHeap();
+    s.minFreeHeap = ESP.getMinFreeHeap();
+    s.cycleEnd = cycleEnd;
+
+    // ESP-IDF reports stack high-water marks in bytes
+    for (uint8_t i = 0; i < MEMORY_TASK_COUNT; i++) {
+        if (taskHandles[i] == nullptr) {
+            taskHandles[i] = xTaskGetHandle(TASK_NAMES[i]);
+        }
+        s.stackFree[i] = taskHandles[i] != nullptr ? uxTaskGetStackHighWaterMark(taskHandles[i]) : 0;
+        if (s.stackFree[i] == 0) {
+            continue;
+        }
+        if (minStackFree[i] == 0 || s.stackFree[i] < minStackFree[i]) {
+            minStackFree[i] = s.stackFree[i];
+        }
+        if (s.stackFree[i] < MEMORY_STACK_LOW_BYTES && !stackWarned[i]) {
+            stackWarned[i] = true;
+            LOG_WARN(MEM, "WARNING: %s stack down to %u free bytes", TASK_NAMES[i], (unsigned)s.stackFree[i]);
+        }
+    }
+    lastPollMs = s.uptimeMs;
+}
+
+// Least-squares slope of the free heap over the trend window, per cycle.
+// x runs over -(n-1), -(n-3), ..., n-1 (twice the offset from the middle),
+// so the sums stay integers and sum(x) is 0.
+static int32_t trendSlope() {
+    int64_t sumXY = 0;
+    int64_t sumXX = 0;
+    for (uint8_t i = 0; i < MEMORY_TREND_CYCLES; i++) {
+        int32_t x = 2 * i - (MEMORY_TREND_CYCLES - 1);
+        uint32_t y = trendFree[(nextTrend + i) % MEMORY_TREND_CYCLES];
+        sumXY += (int64_t)x * y;
+        sumXX += (int64_t)x * x;
+    }
+    return (int32_t)(2 * sumXY / sumXX);
+}
+
+void memoryWatchCycle() {
+    cycles++;
+    takeSample(true);
+    const MemorySample& s = samples[(nextSample + MEMORY_WINDOW - 1) % MEMORY_WINDOW];
+    LOG_INFO(MEM, "cycle %u: heap free %u, largest block %u, min ever %u; stack free loop %u, log %u, nimble %u",
+             (unsigned)s.cycle, (unsigned)s.freeHeap, (unsigned)s.largestBlock, (unsigned)s.minFreeHeap,
+             (unsigned)s.stackFree[MEMORY_TASK_LOOP], (unsigned)s.stackFree[MEMORY_TASK_LOG],
+             (unsigned)s.stackFree[MEMORY_TASK_NIMBLE]);
+
+    trendFree[nextTrend] = s.freeHeap;
+    nextTrend = (nextTrend + 1) % MEMORY_TREND_CYCLES;
+    if (trendCount < MEMORY_TREND_CYCLES) {
+        trendCount++;
+    }
+    if (trendCount < MEMORY_TREND_CYCLES) {
+        return;
+    }
+
+    // One alarm per trend window, so a steady leak is not reported every cycle
+    slopeBytes = trendSlope();
+    cyclesSinceAlarm++;
+    if (slopeBytes < -MEMORY_LEAK_BYTES_PER_CYCLE && cyclesSinceAlarm >= MEMORY_TREND_CYCLES) {
+        alarms++;
+        cyclesSinceAlarm = 0;
+        LOG_WARN(MEM, "WARNING: free heap falling %d bytes per sync over the last %u syncs (now %u, largest block %u)",
+                 (int)-slopeBytes, (unsigned)MEMORY_TREND_CYCLES, (unsigned)s.freeHeap,
+                 (unsigned)s.largestBlock);
+    }
+}
+
+void memoryWatchPoll() {
+    if (millis() - lastPollMs >= MEMORY_SAMPLE_INTERVAL_MS) {
+        takeSample(false);
+    }
+}
+
+void memoryWatchStatus(MemoryStatus& status) {
+    status.cycles = cycles;
+    status.alarms = alarms;
+    status.slopeBytes = slopeBytes;
+    status.minFreeHeap = ESP.getMinFreeHeap();
+    for (uint8_t i = 0; i < MEMORY_TASK_COUNT; i++) {
+        status.minStackFree[i] = minStackFree[i];
+    }
+}
+
+void memoryWatchDump() {
+    Serial.println("#memory,cycle,uptime_ms,kind,free,largest_block,min_free,stack_loop,stack_log,stack_nimble");
+    for (uint8_t n = 0; n < sampleCount; n++) {
+        const MemorySample& s = samples[(nextSample + MEMORY_WINDOW - sampleCount + n) % MEMORY_WINDOW];
+        Serial.printf("memory,%u,%u,%s,%u,%u,%u,%u,%u,%u\n", (unsigned)s.cycle, (unsigned)s.uptimeMs,
+                      s.cycleEnd ? "cycle" : "periodic", (unsigned)s.freeHeap, (unsigned)s.largestBlock,
+                      (unsigned)s.minFreeHeap, (unsigned)s.stackFree[MEMORY_TASK_LOOP],
+                      (unsigned)s.stackFree[MEMORY_TASK_LOG], (unsigned)s.stackFree[MEMORY_TASK_NIMBLE]);
+    }
+    Serial.println("#memory_trend,cycles,window,slope_bytes_per_cycle,alarms");
+    Serial.printf("memory_trend,%u,%u,%d,%u\n", (unsigned)cycles, (unsigned)trendCount, (int)slopeBytes,
+                  (unsigned)alarms);
+}
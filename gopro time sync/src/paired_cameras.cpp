@@ -0,0 +1,136 @@
+#include "paired_cameras.h"
+#include "gopro_ble.h"
+#include "serial_log.h"
+
+#include <Arduino.h>
+#include <Preferences.h>
+
+#define PAIRED_NAMESPACE "paired"
+#define PAIRED_KEY "cameras"
+#define PAIRED_VERSION 1
+
+// Address as NimBLE stores it (least significant byte first), so the scan
+// callback compares raw bytes
+struct PairedCamera {
+    uint8_t address[6];
+    uint8_t addressType;
+    uint8_t idHash[GOPRO_ADVERT_ID_HASH_LENGTH];
+};
+
+// Stored record; bump PAIRED_VERSION if the layout changes
+struct PairedRecord {
+    uint8_t version;
+    uint8_t count;
+    PairedCamera cameras[PAIRED_CAMERA_MAX];
+};
+
+// The list in RAM; the scan callback reads it, the engine changes it
+static portMUX_TYPE pairedLock = portMUX_INITIALIZER_UNLOCKED;
+static PairedRecord paired = {PAIRED_VERSION, 0, {}};
+
+static bool storeList() {
+    Preferences prefs;
+    if (!prefs.begin(PAIRED_NAMESPACE, false)) {
+        return false;
+    }
+    bool stored = prefs.putBytes(PAIRED_KEY, &paired, sizeof(paired)) == sizeof(paired);
+    prefs.end();
+    return stored;
+}
+
+static NimBLEAddress entryAddress(const PairedCamera& entry) {
+    ble_addr_t address;
+    address.type = entry.addressType;
+    memcpy(address.val, entry.address, sizeof(address.val));
+    return NimBLEAddress(address);
+}
+
+void pairedCamerasBegin() {
+    PairedRecord record;
+    Preferences prefs;
+    size_t length = 0;
+    if (prefs.begin(PAIRED_NAMESPACE, true)) {
+        length = prefs.getBytes(PAIRED_KEY, &record, sizeof(record));
+        prefs.end();
+    }
+    if (length != sizeof(record) || record.version != PAIRED_VERSION || record.count > PAIRED_CAMERA_MAX) {
+        return;
+    }
+
+    portENTER_CRITICAL(&pairedLock);
+    paired = record;
+    portEXIT_CRITICAL(&pairedLock);
+
+    for (uint8_t i = 0; i < paired.count; i++) {
+        NimBLEAddress address = entryAddress(paired.cameras[i]);
+        if (!NimBLEDevice::whiteListAdd(address)) {
+            LOG_WARN(BLE, "WARNING: could not whitelist paired camera %s", goProAddressText(address).c_str());
+        }
+    }
+}
+
+uint8_t pairedCameraCount() {
+    return paired.count;
+}
+
+bool pairedCameraKnown(const NimBLEAddress& address) {
+    const uint8_t* native = address.getNative();
+    bool known = false;
+    portENTER_CRITICAL(&pairedLock);
+    for (uint8_t i = 0; i < paired.count && !known; i++) {
+        known = memcmp(native, paired.cameras[i].address, sizeof(paired.cameras[i].address)) == 0;
+    }
+    portEXIT_CRITICAL(&pairedLock);
+    return known;
+}
+
+bool pairedCameraAdd(const NimBLEAddress& address, const GoProAdvert& advert) {
+    if (pairedCameraKnown(address)) {
+        return true;
+    }
+    if (paired.count >= PAIRED_CAMERA_MAX || !NimBLEDevice::whiteListAdd(address)) {
+        return false;
+    }
+
+    PairedCamera entry = {};
+    memcpy(entry.address, address.getNative(), sizeof(entry.address));
+    entry.addressType = address.getType();
+    memcpy(entry.idHash, advert.idHash, sizeof(entry.idHash));
+
+    portENTER_CRITICAL(&pairedLock);
+    paired.cameras[paired.count++] = entry;
+    portEXIT_CRITICAL(&pairedLock);
+
+    if (!storeList()) {
+        LOG_WARN(NVS, "WARNING: could not store the paired camera list");
+    }
+    return true;
+}
+
+void pairedCamerasForget() {
+    for (uint8_t i = 0; i < paired.count; i++) {
+        NimBLEDevice::whiteListRemove(entryAddress(paired.cameras[i]));
+    }
+
+    portENTER_CRITICAL(&pairedLock);
+    paired.count = 0;
+    portEXIT_CRITICAL(&pairedLock);
+
+    Preferences prefs;
+    if (prefs.begin(PAIRED_NAMESPACE, false)) {
+        prefs.remove(PAIRED_KEY);
+        prefs.end();
+    }
+}
+
+void pairedCamerasDump() {
+    Serial.println("#paired,address,id,whitelisted");
+    for (uint8_t i = 0; i < paired.count; i++) {
+        const PairedCamera& c = paired.cameras[i];
+        const uint8_t* id = c.idHash;
+        NimBLEAddress address = entryAddress(c);
+        Serial.printf("paired,%s,%02x%02x%02x%02x%02x%02x,%u\n", goProAddressText(address).c_str(),
+                      id[0], id[1], id[2], id[3], id[4], id[5],
+                      (unsigned)NimBLEDevice::onWhiteList(address));
+    }
+}
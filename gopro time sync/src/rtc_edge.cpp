@@ -0,0 +1,53 @@
+#include "rtc_edge.h"
+
+#include <Arduino.h>
+
+// Reads closer than this to an edge are retried: the I2C read and the ISR
+// could disagree about which side of the edge they happened on
+#define EDGE_GUARD_US 2000
+
+static volatile uint32_t lastEdgeUs = 0;
+static volatile uint32_t edgeCount = 0;
+
+static void IRAM_ATTR onSecondEdge() {
+    lastEdgeUs = micros();
+    edgeCount = edgeCount + 1;
+}
+
+void rtcEdgeBegin(RTC_DS3231& rtc) {
+    rtc.writeSqwPinMode(DS3231_SquareWave1Hz);
+    pinMode(RTC_SQW_PIN, INPUT_PULLUP);
+    attachInterrupt(digitalPinToInterrupt(RTC_SQW_PIN), onSecondEdge, FALLING);
+}
+
+bool rtcReadAtEdge(RTC_DS3231& rtc, DateTime& second, uint32_t& edgeUs) {
+    for (;;) {
+        uint32_t count = edgeCount;
+        uint32_t edge = lastEdgeUs;
+        uint32_t sinceEdge = micros() - edge;
+        if (count == 0 || sinceEdge > RTC_EDGE_MAX_AGE_US) {
+            return false;
+        }
+        if (sinceEdge < EDGE_GUARD_US || sinceEdge >= 1000000 - EDGE_GUARD_US) {
+            delayMicroseconds(EDGE_GUARD_US);
+            continue;
+        }
+
+        // No edge may fall between the two snapshots of the counter
+        second = rtc.now();
+        if (edgeCount == count && micros() - edge < 1000000 - EDGE_GUARD_US) {
+            edgeUs = edge;
+            return true;
+        }
+    }
+}
+
+void rtcSleepUntil(uint32_t targetUs) {
+    int32_t remaining = (int32_t)(targetUs - micros());
+    if (remaining > 2000) {
+        delay((remaining - 1000) / 1000);
+    }
+    while ((int32_t)(targetUs - micros()) > 0) {
+        delayMicroseconds(1);
+    }
+}
@@ -0,0 +1,243 @@
+#include "serial_log.h"
+
+#include <algorithm>
+#include <stdio.h>
+
+#define LOG_DRAIN_STACK_BYTES 4096
+#define LOG_FRAME_BYTES (2 + 7 + LOG_MAX_ARGS + LOG_ARG_BYTES + 1)
+
+// Bounded multi-producer ring (one sequence number per slot): slot i is
+// free for the producer holding position p when its sequence equals p,
+// and holds a record for the drain task at position p when it equals p + 1.
+// Reading it hands it back as p + LOG_RING_RECORDS.
+static LogRecord ring[LOG_RING_RECORDS];
+static std::atomic<uint32_t> writePosition(0);
+static uint32_t readPosition = 0;
+static std::atomic<uint32_t> dropped(0);
+static uint32_t droppedReported = 0;
+static bool started = false;      // Set before any other task logs
+
+#define LOG_TAG_PREFIX(name, prefix) prefix,
+static const char* const TAG_PREFIXES[LOG_TAG_COUNT] = {LOG_TAGS(LOG_TAG_PREFIX)};
+#undef LOG_TAG_PREFIX
+
+static void drainTask(void* parameter) {
+    (void)parameter;
+    for (;;) {
+        logDrain();
+        vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_PERIOD_MS));
+    }
+}
+
+void logBegin() {
+    if (started) {
+        return;
+    }
+    for (uint32_t i = 0; i < LOG_RING_RECORDS; i++) {
+        ring[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    started = true;
+    xTaskCreatePinnedToCore(drainTask, "log", LOG_DRAIN_STACK_BYTES, nullptr, LOG_DRAIN_PRIORITY,
+                            nullptr, tskNO_AFFINITY);
+}
+
+LogRecord* logReserve() {
+    if (!started) {
+        return nullptr;
+    }
+    uint32_t position = writePosition.load(std::memory_order_relaxed);
+    for (;;) {
+        LogRecord* record = &ring[position & (LOG_RING_RECORDS - 1)];
+        int32_t lag = (int32_t)(record->sequence.load(std::memory_order_acquire) - position);
+        if (lag == 0) {
+            if (writePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                return record;
+            }
+        } else if (lag < 0) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        } else {
+            position = writePosition.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void logCommit(LogRecord* record) {
+    uint32_t position = record->sequence.load(std::memory_order_relaxed);
+    record->sequence.store(position + 1, std::memory_order_release);
+}
+
+uint32_t logDropped() {
+    return dropped.load(std::memory_order_relaxed);
+}
+
+// Append one conversion, rebuilt around the recorded argument's own type
+// (so "%lu" prints the same whatever width unsigned long has here)
+static size_t formatArg(char* out, size_t room, const char* spec, size_t specLength,
+                        LogArgType type, const uint8_t* data) {
+    char conversion[16];
+    char kind = spec[specLength - 1];
+    size_t prefix = 1;
+    while (prefix < specLength - 1 && strchr("hljztL", spec[prefix]) == nullptr) {
+        prefix++;
+    }
+    if (prefix + 4 > sizeof(conversion)) {
+        return 0;
+    }
+    memcpy(conversion, spec, prefix);
+    size_t n = prefix;
+
+    int written = 0;
+    switch (type) {
+        case LOG_ARG_INT32:
+        case LOG_ARG_UINT32: {
+            uint32_t v;
+            memcpy(&v, data, sizeof(v));
+            conversion[n++] = kind;
+            conversion[n] = '\0';
+            written = snprintf(out, room, conversion, v);
+            break;
+        }
+        case LOG_ARG_INT64:
+        case LOG_ARG_UINT64: {
+            uint64_t v;
+            memcpy(&v, data, sizeof(v));
+            conversion[n++] = 'l';
+            conversion[n++] = 'l';
+            conversion[n++] = kind;
+            conversion[n] = '\0';
+            written = snprintf(out, room, conversion, (unsigned long long)v);
+            break;
+        }
+        case LOG_ARG_DOUBLE: {
+            double v;
+            memcpy(&v, data, sizeof(v));
+            conversion[n++] = strchr("fFeEgG", kind) ? kind : 'f';
+            conversion[n] = '\0';
+            written = snprintf(out, room, conversion, v);
+            break;
+        }
+        case LOG_ARG_STRING: {
+            char text[LOG_ARG_BYTES];
+            memcpy(text, data + 1, data[0]);
+            text[data[0]] = '\0';
+            conversion[n++] = 's';
+            conversion[n] = '\0';
+            written = snprintf(out, room, conversion, text);
+            break;
+        }
+    }
+    if (written < 0) {
+        return 0;
+    }
+    return (size_t)written < room ? (size_t)written : room - 1;
+}
+
+static size_t argSize(LogArgType type, const uint8_t* data) {
+    switch (type) {
+        case LOG_ARG_INT32:
+        case LOG_ARG_UINT32: return 4;
+        case LOG_ARG_INT64:
+        case LOG_ARG_UINT64:
+        case LOG_ARG_DOUBLE: return 8;
+        case LOG_ARG_STRING: return 1 + data[0];
+    }
+    return 0;
+}
+
+// The subsystem prefix (after any leading newlines) and printf over the
+// recorded arguments; a conversion without an argument left prints as-is
+static void formatRecord(const LogRecord& record, char* line, size_t size) {
+    size_t used = 0;
+    uint8_t arg = 0;
+    size_t offset = 0;
+    const char* p = record.format;
+    while (*p == '\n' && used + 1 < size) {
+        line[used++] = *p++;
+    }
+    const char* prefix = record.tag < LOG_TAG_COUNT ? TAG_PREFIXES[record.tag] : "";
+    if (*prefix != '\0') {
+        int written = snprintf(line + used, size - used, "%s ", prefix);
+        used += written > 0 ? std::min((size_t)written, size - used - 1) : 0;
+    }
+    while (*p != '\0' && used + 1 < size) {
+        if (*p != '%') {
+            line[used++] = *p++;
+            continue;
+        }
+        if (p[1] == '%') {
+            line[used++] = '%';
+            p += 2;
+            continue;
+        }
+        size_t specLength = 1;
+        while (p[specLength] != '\0' && strchr("diouxXcsfFeEgGp", p[specLength]) == nullptr) {
+            specLength++;
+        }
+        if (p[specLength] == '\0' || arg >= record.argCount) {
+            line[used++] = *p++;
+            continue;
+        }
+        specLength++;
+        LogArgType type = (LogArgType)record.types[arg++];
+        const uint8_t* data = record.args + offset;
+        offset += argSize(type, data);
+        used += formatArg(line + used, size - used, p, specLength, type, data);
+        p += specLength;
+    }
+    line[used] = '\0';
+}
+
+// Interned record as one frame for scripts/log_decode.py:
+//   magic, payload length, payload, XOR of the payload
+// with the payload
+//   ID (4 bytes, little-endian), tag, level, argument count,
+//   argument types, arguments (as stored in the record)
+static size_t frameRecord(const LogRecord& record, uint8_t* frame) {
+    size_t n = 2;
+    memcpy(frame + n, &record.id, sizeof(record.id));
+    n += sizeof(record.id);
+    frame[n++] = record.tag;
+    frame[n++] = record.level;
+    frame[n++] = record.argCount;
+    memcpy(frame + n, record.types, record.argCount);
+    n += record.argCount;
+    memcpy(frame + n, record.args, record.length);
+    n += record.length;
+
+    uint8_t check = 0;
+    for (size_t i = 2; i < n; i++) {
+        check ^= frame[i];
+    }
+    frame[0] = LOG_FRAME_MAGIC;
+    frame[1] = (uint8_t)(n - 2);
+    frame[n++] = check;
+    return n;
+}
+
+void logDrain() {
+    char line[LOG_LINE_LENGTH];
+    uint8_t frame[LOG_FRAME_BYTES];
+    for (;;) {
+        LogRecord* record = &ring[readPosition & (LOG_RING_RECORDS - 1)];
+        if (record->sequence.load(std::memory_order_acquire) != readPosition + 1) {
+            return;
+        }
+        uint32_t lost = logDropped();
+        if (lost != droppedReported) {
+            Serial.printf("[LOG] %lu message(s) dropped\n", (unsigned long)(lost - droppedReported));
+            droppedReported = lost;
+        }
+        if (record->format == nullptr) {
+            size_t length = frameRecord(*record, frame);
+            record->sequence.store(readPosition + LOG_RING_RECORDS, std::memory_order_release);
+            readPosition++;
+            Serial.write(frame, length);
+            continue;
+        }
+        formatRecord(*record, line, sizeof(line));
+        record->sequence.store(readPosition + LOG_RING_RECORDS, std::memory_order_release);
+        readPosition++;
+        Serial.println(line);
+    }
+}
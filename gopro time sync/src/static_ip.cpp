@@ -0,0 +1,100 @@
+#include "static_ip.h"
+
+#include <esp_netif.h>
+#include <esp_netif_net_stack.h>
+#include <lwip/etharp.h>
+#include <lwip/netif.h>
+#include <lwip/tcpip.h>
+
+static const IPAddress GOPRO_GATEWAY(10, 5, 5, 9);
+static const IPAddress GOPRO_SUBNET(255, 255, 255, 0);
+
+// Probe start/end run on the tcpip thread; the caller waits for each
+struct ArpProbe {
+    struct netif* netif;
+    ip4_addr_t ip;
+    TaskHandle_t task;
+    err_t result;
+    bool claimed;
+};
+
+IPAddress staticIPCandidate(uint8_t attempt) {
+    uint8_t mac[6];
+    WiFi.macAddress(mac);
+
+    uint8_t offset = (uint8_t)((mac[4] ^ mac[5]) + attempt) % STATIC_IP_POOL_SIZE;
+    return IPAddress(10, 5, 5, STATIC_IP_POOL_START + offset);
+}
+
+bool staticIPApply(const IPAddress& ip) {
+    return WiFi.config(ip, GOPRO_GATEWAY, GOPRO_SUBNET, GOPRO_GATEWAY);
+}
+
+bool staticIPRelease() {
+    return WiFi.config(IPAddress(0, 0, 0, 0), IPAddress(0, 0, 0, 0), IPAddress(0, 0, 0, 0));
+}
+
+static esp_netif_t* stationHandle() {
+    return esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
+}
+
+bool staticIPHold() {
+    esp_netif_t* pNetif = stationHandle();
+    if (pNetif == nullptr) {
+        return false;
+    }
+    esp_err_t err = esp_netif_dhcpc_stop(pNetif);
+    if (err != ESP_OK && err != ESP_ERR_ESP_NETIF_DHCP_ALREADY_STOPPED) {
+        return false;
+    }
+    esp_netif_ip_info_t none = {};
+    return esp_netif_set_ip_info(pNetif, &none) == ESP_OK;
+}
+
+// With the station held at 0.0.0.0, the request etharp_query() sends for
+// the candidate has sender IP 0.0.0.0: an RFC 5227 probe. The entry it
+// leaves pending is filled in by a reply even though the station has no
+// address yet, so the ARP cache shows whether another host answered.
+static void startProbe(void* arg) {
+    ArpProbe* probe = (ArpProbe*)arg;
+    probe->result = etharp_query(probe->netif, &probe->ip, nullptr);
+    xTaskNotifyGive(probe->task);
+}
+
+// The cache is cleared afterwards, so the pending entries stop re-querying
+static void endProbe(void* arg) {
+    ArpProbe* probe = (ArpProbe*)arg;
+    struct eth_addr* mac;
+    const ip4_addr_t* ip;
+    probe->claimed = etharp_find_addr(probe->netif, &probe->ip, &mac, &ip) >= 0;
+    etharp_cleanup_netif(probe->netif);
+    xTaskNotifyGive(probe->task);
+}
+
+// RFC 5227 probe: sent from 0.0.0.0, so it cannot touch anyone's ARP cache
+bool staticIPProbe(const IPAddress& ip, bool& inUse) {
+    esp_netif_t* pNetif = stationHandle();
+    ArpProbe probe = {pNetif ? (struct netif*)esp_netif_get_netif_impl(pNetif) : nullptr, {},
+                      xTaskGetCurrentTaskHandle(), ERR_OK, false};
+    inUse = false;
+    if (probe.netif == nullptr) {
+        return false;
+    }
+    IP4_ADDR(&probe.ip, ip[0], ip[1], ip[2], ip[3]);
+
+    if (tcpip_callback(startProbe, &probe) != ERR_OK) {
+        return false;
+    }
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    if (probe.result == ERR_OK) {
+        delay(ARP_PROBE_WAIT_MS);
+    }
+
+    // The pending entry has to go even if nothing could be sent
+    while (tcpip_callback(endProbe, &probe) != ERR_OK) {
+        delay(1);
+    }
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    inUse = probe.claimed;
+    return probe.result == ERR_OK;
+}
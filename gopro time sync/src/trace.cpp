@@ -0,0 +1,141 @@
+#include "trace.h"
+
+#include <Arduino.h>
+#include <algorithm>
+
+struct PhaseHistory {
+    uint32_t samples[TRACE_WINDOW];
+    uint8_t head;              // Next slot to overwrite
+    uint8_t filled;            // Valid samples in the window
+    uint32_t count;
+    uint32_t failures;
+    uint32_t startUs;
+    bool running;
+};
+
+struct TraceEvent {
+    uint32_t timeUs;
+    uint16_t cycle;
+    uint8_t phase;
+    uint8_t edge;              // 'B' begin, 'E' end ok, 'F' end failed
+};
+
+static PhaseHistory history[TRACE_PHASE_COUNT];
+static TraceEvent events[TRACE_EVENT_LOG];
+static uint8_t eventHead = 0;
+static uint8_t eventCount = 0;
+static uint16_t cycle = 0;
+
+static const char* const PHASE_NAMES[TRACE_PHASE_COUNT] = {
+    "scan", "connect", "read_ssid", "read_password", "enable_ap",
+    "wait_ap", "wifi_join", "align", "set_time", "verify", "time_to_sync",
+};
+
+static void logEvent(TracePhase phase, uint8_t edge, uint32_t timeUs) {
+    events[eventHead] = {timeUs, cycle, (uint8_t)phase, edge};
+    eventHead = (eventHead + 1) % TRACE_EVENT_LOG;
+    if (eventCount < TRACE_EVENT_LOG) {
+        eventCount++;
+    }
+}
+
+void traceBegin(TracePhase phase) {
+    if (phase >= TRACE_PHASE_COUNT) {
+        return;
+    }
+    if (phase == TRACE_TIME_TO_SYNC) {
+        cycle++;
+    }
+
+    uint32_t now = micros();
+    history[phase].startUs = now;
+    history[phase].running = true;
+    logEvent(phase, 'B', now);
+}
+
+// Failed spans (timeouts, mostly) are only counted, so the percentiles
+// describe the spans that did their job
+static void addSample(TracePhase phase, uint32_t startUs, bool ok) {
+    uint32_t now = micros();
+    PhaseHistory& h = history[phase];
+    h.count++;
+    if (ok) {
+        h.samples[h.head] = now - startUs;  // Wrap-safe unsigned subtraction
+        h.head = (h.head + 1) % TRACE_WINDOW;
+        if (h.filled < TRACE_WINDOW) {
+            h.filled++;
+        }
+    } else {
+        h.failures++;
+    }
+    logEvent(phase, ok ? 'E' : 'F', now);
+}
+
+void traceEnd(TracePhase phase, bool ok) {
+    if (phase >= TRACE_PHASE_COUNT || !history[phase].running) {
+        return;
+    }
+    history[phase].running = false;
+    addSample(phase, history[phase].startUs, ok);
+}
+
+void traceRecord(TracePhase phase, uint32_t startUs, bool ok) {
+    if (phase >= TRACE_PHASE_COUNT) {
+        return;
+    }
+    if (phase == TRACE_TIME_TO_SYNC) {
+        cycle++;
+    }
+    logEvent(phase, 'B', startUs);
+    addSample(phase, startUs, ok);
+}
+
+const char* tracePhaseName(TracePhase phase) {
+    return phase < TRACE_PHASE_COUNT ? PHASE_NAMES[phase] : "?";
+}
+
+bool traceGetStats(TracePhase phase, TraceStats& stats) {
+    if (phase >= TRACE_PHASE_COUNT || history[phase].count == 0) {
+        return false;
+    }
+
+    const PhaseHistory& h = history[phase];
+    stats.count = h.count;
+    stats.failures = h.failures;
+    if (h.filled == 0) {
+        stats.minUs = stats.p50Us = stats.p95Us = stats.maxUs = 0;
+        return true;
+    }
+
+    uint32_t sorted[TRACE_WINDOW];
+    std::copy(h.samples, h.samples + h.filled, sorted);
+    std::sort(sorted, sorted + h.filled);
+    stats.minUs = sorted[0];
+    stats.p50Us = sorted[(h.filled - 1) * 50 / 100];
+    stats.p95Us = sorted[(h.filled - 1) * 95 / 100];
+    stats.maxUs = sorted[h.filled - 1];
+    return true;
+}
+
+void traceDumpStats() {
+    Serial.println("#trace,phase,count,failures,min_us,p50_us,p95_us,max_us");
+    for (uint8_t i = 0; i < TRACE_PHASE_COUNT; i++) {
+        TraceStats s;
+        if (!traceGetStats((TracePhase)i, s)) {
+            continue;
+        }
+        Serial.printf("trace,%s,%u,%u,%u,%u,%u,%u\n", PHASE_NAMES[i],
+                      (unsigned)s.count, (unsigned)s.failures, (unsigned)s.minUs,
+                      (unsigned)s.p50Us, (unsigned)s.p95Us, (unsigned)s.maxUs);
+    }
+}
+
+void traceDumpEvents() {
+    Serial.println("#event,cycle,phase,edge,t_us");
+    uint8_t start = (eventHead + TRACE_EVENT_LOG - eventCount) % TRACE_EVENT_LOG;
+    for (uint8_t i = 0; i < eventCount; i++) {
+        const TraceEvent& e = events[(start + i) % TRACE_EVENT_LOG];
+        Serial.printf("event,%u,%s,%c,%u\n", (unsigned)e.cycle, PHASE_NAMES[e.phase],
+                      e.edge, (unsigned)e.timeUs);
+    }
+}
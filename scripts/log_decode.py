@@ -0,0 +1,194 @@
+"""Decode the ESP32's interned serial log.
+
+Firmware built with -D LOG_INTERNED=1 leaves the message text out of flash:
+each LOG_* record goes out as a binary frame carrying the message ID (a
+32-bit FNV-1a hash of its format string), the subsystem, the level and the
+arguments. This script hashes every LOG_* call in the firmware sources the
+same way and prints the frames as the lines the text build would have
+printed. Anything outside a frame (boot ROM output, the CSV dumps) passes
+through unchanged.
+
+Frame layout (see frameRecord() in src/serial_log.cpp):
+    0xA5, payload length, payload, XOR of the payload
+    payload: ID (u32 LE), tag, level, argument count, argument types, arguments
+"""
+
+from __future__ import annotations
+
+import argparse
+import re
+import struct
+import sys
+from pathlib import Path
+from typing import BinaryIO, Dict, List, Optional
+
+FRAME_MAGIC = 0xA5
+
+ARG_INT32, ARG_UINT32, ARG_INT64, ARG_UINT64, ARG_DOUBLE, ARG_STRING = range(6)
+
+FIRMWARE_DIR = Path(__file__).resolve().parent.parent / "gopro time sync"
+
+LOG_CALL = re.compile(r'LOG_(?:ERROR|WARN|INFO|DEBUG)\(\s*(\w+)\s*,\s*"((?:[^"\\]|\\.)*)"')
+TAG_ENTRY = re.compile(r'TAG\((\w+),\s*"([^"]*)"\)')
+CONVERSION = re.compile(r"%%|%([-+ #0]*\d*(?:\.\d+)?)[hljztL]*([diouxXcsfFeEgG])")
+
+ESCAPES = {"n": "\n", "t": "\t", "r": "\r", "\\": "\\", '"': '"', "'": "'"}
+
+
+def _parse_args() -> argparse.Namespace:
+    parser = argparse.ArgumentParser(
+        description="Turn the ESP32's interned log frames (LOG_INTERNED=1) back into text.",
+    )
+    parser.add_argument(
+        "input",
+        nargs="?",
+        help="Captured serial output (default: stdin, unless --port is given).",
+    )
+    parser.add_argument("--port", help="Read from this serial port instead (needs pyserial).")
+    parser.add_argument("--baud", type=int, default=115200, help="Serial baud rate (default: 115200).")
+    parser.add_argument(
+        "--firmware",
+        type=Path,
+        default=FIRMWARE_DIR,
+        help="Firmware source tree the device was built from (default: %(default)s).",
+    )
+    return parser.parse_args()
+
+
+def _unescape(literal: str) -> str:
+    return re.sub(r"\\(.)", lambda m: ESCAPES.get(m.group(1), m.group(1)), literal)
+
+
+def _fnv1a(text: str) -> int:
+    value = 2166136261
+    for byte in text.encode("utf-8"):
+        value = ((value ^ byte) * 16777619) & 0xFFFFFFFF
+    return value
+
+
+def load_tags(firmware: Path) -> List[str]:
+    header = (firmware / "include" / "serial_log.h").read_text(encoding="utf-8")
+    return [prefix for _, prefix in TAG_ENTRY.findall(header)]
+
+
+def load_messages(firmware: Path) -> Dict[int, str]:
+    messages: Dict[int, str] = {}
+    for source in sorted((firmware / "src").glob("*.cpp")):
+        for _, literal in LOG_CALL.findall(source.read_text(encoding="utf-8")):
+            text = _unescape(literal)
+            message_id = _fnv1a(text)
+            if messages.get(message_id, text) != text:
+                raise SystemExit(f"message ID collision: {messages[message_id]!r} and {text!r}")
+            messages[message_id] = text
+    return messages
+
+
+def _read_args(types: bytes, data: bytes) -> List[object]:
+    args: List[object] = []
+    offset = 0
+    for kind in types:
+        if kind in (ARG_INT32, ARG_UINT32):
+            args.append(struct.unpack_from("<i" if kind == ARG_INT32 else "<I", data, offset)[0])
+            offset += 4
+        elif kind in (ARG_INT64, ARG_UINT64):
+            args.append(struct.unpack_from("<q" if kind == ARG_INT64 else "<Q", data, offset)[0])
+            offset += 8
+        elif kind == ARG_DOUBLE:
+            args.append(struct.unpack_from("<d", data, offset)[0])
+            offset += 8
+        else:
+            length = data[offset]
+            args.append(data[offset + 1 : offset + 1 + length].decode("utf-8", "replace"))
+            offset += 1 + length
+    return args
+
+
+def format_message(text: str, prefix: str, args: List[object]) -> str:
+    """printf the way formatRecord() in src/serial_log.cpp does."""
+    remaining = iter(args)
+
+    def conversion(match: re.Match) -> str:
+        if match.group(0) == "%%":
+            return "%"
+        flags, kind = match.group(1), match.group(2)
+        try:
+            value = next(remaining)
+        except StopIteration:
+            return match.group(0)
+        if kind == "u":
+            kind = "d"
+        if kind == "c" and isinstance(value, int):
+            value = chr(value & 0xFF)
+        if kind in "ouxX" and isinstance(value, int) and value < 0:
+            value &= 0xFFFFFFFF
+        return ("%" + flags + kind) % value
+
+    body = text.lstrip("\n")
+    newlines = text[: len(text) - len(body)]
+    if prefix:
+        body = prefix + " " + body
+    return newlines + CONVERSION.sub(conversion, body)
+
+
+def decode(stream: BinaryIO, out: BinaryIO, tags: List[str], messages: Dict[int, str]) -> None:
+    while True:
+        byte = stream.read(1)
+        if not byte:
+            break
+        if byte[0] != FRAME_MAGIC:
+            out.write(byte)
+            if byte == b"\n":
+                out.flush()
+            continue
+
+        header = stream.read(1)
+        payload = stream.read(header[0]) if header else b""
+        check = stream.read(1)
+        frame = _frame_line(header, payload, check, tags, messages)
+        if frame is None:
+            # Not a frame after all: pass the bytes through as they came
+            out.write(byte + header + payload + check)
+            continue
+        out.write(frame.encode("utf-8") + b"\n")
+        out.flush()
+    out.flush()
+
+
+def _frame_line(header: bytes, payload: bytes, check: bytes, tags: List[str],
+                messages: Dict[int, str]) -> Optional[str]:
+    if not header or len(payload) != header[0] or len(payload) < 7 or not check:
+        return None
+    xor = 0
+    for value in payload:
+        xor ^= value
+    if xor != check[0]:
+        return None
+
+    message_id, tag, _level, count = struct.unpack_from("<IBBB", payload)
+    types, data = payload[7 : 7 + count], payload[7 + count :]
+    prefix = tags[tag] if tag < len(tags) else f"[tag {tag}]"
+    text = messages.get(message_id)
+    if text is None:
+        return f"{prefix} <unknown message 0x{message_id:08x}, firmware sources out of date?>"
+    return format_message(text, prefix, _read_args(types, data))
+
+
+def main() -> None:
+    args = _parse_args()
+    tags = load_tags(args.firmware)
+    messages = load_messages(args.firmware)
+
+    if args.port:
+        import serial  # pyserial
+
+        with serial.Serial(args.port, args.baud) as port:
+            decode(port, sys.stdout.buffer, tags, messages)
+    elif args.input:
+        with open(args.input, "rb") as capture:
+            decode(capture, sys.stdout.buffer, tags, messages)
+    else:
+        decode(sys.stdin.buffer, sys.stdout.buffer, tags, messages)
+
+
+if __name__ == "__main__":
+    main()